@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "controlpad_ctrl_report.h"
+#include "controlpad_effects.h"
+#include "controlpad_event.h"
+#include "controlpad_event_ring.h"
+#include "controlpad_hid.h"
+#include "controlpad_led.h"
+#include "controlpad_usb_desc.h"
+
+// ===== BENCHMARK CASES =====
+// Hot paths of the driver as benchmark cases: LED encode/decode, report and
+// descriptor decoding, effect rendering and the event queue. tools/bench.cpp
+// runs them on the host against a wall clock; the firmware's benchmark build
+// runs the same cases against the cycle counter. Both print with
+// benchFormatHeader/Row, so host and target tables line up.
+//
+// A case runs its body `iterations` times. Results go through benchSink so
+// the compiler cannot drop the work, and inputs vary with the iteration
+// number where that is cheap, so nothing folds into a constant.
+
+typedef void (*BenchRun)(uint32_t iterations, const void* arg);
+
+struct BenchCase {
+  const char* name;
+  BenchRun run;
+  const void* arg;
+};
+
+// Keep p's pointee alive as far as the optimiser can tell
+inline void benchSink(const void* p) {
+  __asm__ volatile("" : : "r"(p) : "memory");
+}
+
+// ----- Shared state, as the driver keeps it -----
+
+static LedFrame benchFrame;
+static uint8_t benchPacket1[LED_PACKET_LEN];   // statePacket1
+static uint8_t benchPacket2[LED_PACKET_LEN];   // statePacket2
+static uint8_t benchFramePackets[5][LED_PACKET_LEN];
+
+// ----- Cases -----
+
+// Placement of the case functions. The firmware's benchmark build includes
+// controlpad_bench_cases.inc a second time with BENCH_CODE set to FLASHMEM to
+// time the same code running from flash instead of ITCM.
+#ifndef BENCH_CODE
+#define BENCH_CODE
+#endif
+
+#define BENCH_EFFECT_COUNT (sizeof(LED_EFFECTS) / sizeof(LED_EFFECTS[0]))
+#define BENCH_MAX_CASES    (9 + BENCH_EFFECT_COUNT)
+
+#include "controlpad_bench_cases.inc"
+
+// ----- Table -----
+
+inline int benchFormatHeader(char* out, size_t size) {
+  return snprintf(out, size, "%-28s %12s %12s %12s", "Benchmark", "ns/op", "cycles/op", "iterations");
+}
+
+// cycles 0 = not measured (host)
+inline int benchFormatRow(char* out, size_t size, const char* name, double ns, uint32_t cycles, uint32_t iterations) {
+  if (cycles) {
+    return snprintf(out, size, "%-28s %12.1f %12lu %12lu", name, ns, (unsigned long)cycles, (unsigned long)iterations);
+  }
+  return snprintf(out, size, "%-28s %12.1f %12s %12lu", name, ns, "-", (unsigned long)iterations);
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// ===== BOOT TRACE =====
+// Timestamps startup milestones so boot time can be compared across releases.
+// The object is meant to live in DMAMEM: Teensy startup code does not clear that
+// region, so the history of the last BOOT_TRACE_HISTORY boots survives a warm
+// reset (program upload, watchdog, SCB reset). A magic word guards against
+// reading garbage after power-up. It has no constructor on purpose - a static
+// constructor would wipe the history before begin() can look at it.
+//
+// A record that passes the magic check can still be half-written (reset in
+// the middle of mark()) or damaged, so begin() clamps each kept record's
+// count to BOOT_TRACE_MAX_MARKS before anything indexes marks[] with it.
+// mark() is called from setup() and from USB callbacks, so the append runs
+// with interrupts masked; PRIMASK is saved and restored as in cpuLock().
+
+#ifndef BOOT_TRACE_HISTORY
+#define BOOT_TRACE_HISTORY 4
+#endif
+
+#ifndef BOOT_TRACE_MAX_MARKS
+#define BOOT_TRACE_MAX_MARKS 48   // Full-profile init alone issues 29 commands
+#endif
+
+enum BootMilestone : uint8_t {
+  BOOT_SETUP = 0,         // setup() entry
+  BOOT_USB_BEGIN,         // usbHost.begin() returned
+  BOOT_OFFER_INTERFACE,   // arg: interface number
+  BOOT_ATTACH_INTERFACE,  // arg: interface number
+  BOOT_INIT_COMMAND,      // arg: command byte 0 of the completed init command
+  BOOT_INIT_DONE,
+  BOOT_FIRST_KBD_POLL,
+  BOOT_FIRST_FRAME,       // First commit (41 80) echoed after init
+  BOOT_MILESTONE_COUNT
+};
+
+struct BootMark {
+  uint32_t us;            // micros() at the milestone
+  uint8_t milestone;
+  uint8_t arg;
+};
+
+struct BootRecord {
+  uint32_t build_id;      // Identifies the firmware build that produced the record
+  uint8_t count;          // Valid entries in marks[]
+  uint8_t dropped;        // Marks that did not fit
+  bool closed;            // Timeline complete (first frame or timeout)
+  BootMark marks[BOOT_TRACE_MAX_MARKS];
+
+  uint32_t startUs() const { return count ? marks[0].us : 0; }
+  uint32_t endUs() const { return count ? marks[count - 1].us : 0; }
+
+  const BootMark* find(BootMilestone m) const {
+    for (uint8_t i = 0; i < count; i++) {
+      if (marks[i].milestone == m) return &marks[i];
+    }
+    return nullptr;
+  }
+};
+
+static inline uint32_t bootTraceLock() {
+#if defined(__arm__)
+  uint32_t primask;
+  __asm__ volatile("mrs %0, primask\n\tcpsid i" : "=r"(primask) :: "memory");
+  return primask;
+#else
+  return 0;
+#endif
+}
+
+static inline void bootTraceUnlock(uint32_t primask) {
+#if defined(__arm__)
+  __asm__ volatile("msr primask, %0" :: "r"(primask) : "memory");
+#else
+  (void)primask;
+#endif
+}
+
+class BootTrace {
+public:
+  static const uint32_t MAGIC = 0xB0075EC7;
+
+  // Start a new boot record, keeping older ones if the RAM contents are valid
+  void begin(uint32_t build_id) {
+    if (magic != MAGIC || head >= BOOT_TRACE_HISTORY || stored > BOOT_TRACE_HISTORY) {
+      memset(history, 0, sizeof(history));
+      head = 0;
+      stored = 0;
+      magic = MAGIC;
+    } else {
+      for (uint8_t i = 0; i < BOOT_TRACE_HISTORY; i++) {
+        if (history[i].count > BOOT_TRACE_MAX_MARKS) history[i].count = BOOT_TRACE_MAX_MARKS;
+      }
+      head = (head + 1) % BOOT_TRACE_HISTORY;
+    }
+    if (stored < BOOT_TRACE_HISTORY) stored++;
+    seen_mask = 0;
+
+    BootRecord& rec = history[head];
+    rec.build_id = build_id;
+    rec.count = 0;
+    rec.dropped = 0;
+    rec.closed = false;
+  }
+
+  void mark(BootMilestone m, uint8_t arg, uint32_t us) {
+    uint32_t primask = bootTraceLock();
+    append(m, arg, us);
+    bootTraceUnlock(primask);
+  }
+
+  // Record a milestone only the first time it happens during this boot
+  void markOnce(BootMilestone m, uint8_t arg, uint32_t us) {
+    uint32_t primask = bootTraceLock();
+    if (!(seen_mask & (1u << m))) {
+      seen_mask |= (1u << m);
+      append(m, arg, us);
+    }
+    bootTraceUnlock(primask);
+  }
+
+  bool seen(BootMilestone m) const { return seen_mask & (1u << m); }
+
+  void close() { history[head].closed = true; }
+  bool closed() const { return history[head].closed; }
+
+  const BootRecord& current() const { return history[head]; }
+
+  // ago = 0 is the current boot, 1 the one before, ...; nullptr if not stored
+  const BootRecord* previous(uint8_t ago) const {
+    if (ago >= stored) return nullptr;
+    return &history[(head + BOOT_TRACE_HISTORY - ago) % BOOT_TRACE_HISTORY];
+  }
+
+  uint8_t storedBoots() const { return stored; }
+
+  static const char* name(uint8_t m) {
+    switch (m) {
+      case BOOT_SETUP:            return "setup";
+      case BOOT_USB_BEGIN:        return "usb";
+      case BOOT_OFFER_INTERFACE:  return "offer";
+      case BOOT_ATTACH_INTERFACE: return "attach";
+      case BOOT_INIT_COMMAND:     return "cmd";
+      case BOOT_INIT_DONE:        return "init";
+      case BOOT_FIRST_KBD_POLL:   return "kbd";
+      case BOOT_FIRST_FRAME:      return "frame";
+      default:                    return "?";
+    }
+  }
+
+  // FNV-1a over a build string such as __DATE__ " " __TIME__
+  static constexpr uint32_t buildId(const char* s, uint32_t h = 2166136261u) {
+    return *s ? buildId(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+  }
+
+private:
+  // Caller holds the lock
+  void append(BootMilestone m, uint8_t arg, uint32_t us) {
+    BootRecord& rec = history[head];
+    if (rec.closed) return;
+    if (rec.count < BOOT_TRACE_MAX_MARKS) {
+      rec.marks[rec.count].us = us;
+      rec.marks[rec.count].milestone = m;
+      rec.marks[rec.count].arg = arg;
+      rec.count++;
+    } else if (rec.dropped < UINT8_MAX) {
+      rec.dropped++;
+    }
+  }
+
+  uint32_t magic;
+  uint8_t head;
+  uint8_t stored;
+  uint32_t seen_mask;     // Milestones already recorded by markOnce()
+  BootRecord history[BOOT_TRACE_HISTORY];
+};
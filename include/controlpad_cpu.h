@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// ===== CPU ACCOUNTING =====
+// Splits every CPU cycle into one category. Code switches the current
+// category on entry to a piece of work and back on exit; the cycles since the
+// previous switch are charged to whatever was running. Because only one
+// category is current at a time, nesting is exclusive: a log line printed
+// from a USB callback counts as logging, not twice.
+//
+// Everything not claimed by a scope is idle - loop() spinning with nothing to
+// do. Pacing delay() calls are kept apart (CPU_WAIT): the core is blocked in
+// loop() but still free for interrupts.
+//
+// Counts roll over into a report once per window (one second at F_CPU), so
+// 32-bit cycle counters are enough. The caller serialises enter/leave against
+// interrupts; see CpuScope in main.cpp.
+
+enum CpuCategory : uint8_t {
+  CPU_IDLE = 0,
+  CPU_LOOP,      // Dispatch, gestures, serial commands, trace output
+  CPU_USB,       // USB completion callbacks
+  CPU_RENDER,    // LED feedback: choosing and submitting frames
+  CPU_ENCODE,    // Building LED packets
+  CPU_LOG,       // Serial logging
+  CPU_WAIT,      // Blocked in pacing delays
+  CPU_CATEGORY_COUNT
+};
+
+inline const char* cpuCategoryName(uint8_t c) {
+  switch (c) {
+    case CPU_IDLE:   return "idle";
+    case CPU_LOOP:   return "loop";
+    case CPU_USB:    return "usb";
+    case CPU_RENDER: return "render";
+    case CPU_ENCODE: return "encode";
+    case CPU_LOG:    return "log";
+    case CPU_WAIT:   return "wait";
+    default:         return "?";
+  }
+}
+
+class CpuAccounting {
+public:
+  void begin(uint32_t now) {
+    memset(acc, 0, sizeof(acc));
+    memset(report, 0, sizeof(report));
+    report_total = 0;
+    windows = 0;
+    peak_busy_permille = 0;
+    last = window_start = now;
+    current = CPU_IDLE;
+  }
+
+  // Switch to cat; returns the category to hand back to leave()
+  uint8_t enter(uint8_t cat, uint32_t now) {
+    charge(now);
+    uint8_t prev = current;
+    current = cat;
+    return prev;
+  }
+
+  void leave(uint8_t prev, uint32_t now) {
+    charge(now);
+    current = prev;
+  }
+
+  // Publish the window once window_cycles have passed; true when it did
+  bool roll(uint32_t now, uint32_t window_cycles) {
+    if (now - window_start < window_cycles) return false;
+    charge(now);
+    memcpy(report, acc, sizeof(report));
+    memset(acc, 0, sizeof(acc));
+    report_total = now - window_start;
+    window_start = now;
+    windows++;
+    uint32_t busy = busyPermille();
+    if (busy > peak_busy_permille) peak_busy_permille = busy;
+    return true;
+  }
+
+  // Last completed window
+  uint32_t cycles(uint8_t cat) const { return cat < CPU_CATEGORY_COUNT ? report[cat] : 0; }
+  uint32_t totalCycles() const { return report_total; }
+  uint32_t permille(uint8_t cat) const {
+    return report_total ? (uint32_t)((uint64_t)cycles(cat) * 1000 / report_total) : 0;
+  }
+  // Everything except idle and pacing waits
+  uint32_t busyPermille() const {
+    return report_total ? 1000 - permille(CPU_IDLE) - permille(CPU_WAIT) : 0;
+  }
+  uint32_t peakBusyPermille() const { return peak_busy_permille; }
+  uint32_t windowCount() const { return windows; }
+
+private:
+  void charge(uint32_t now) {
+    acc[current] += now - last;
+    last = now;
+  }
+
+  uint32_t acc[CPU_CATEGORY_COUNT];
+  uint32_t report[CPU_CATEGORY_COUNT];
+  uint32_t report_total = 0;
+  uint32_t windows = 0;
+  uint32_t peak_busy_permille = 0;
+  uint32_t last = 0;
+  uint32_t window_start = 0;
+  uint8_t current = CPU_IDLE;
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdint.h>
+
+// ===== INTERFACE 1 CONTROL REPORT DECODING =====
+// EP 0x83 carries 64-byte vendor reports. From the captures in test/ there are
+// two kinds:
+//
+//  - Echoes: every command sent to EP 0x04 comes back with the same first four
+//    bytes. Write commands (56 81, 56 83, 41 80, 51 28, ...) echo with a zero
+//    payload; read commands (52 28, 52 80, 56 14, ...) carry the answer.
+//  - Key notifications the device sends on its own (effect_modes.txt):
+//        43 01 00 00 <key> <flags>     flags 0xC0 = key down, 0x40 = key up
+//    usually preceded by 42 20 00 00 00 00 00 01. The key index is the
+//    device's own numbering (0..31), not the 1-24 button number; only index
+//    0x09 occurs in the captures, so the index -> button relation is not
+//    mapped yet.
+//
+// The decoder folds key notifications into a 32-bit pressed-key bitmap, so the
+// full pad state is available after every report without replaying HID usages.
+
+#define CTRL_REPORT_LEN       64
+#define CTRL_KEY_NOTIFY_CMD   0x43
+#define CTRL_KEY_NOTIFY_SUB   0x01
+#define CTRL_PRE_NOTIFY_CMD   0x42   // 42 20 .. 01 announces a key notification
+#define CTRL_PRE_NOTIFY_SUB   0x20
+#define CTRL_KEY_FLAG_VALID   0x40
+#define CTRL_KEY_FLAG_DOWN    0x80
+#define CTRL_KEY_MAX          32
+
+enum CtrlReportKind : uint8_t {
+  CTRL_REPORT_EMPTY = 0,   // All zero / too short to classify
+  CTRL_REPORT_ECHO,        // Answer to one of our commands
+  CTRL_REPORT_KEY,         // Unsolicited key notification
+  CTRL_REPORT_NOTIFY,      // Unsolicited 42 20 report, no key state
+  CTRL_REPORT_UNKNOWN
+};
+
+struct CtrlReport {
+  CtrlReportKind kind;
+  uint8_t cmd;             // Byte 0 (echo: command we sent)
+  uint8_t sub;             // Byte 1
+  uint8_t index;           // Byte 2 (indexed commands such as 56 83 00/01)
+  uint8_t key;             // CTRL_REPORT_KEY only
+  bool down;               // CTRL_REPORT_KEY only
+  uint32_t pressed;        // Key bitmap after this report (bit n = key index n down)
+  uint32_t changed;        // Bits that flipped with this report
+};
+
+class CtrlReportDecoder {
+public:
+  void reset() { pressed = 0; }
+
+  uint32_t pressedKeys() const { return pressed; }
+
+  CtrlReport decode(const uint8_t* report, uint8_t len) {
+    CtrlReport out = {CTRL_REPORT_EMPTY, 0, 0, 0, 0, false, pressed, 0};
+    if (len < 6 || report[0] == 0x00) return out;
+
+    out.cmd = report[0];
+    out.sub = report[1];
+    out.index = report[2];
+
+    if (report[0] == CTRL_KEY_NOTIFY_CMD && report[1] == CTRL_KEY_NOTIFY_SUB &&
+        (report[5] & CTRL_KEY_FLAG_VALID) && report[4] < CTRL_KEY_MAX) {
+      uint32_t bit = 1u << report[4];
+      uint32_t next = (report[5] & CTRL_KEY_FLAG_DOWN) ? (pressed | bit) : (pressed & ~bit);
+      out.kind = CTRL_REPORT_KEY;
+      out.key = report[4];
+      out.down = report[5] & CTRL_KEY_FLAG_DOWN;
+      out.changed = next ^ pressed;
+      out.pressed = pressed = next;
+      return out;
+    }
+
+    if (report[0] == CTRL_PRE_NOTIFY_CMD && report[1] == CTRL_PRE_NOTIFY_SUB) {
+      out.kind = CTRL_REPORT_NOTIFY;
+      return out;
+    }
+
+    out.kind = isCommandByte(report[0]) ? CTRL_REPORT_ECHO : CTRL_REPORT_UNKNOWN;
+    return out;
+  }
+
+  // True when report is the device's echo of the command in sent
+  static bool isEchoOf(const uint8_t* report, const uint8_t* sent) {
+    return report[0] == sent[0] && report[1] == sent[1] && report[2] == sent[2];
+  }
+
+private:
+  // Command bytes seen on EP 0x04 in the captures
+  static bool isCommandByte(uint8_t b) {
+    switch (b) {
+      case 0x41: case 0x42: case 0x43: case 0x51:
+      case 0x52: case 0x55: case 0x56:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  uint32_t pressed = 0;
+};
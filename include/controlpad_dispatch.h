@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+#include "controlpad_event.h"
+
+// ===== EVENT DISPATCHER =====
+// Routes queued events to subscribers. A subscription names the event types
+// (bit n = ControlPadEventType n) and buttons (bit n = button n, bit 0 =
+// events without a button) it wants; dispatch walks a small static table,
+// so routing is a couple of mask tests per handler and nothing allocates.
+//
+// drain() empties the queue in one go, stopping early only when the cycle
+// budget runs out, so event handling keeps up regardless of how often
+// loop() gets around to calling it. The cycle source is passed in (DWT
+// CYCCNT on the Teensy) which keeps the header usable on a host build.
+
+#ifndef DISPATCH_MAX_HANDLERS
+#define DISPATCH_MAX_HANDLERS 8
+#endif
+
+#define DISPATCH_TYPE(t)      (1u << (t))
+#define DISPATCH_ALL_TYPES    0xFFu
+#define DISPATCH_ALL_BUTTONS  0xFFFFFFFFu
+
+typedef void (*EventHandler)(const controlpad_event& event, void* ctx);
+
+struct EventSubscription {
+  uint8_t type_mask;
+  uint32_t button_mask;
+  EventHandler handler;
+  void* ctx;
+  const char* name;
+};
+
+// Per-event dispatch cost in cycles, measured around the handler calls
+struct DispatchStats {
+  uint32_t events = 0;
+  uint32_t passes = 0;        // drain() calls that found at least one event
+  uint32_t budget_stops = 0;  // drain() calls cut short by the budget
+  uint32_t max_batch = 0;
+  uint32_t min_cycles = UINT32_MAX;
+  uint32_t max_cycles = 0;
+  uint64_t total_cycles = 0;
+
+  uint32_t meanCycles() const { return events ? (uint32_t)(total_cycles / events) : 0; }
+};
+
+class EventDispatcher {
+public:
+  bool subscribe(uint8_t type_mask, uint32_t button_mask, EventHandler handler, void* ctx, const char* name) {
+    if (count >= DISPATCH_MAX_HANDLERS || handler == nullptr) return false;
+    subs[count++] = {type_mask, button_mask, handler, ctx, name};
+    return true;
+  }
+
+  // Run every matching handler for one event; returns how many ran
+  uint8_t dispatch(const controlpad_event& event) const {
+    uint8_t type_bit = event.type < 8 ? (uint8_t)(1u << event.type) : 0;
+    uint32_t button_bit = event.button < 32 ? (1u << event.button) : 0;
+    uint8_t ran = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      const EventSubscription& s = subs[i];
+      if ((s.type_mask & type_bit) && (s.button_mask & button_bit)) {
+        s.handler(event, s.ctx);
+        ran++;
+      }
+    }
+    return ran;
+  }
+
+  // Pop and dispatch until the queue is empty or budget_cycles have passed.
+  // Returns the number of events handled.
+  template <typename Queue, typename CycleClock>
+  uint32_t drain(Queue& queue, uint32_t budget_cycles, CycleClock cycles) {
+    uint32_t start = cycles();
+    uint32_t handled = 0;
+    controlpad_event event;
+    while (queue.pop(event)) {
+      uint32_t before = cycles();
+      dispatch(event);
+      uint32_t cost = cycles() - before;
+
+      handled++;
+      stats.events++;
+      stats.total_cycles += cost;
+      if (cost < stats.min_cycles) stats.min_cycles = cost;
+      if (cost > stats.max_cycles) stats.max_cycles = cost;
+
+      if (cycles() - start >= budget_cycles) {
+        stats.budget_stops++;
+        break;
+      }
+    }
+    if (handled) {
+      stats.passes++;
+      if (handled > stats.max_batch) stats.max_batch = handled;
+    }
+    return handled;
+  }
+
+  uint8_t handlerCount() const { return count; }
+  const EventSubscription& handler(uint8_t i) const { return subs[i]; }
+  const DispatchStats& statistics() const { return stats; }
+
+private:
+  EventSubscription subs[DISPATCH_MAX_HANDLERS];
+  uint8_t count = 0;
+  DispatchStats stats;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include "controlpad_keymap.h"
+#include "controlpad_led.h"
+
+// ===== LED EFFECTS =====
+// The frames the driver renders into a LedFrame before encoding. All of them
+// are pure functions of their arguments, so the host benchmarks run exactly
+// this code. LED_EFFECTS lists them by name with one signature.
+
+// Demo feedback colour per button (index = button - 1)
+static const uint8_t DEMO_BUTTON_COLORS[CONTROLPAD_BUTTON_COUNT][3] = {
+  {255,   0,   0}, {  0, 255,   0}, {  0,   0, 255}, {255, 255,   0}, {255, 125, 255},  // Red, Green, Blue, Yellow, Magenta
+  {  0, 255, 255}, {255, 128,   0}, {128,   0, 255}, {255, 255, 255}, {255, 128, 128},  // Cyan, Orange, Purple, White, Light Red
+  {255,  64,  64}, { 64, 255,  64}, { 64,  64, 255}, {192, 192,   0}, {192,   0, 192},  // Light Red, Light Green, Light Blue, Dark Yellow, Dark Magenta
+  {  0, 192, 192}, {255, 192, 128}, {128, 255, 192}, {192, 128, 255}, {255, 255, 128},  // Dark Cyan, Peach, Mint, Lavender, Light Yellow
+  {128, 255, 255}, {255, 128, 255}, {255, 255, 192}, { 64, 128, 192}                    // Light Cyan, Light Magenta, Cream, Steel Blue
+};
+
+// Background for the press feedback frame, per grid column (index = (button - 1) % 5)
+static const uint8_t DEMO_COLUMN_BACKGROUND[LED_GRID_COLUMNS][3] = {
+  {0xfb, 0xfc, 0xfd}, {0xc9, 0xca, 0xcb}, {0x97, 0x98, 0x99}, {0x65, 0x66, 0x67}, {0x33, 0x34, 0x35}
+};
+
+// Every LED the same colour (setAllLEDs)
+inline void renderSolid(LedFrame& frame, uint8_t, uint8_t r, uint8_t g, uint8_t b) {
+  frame.fill(r, g, b);
+}
+
+// Column background from the working capture
+inline void renderColumnBackground(LedFrame& frame, uint8_t, uint8_t, uint8_t, uint8_t) {
+  for (uint8_t button = 1; button <= LED_COUNT; button++) {
+    const uint8_t* bg = DEMO_COLUMN_BACKGROUND[(button - 1) % LED_GRID_COLUMNS];
+    frame.set(button, bg[0], bg[1], bg[2]);
+  }
+}
+
+// Column background with the pressed button on top (sendSimpleLEDTest)
+inline void renderPressFeedback(LedFrame& frame, uint8_t button, uint8_t r, uint8_t g, uint8_t b) {
+  renderColumnBackground(frame, button, r, g, b);
+  frame.set(button, r, g, b);
+}
+
+typedef void (*LedEffectRender)(LedFrame& frame, uint8_t button, uint8_t r, uint8_t g, uint8_t b);
+
+struct LedEffect {
+  const char* name;
+  LedEffectRender render;
+};
+
+static const LedEffect LED_EFFECTS[] = {
+  {"solid", renderSolid},
+  {"column_background", renderColumnBackground},
+  {"press_feedback", renderPressFeedback},
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// ===== EVENT RECORDS =====
+// What the USB callbacks hand to loop(). A key edge is a 12-byte record, so
+// the queue copies 12 bytes per event instead of a whole 64-byte report. Raw
+// control reports that loop() may still want to look at are parked in a
+// fixed slab and the record carries a reference to the slot.
+
+enum ControlPadEventType : uint8_t {
+  EVENT_NONE = 0,
+  EVENT_KEY,          // Interface 0 key edge; code = HID usage, report = press ID (LATENCY_NO_ID on release)
+  EVENT_CTRL_KEY,     // Interface 1 key notification; code = device key index
+  EVENT_CTRL_REPORT,  // Any other interface 1 report; code = length, report = slab ref
+  EVENT_GESTURE       // Recognized gesture; code = GestureType, report = hold-repeat count
+};
+
+#define EVENT_EDGE_RELEASE 0
+#define EVENT_EDGE_PRESS   1
+
+struct controlpad_event {
+  uint8_t type;            // ControlPadEventType
+  uint8_t button;          // 1-24, KEYMAP_NO_BUTTON when unmapped or not a key
+  uint8_t edge;            // EVENT_EDGE_PRESS / EVENT_EDGE_RELEASE
+  uint8_t code;
+  uint16_t report;         // Slab ref, press correlation ID or repeat count, per type
+  uint32_t timestamp_us;   // micros() when the USB completion callback ran
+};
+
+static_assert(sizeof(controlpad_event) == 12, "event record should stay at 12 bytes");
+
+// ===== RAW REPORT SLAB =====
+// Ring of 64-byte slots written by the USB callbacks. put() returns a
+// reference made of the slot index and the slot's write sequence; get()
+// refuses references whose slot has been reused since, so a slow consumer
+// sees a lost report instead of a different one. Only the USB interrupt
+// writes, so there is a single producer.
+//
+// The interrupt can also reuse the slot while loop() is reading it, so get()
+// works like a seqlock reader: it copies the report out and checks the
+// sequence again afterwards, and a changed sequence means the copy may be
+// torn. put() bumps the sequence before touching the data, and an interrupt
+// always finishes before loop() resumes, so one check after the copy is
+// enough.
+
+#ifndef REPORT_SLAB_SLOTS
+#define REPORT_SLAB_SLOTS 16
+#endif
+
+#define REPORT_SLAB_NONE  0xFFFF
+#define REPORT_SLAB_BYTES 64
+
+class ReportSlab {
+public:
+  uint16_t put(const uint8_t* data, uint8_t len) {
+    if (len > sizeof(slots[0].data)) len = sizeof(slots[0].data);
+    uint8_t index = next;
+    next = (next + 1) % REPORT_SLAB_SLOTS;
+
+    Slot& slot = slots[index];
+    slot.seq++;               // Invalidate old references before the data changes
+    memcpy(slot.data, data, len);
+    slot.len = len;
+    return (uint16_t)(index | (slot.seq << 8));
+  }
+
+  // Copies the report into out (REPORT_SLAB_BYTES) and its length into len;
+  // false if the slot has been reused, before or during the copy
+  bool get(uint16_t ref, uint8_t* out, uint8_t* len) const {
+    uint8_t index = ref & 0xFF;
+    if (ref == REPORT_SLAB_NONE || index >= REPORT_SLAB_SLOTS) return false;
+    const Slot& slot = slots[index];
+    uint8_t seq = (uint8_t)(ref >> 8);
+    if (slot.seq != seq) return false;
+    __asm__ volatile("" ::: "memory");  // Copy after the first check...
+    uint8_t n = slot.len;
+    memcpy(out, slot.data, n);
+    __asm__ volatile("" ::: "memory");  // ...and before the second
+    if (slot.seq != seq) return false;
+    if (len) *len = n;
+    return true;
+  }
+
+private:
+  struct Slot {
+    uint8_t data[REPORT_SLAB_BYTES];
+    uint8_t len;
+    volatile uint8_t seq;
+  };
+
+  Slot slots[REPORT_SLAB_SLOTS] = {};
+  uint8_t next = 0;
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// ===== LOCK-FREE EVENT RING =====
+// Bounded multi-producer / single-consumer ring for the polling callbacks.
+// Every cell carries a sequence number (Vyukov's bounded queue): a producer
+// claims a position with one CAS on head, fills the cell and publishes it by
+// bumping the cell's sequence; the consumer only ever touches tail. Nothing
+// blocks and nothing allocates - storage is a static array sized at compile
+// time. A full ring drops the new event and counts it instead of stalling
+// the USB interrupt.
+
+template <typename T, uint32_t Capacity>
+class EventRing {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "ring capacity must be a power of two");
+
+public:
+  EventRing() {
+    for (uint32_t i = 0; i < Capacity; i++) {
+      cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Producer side, safe from any number of callbacks / interrupt levels
+  bool push(const T& value) {
+    uint32_t pos = head.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+      cell = &cells[pos & MASK];
+      uint32_t seq = cell->seq.load(std::memory_order_acquire);
+      int32_t diff = (int32_t)(seq - pos);
+      if (diff == 0) {
+        if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        dropped.fetch_add(1, std::memory_order_relaxed);  // Full
+        return false;
+      } else {
+        pos = head.load(std::memory_order_relaxed);       // Lost the race, retry
+      }
+    }
+
+    cell->value = value;
+    cell->seq.store(pos + 1, std::memory_order_release);
+
+    uint32_t depth = pos + 1 - tail.load(std::memory_order_relaxed);
+    uint32_t mark = high_water.load(std::memory_order_relaxed);
+    while (depth > mark && !high_water.compare_exchange_weak(mark, depth, std::memory_order_relaxed)) {}
+    return true;
+  }
+
+  // Consumer side, loop() only
+  bool pop(T& out) {
+    uint32_t pos = tail.load(std::memory_order_relaxed);
+    Cell& cell = cells[pos & MASK];
+    if (cell.seq.load(std::memory_order_acquire) != pos + 1) return false;  // Empty or still being written
+
+    out = cell.value;
+    cell.seq.store(pos + Capacity, std::memory_order_release);
+    tail.store(pos + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Consumer side: the oldest event without removing it
+  bool peek(T& out) const {
+    uint32_t pos = tail.load(std::memory_order_relaxed);
+    const Cell& cell = cells[pos & MASK];
+    if (cell.seq.load(std::memory_order_acquire) != pos + 1) return false;
+    out = cell.value;
+    return true;
+  }
+
+  uint32_t size() const {
+    return head.load(std::memory_order_relaxed) - tail.load(std::memory_order_relaxed);
+  }
+
+  static constexpr uint32_t capacity() { return Capacity; }
+  uint32_t highWater() const { return high_water.load(std::memory_order_relaxed); }
+  uint32_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+  static const uint32_t MASK = Capacity - 1;
+
+  struct Cell {
+    std::atomic<uint32_t> seq;
+    T value;
+  };
+
+  Cell cells[Capacity];
+  std::atomic<uint32_t> head{0};        // Next position to claim (producers)
+  std::atomic<uint32_t> tail{0};        // Next position to read (consumer)
+  std::atomic<uint32_t> high_water{0};  // Deepest the ring has been
+  std::atomic<uint32_t> dropped{0};     // Events refused because the ring was full
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stdint.h>
+#include "controlpad_led.h"
+#include "controlpad_stats.h"
+
+// ===== FRAME TRANSMIT =====
+// The five-packet LED frame the editor sends (mode, part 1, part 2, commit,
+// finalize) and the gaps it leaves between them, from the USB captures.
+// Nothing here reads a clock: the caller hands in the time and a port that
+// submits, so the same code runs on the Teensy (submitTransfer, micros) and
+// in the host tools against a simulated clock.
+
+#define LED_FRAME_PACKETS 5
+#define LED_FRAME_COMMIT  3   // Index of the 41 80 packet
+
+// Wait after each packet but the last, in ms
+static const uint8_t LED_FRAME_PACE_MS[LED_FRAME_PACKETS - 1] = {12, 11, 12, 9};
+
+// ===== PACED FRAME TRANSMIT =====
+// loop() sends LED frames through FramePacer instead of waiting out the gaps.
+// The LED handler queues a frame and returns; service(), called on every
+// loop() pass, submits each packet once the gap after the previous one has
+// passed. One frame is in flight and at most one waits behind it. A frame
+// queued while another is still waiting replaces it, since only the newest
+// LED state is worth showing, so a burst of presses never builds a backlog.
+
+struct PacedFrame {
+  uint8_t packets[LED_FRAME_PACKETS][LED_PACKET_LEN];
+  uint16_t corr_id;     // Press this frame answers, for the latency tracker; 0 = none
+  uint32_t press_us;    // That press's event time
+  uint32_t queued_us;   // When the LED handler queued the frame
+};
+
+class FramePacer {
+public:
+  // Slot to render the next frame into, then queue() it. A frame that is
+  // still waiting lives in this slot and is replaced; check waitingFrame()
+  // before rendering over it.
+  PacedFrame& next() { return slots[cur ^ 1]; }
+  const PacedFrame* waitingFrame() const { return waiting ? &slots[cur ^ 1] : nullptr; }
+  void queue() { waiting = true; }
+
+  // Submits what is due at now_us through the port:
+  //   port.start(frame)                 a frame begins going out
+  //   port.submit(index, packet, frame) 0 when the USB host took the packet
+  //   port.refused(frame, index, status) the rest of that frame is dropped
+  // A frame that finishes lets the waiting one start in the same call.
+  template <typename Port>
+  void service(uint32_t now_us, Port& port) {
+    for (;;) {
+      if (!inFlight) {
+        if (!waiting) return;
+        cur ^= 1;
+        waiting = false;
+        inFlight = true;
+        index = 0;
+        port.start(slots[cur]);
+      } else if ((int32_t)(now_us - due_us) < 0) {
+        return;
+      }
+      PacedFrame& f = slots[cur];
+      int result = port.submit(index, f.packets[index], f);
+      if (result != 0) {
+        inFlight = false;
+        port.refused(f, index, result);
+        continue;
+      }
+      if (++index == LED_FRAME_PACKETS) {
+        inFlight = false;
+      } else {
+        due_us = now_us + LED_FRAME_PACE_MS[index - 1] * 1000u;
+      }
+    }
+  }
+
+  bool busy() const { return inFlight || waiting; }
+
+  // When service() next has a packet to submit; only meaningful while busy()
+  uint32_t dueUs(uint32_t now_us) const { return inFlight ? due_us : now_us; }
+
+  // Forget both frames, e.g. on detach
+  void clear() { inFlight = waiting = false; }
+
+private:
+  PacedFrame slots[2];
+  uint8_t cur = 0;         // slots[cur] is in flight, slots[cur ^ 1] waits
+  uint8_t index = 0;       // Next packet of the frame in flight
+  bool inFlight = false;
+  bool waiting = false;
+  uint32_t due_us = 0;
+};
+
+// ===== FRAME ACCOUNTING =====
+// Follows the OUT stream into DriverStats: 56 83 00 opens a frame, 41 80
+// sends it. A frame abandoned by the next one or by a refused packet counts
+// as suppressed. Intervals are wrap-safe differences of the 32-bit clock, so
+// they stay right across the micros() rollover as long as frames are less
+// than 71 minutes apart; the first commit is marked with a flag rather than
+// last_commit_us == 0, which is a valid time once the clock has wrapped.
+
+class FrameAccounting {
+public:
+  void note(const uint8_t* cmd, bool accepted, uint32_t now_us, DriverStats& st) {
+    if (cmd[0] == 0x56 && cmd[1] == 0x83 && cmd[2] == 0x00) {
+      if (open) st.frames_suppressed.inc();  // Previous frame never committed
+      st.frames_rendered.inc();
+      open = accepted;
+      if (!accepted) st.frames_suppressed.inc();
+    } else if (cmd[0] == 0x41 && cmd[1] == 0x80 && open) {
+      open = false;
+      if (!accepted) {
+        st.frames_suppressed.inc();
+        return;
+      }
+      st.frames_sent.inc();
+      if (committed) {
+        uint32_t interval = now_us - st.last_commit_us.get();
+        st.frame_interval_us.set(interval);
+        st.frame_interval_max_us.max(interval);
+      }
+      committed = true;
+      st.last_commit_us.set(now_us);
+    }
+  }
+
+  bool frameOpen() const { return open; }
+
+private:
+  bool open = false;        // A 56 83 00 went out without its commit yet
+  bool committed = false;   // last_commit_us holds a real commit time
+};
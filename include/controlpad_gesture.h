@@ -0,0 +1,198 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "controlpad_event.h"
+#include "controlpad_keymap.h"
+
+// ===== GESTURE RECOGNIZER =====
+// One small state machine per button, fed with the timestamped press/release
+// edges from the event queue and clocked by tick() from loop():
+//
+//   tap         press + release shorter than tap_max_us, no second press
+//               within double_tap_gap_us
+//   double-tap  second press within double_tap_gap_us of a tap's release
+//               (fires on that press, the matching release is swallowed)
+//   long-press  held for long_press_us
+//   hold-repeat every repeat_interval_us after a long-press while still held,
+//               starting repeat_delay_us after the long-press
+//
+// A press longer than a tap but released before long_press_us yields nothing.
+// Setting double_tap_gap_us to 0 makes taps fire on release with no wait.
+//
+// Gestures are stamped with the time they logically happened (the edge or
+// the threshold crossing), not when tick() noticed. tick() only visits
+// buttons with a pending deadline and does at most two steps per button, so
+// its cost is bounded by the 24 buttons. Setting repeat_interval_us to 0
+// disables hold-repeat. The repeat count saturates at 65535 instead of
+// wrapping back to 0. Everything is statically sized.
+
+enum GestureType : uint8_t {
+  GESTURE_TAP = 1,
+  GESTURE_DOUBLE_TAP,
+  GESTURE_LONG_PRESS,
+  GESTURE_HOLD_REPEAT
+};
+
+struct GestureConfig {
+  uint32_t tap_max_us = 250000;
+  uint32_t double_tap_gap_us = 300000;
+  uint32_t long_press_us = 600000;
+  uint32_t repeat_delay_us = 400000;
+  uint32_t repeat_interval_us = 100000;
+};
+
+class GestureRecognizer {
+public:
+  GestureRecognizer() { reset(); }
+
+  void reset() {
+    memset(buttons, 0, sizeof(buttons));
+    pending = 0;
+  }
+
+  void setConfig(const GestureConfig& c) { config = c; }
+  const GestureConfig& getConfig() const { return config; }
+
+  static const char* name(uint8_t gesture) {
+    switch (gesture) {
+      case GESTURE_TAP:         return "TAP";
+      case GESTURE_DOUBLE_TAP:  return "DOUBLE TAP";
+      case GESTURE_LONG_PRESS:  return "LONG PRESS";
+      case GESTURE_HOLD_REPEAT: return "HOLD REPEAT";
+      default:                  return "?";
+    }
+  }
+
+  // Feed one key edge. emit(const controlpad_event&) receives any gesture
+  // the edge completes.
+  template <typename Emit>
+  void onKey(uint8_t button, bool pressed, uint32_t us, Emit emit) {
+    if (button == KEYMAP_NO_BUTTON || button > CONTROLPAD_BUTTON_COUNT) return;
+    Button& b = buttons[button - 1];
+
+    if (pressed) {
+      switch (b.state) {
+        case WAIT_SECOND:
+          if ((int32_t)(us - b.deadline_us) < 0) {
+            emitGesture(emit, button, GESTURE_DOUBLE_TAP, 0, us);
+            setState(button, SWALLOW, 0);
+            return;
+          }
+          // Gap already over but tick() has not run yet: settle the tap first
+          emitGesture(emit, button, GESTURE_TAP, 0, b.deadline_us);
+          break;
+        case IDLE:
+          break;
+        default:
+          return;  // Duplicate press edge
+      }
+      b.press_us = us;
+      b.repeats = 0;
+      setState(button, DOWN, us + config.long_press_us);
+      return;
+    }
+
+    switch (b.state) {
+      case DOWN:
+        if (us - b.press_us < config.tap_max_us) {
+          if (config.double_tap_gap_us == 0) {
+            emitGesture(emit, button, GESTURE_TAP, 0, us);
+            setState(button, IDLE, 0);
+          } else {
+            setState(button, WAIT_SECOND, us + config.double_tap_gap_us);
+          }
+        } else {
+          setState(button, IDLE, 0);
+        }
+        break;
+      case HELD:
+      case SWALLOW:
+        setState(button, IDLE, 0);
+        break;
+      default:
+        break;
+    }
+  }
+
+  // Fire every threshold that has passed by now_us
+  template <typename Emit>
+  void tick(uint32_t now_us, Emit emit) {
+    uint32_t due = pending;
+    while (due) {
+      uint8_t i = __builtin_ctz(due);
+      due &= due - 1;
+      Button& b = buttons[i];
+      uint8_t button = i + 1;
+
+      // At most long-press + one repeat per button per tick; repeats missed
+      // while loop() was busy are dropped rather than replayed in a burst
+      for (uint8_t step = 0; step < 2 && (pending & (1u << i)) && (int32_t)(now_us - b.deadline_us) >= 0; step++) {
+        uint32_t at = b.deadline_us;
+        switch (b.state) {
+          case DOWN:
+            emitGesture(emit, button, GESTURE_LONG_PRESS, 0, at);
+            if (config.repeat_interval_us) {
+              setState(button, HELD, at + config.repeat_delay_us);
+            } else {
+              setState(button, SWALLOW, 0);  // Hold-repeat disabled
+            }
+            break;
+          case HELD:
+            if (b.repeats < UINT16_MAX) b.repeats++;  // Sticks at 65535 (1.8 h at 100 ms)
+            emitGesture(emit, button, GESTURE_HOLD_REPEAT, b.repeats, at);
+            b.deadline_us = at + config.repeat_interval_us;
+            if ((int32_t)(now_us - b.deadline_us) >= 0) b.deadline_us = now_us + config.repeat_interval_us;
+            break;
+          case WAIT_SECOND:
+            emitGesture(emit, button, GESTURE_TAP, 0, at);
+            setState(button, IDLE, 0);
+            break;
+          default:
+            setState(button, IDLE, 0);
+            break;
+        }
+      }
+    }
+  }
+
+  bool busy() const { return pending != 0; }
+
+private:
+  enum State : uint8_t {
+    IDLE = 0,
+    DOWN,          // Pressed, waiting to see tap vs long-press
+    WAIT_SECOND,   // Tap released, waiting for a possible second press
+    HELD,          // Long-press fired, repeating while held
+    SWALLOW        // Gesture already emitted, ignore until release
+  };
+
+  struct Button {
+    State state;
+    uint16_t repeats;
+    uint32_t press_us;
+    uint32_t deadline_us;   // Next threshold; valid while the pending bit is set
+  };
+
+  void setState(uint8_t button, State s, uint32_t deadline_us) {
+    Button& b = buttons[button - 1];
+    b.state = s;
+    b.deadline_us = deadline_us;
+    uint32_t bit = 1u << (button - 1);
+    if (s == DOWN || s == WAIT_SECOND || s == HELD) {
+      pending |= bit;
+    } else {
+      pending &= ~bit;
+    }
+  }
+
+  template <typename Emit>
+  static void emitGesture(Emit& emit, uint8_t button, GestureType g, uint16_t repeat, uint32_t us) {
+    controlpad_event event = {EVENT_GESTURE, button, EVENT_EDGE_PRESS, g, repeat, us};
+    emit(event);
+  }
+
+  GestureConfig config;
+  Button buttons[CONTROLPAD_BUTTON_COUNT];
+  uint32_t pending;         // Bit n = button n+1 has a deadline
+};
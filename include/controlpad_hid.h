@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// ===== HID BOOT KEYBOARD REPORT DECODING =====
+// Interface 0 sends standard 8-byte boot reports:
+//   [0] modifier bits (usages 0xE0-0xE7), [1] reserved, [2..7] up to six usages.
+// The decoder keeps the previous key state as a 256-bit usage bitmap and diffs
+// every new report against it, so simultaneous presses and all releases come
+// out as discrete events. No allocation; the caller provides the output array.
+
+#define HID_REPORT_LEN      8
+#define HID_MAX_KEY_EVENTS  20   // 8 modifier edges + 6 releases + 6 presses
+
+#define HID_USAGE_NONE      0x00
+#define HID_USAGE_ROLLOVER  0x01  // ErrorRollOver: too many keys, report carries no state
+#define HID_USAGE_ERROR_LAST 0x03 // 0x02 POSTFail, 0x03 ErrorUndefined: no state either
+#define HID_USAGE_MOD_FIRST 0xE0
+
+struct HidKeyEvent {
+  uint8_t usage;
+  bool pressed;              // false = released
+  uint32_t timestamp_us;     // When the report arrived (completion callback time)
+};
+
+class HidReportDecoder {
+public:
+  HidReportDecoder() { reset(); }
+
+  void reset() { memset(state, 0, sizeof(state)); }
+
+  bool isDown(uint8_t usage) const {
+    return state[usage >> 5] & (1u << (usage & 31));
+  }
+
+  // Diff a report against the previous one. Returns the number of events
+  // written to out (at most HID_MAX_KEY_EVENTS), presses and releases in
+  // ascending usage order, all stamped with timestamp_us. Short reports and
+  // error reports (rollover, POST fail, undefined error in the first slot)
+  // leave the state untouched; an error usage in a later slot is not a key.
+  uint8_t decode(const uint8_t* report, uint8_t len, uint32_t timestamp_us, HidKeyEvent* out) {
+    if (len < HID_REPORT_LEN) return 0;
+    if (isErrorUsage(report[2])) return 0;
+
+    uint32_t next[8] = {0};
+    next[HID_USAGE_MOD_FIRST >> 5] = (uint32_t)report[0] << (HID_USAGE_MOD_FIRST & 31);
+    for (uint8_t i = 2; i < HID_REPORT_LEN; i++) {
+      uint8_t usage = report[i];
+      if (usage > HID_USAGE_ERROR_LAST) {
+        next[usage >> 5] |= 1u << (usage & 31);
+      }
+    }
+
+    uint8_t count = 0;
+    for (uint8_t w = 0; w < 8; w++) {
+      uint32_t changed = next[w] ^ state[w];
+      while (changed) {
+        uint8_t bit = __builtin_ctz(changed);
+        changed &= changed - 1;
+        out[count].usage = (uint8_t)(w * 32 + bit);
+        out[count].pressed = (next[w] >> bit) & 1;
+        out[count].timestamp_us = timestamp_us;
+        count++;
+      }
+      state[w] = next[w];
+    }
+    return count;
+  }
+
+  static bool isErrorUsage(uint8_t usage) {
+    return usage >= HID_USAGE_ROLLOVER && usage <= HID_USAGE_ERROR_LAST;
+  }
+
+private:
+  uint32_t state[8];         // Bit n set = usage n currently held
+};
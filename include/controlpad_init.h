@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// ===== INIT SEQUENCE =====
+// Commands the driver sends on EP 0x04 after enumeration, taken from
+// bootup_sequencer_control_pad_editor.txt. Each is a 64-byte packet whose
+// leading bytes are listed here and the rest is zero; the device echoes every
+// one on EP 0x83. The fast-boot profile leaves out the skippable steps.
+//
+// No Arduino dependencies, so the host emulator replays the same table.
+
+#define INIT_COMMAND_LEN 64
+
+struct ControlPadInitStep {
+  uint8_t header[16];   // Leading command bytes, rest of the 64-byte packet is zero
+  uint8_t repeat;       // >1: byte 2 is an index running 0..repeat-1
+  bool skippable;       // Not required for custom-mode LED control
+  const char* label;
+};
+
+constexpr ControlPadInitStep CONTROLPAD_INIT_STEPS[] = {
+  {{0x42, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x01}, 1,  false, "42 00"},
+  {{0x42, 0x10, 0x00, 0x00, 0x01, 0x00, 0x00, 0x01}, 1,  false, "42 10"},
+  {{0x43, 0x00, 0x00, 0x00, 0x01}, 1,  false, "43 00"},
+  {{0x41, 0x80}, 1,  false, "commit"},
+  {{0x52, 0x80}, 24, true,  "profiles 52 80"},
+  {{0x56, 0x81, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0xbb, 0xbb, 0xbb, 0xbb}, 1, false, "custom mode"},
+};
+
+constexpr uint8_t INIT_STEP_COUNT = sizeof(CONTROLPAD_INIT_STEPS) / sizeof(CONTROLPAD_INIT_STEPS[0]);
+
+// Packet for repetition `repeat` of a step
+inline void buildInitCommand(const ControlPadInitStep& step, uint8_t repeat, uint8_t* out) {
+  memset(out, 0, INIT_COMMAND_LEN);
+  memcpy(out, step.header, sizeof(step.header));
+  if (step.repeat > 1) {
+    out[2] = repeat;  // Indexed command, e.g. profile 52 80 00..17
+  }
+}
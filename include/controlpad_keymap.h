@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// ===== HID USAGE <-> BUTTON KEYMAP =====
+// Interface 0 reports keys as HID usages. The default mapping comes from
+// "breakdown of 5 commands to set 24 leds.txt":
+//
+//   [01] 1E  [02] 1F  [03] 20  [04] 21  [05] 22
+//   [06] 23  [07] 24  [08] 25  [09] 26  [10] 27
+//   [11] 04  [12] 05  [13] 06  [14] 07  [15] 08
+//   [16] 09  [17] 0A  [18] 0B  [19] 0C  [20] 0D
+//   [21] 0E  [22] 0F  [23] 10     [24] 11
+//
+// Button 21 is listed as 0x00 in the breakdown. That usage means "no key" in a
+// boot report, and 0x0E is the only gap in the 0x04-0x11 run, so 0x0E it is.
+//
+// Both directions are flat tables, so a lookup is a single load. Buttons are
+// numbered 1-24; 0 (KEYMAP_NO_BUTTON) marks an unmapped usage.
+
+#define CONTROLPAD_BUTTON_COUNT 24
+#define KEYMAP_NO_BUTTON        0
+
+struct KeymapTable {
+  uint8_t usage_to_button[256];
+  uint8_t button_to_usage[CONTROLPAD_BUTTON_COUNT + 1];  // [0] unused
+};
+
+// Build both directions from a button -> usage list (index 0 ignored)
+constexpr KeymapTable makeKeymap(const uint8_t (&usages)[CONTROLPAD_BUTTON_COUNT + 1]) {
+  KeymapTable t{};
+  for (int b = 1; b <= CONTROLPAD_BUTTON_COUNT; b++) {
+    t.button_to_usage[b] = usages[b];
+    t.usage_to_button[usages[b]] = (uint8_t)b;
+  }
+  return t;
+}
+
+// A keymap is valid when every button has a distinct real key usage, the two
+// tables are exact inverses and nothing else maps to a button
+constexpr bool keymapValid(const KeymapTable& t) {
+  if (t.button_to_usage[0] != 0 || t.usage_to_button[0x00] != KEYMAP_NO_BUTTON) return false;
+  int mapped = 0;
+  for (int u = 0; u < 256; u++) {
+    uint8_t b = t.usage_to_button[u];
+    if (b == KEYMAP_NO_BUTTON) continue;
+    if (b > CONTROLPAD_BUTTON_COUNT || t.button_to_usage[b] != u) return false;
+    mapped++;
+  }
+  for (int b = 1; b <= CONTROLPAD_BUTTON_COUNT; b++) {
+    uint8_t u = t.button_to_usage[b];
+    if (u <= 0x03 || t.usage_to_button[u] != b) return false;  // 00-03: none/error usages
+  }
+  return mapped == CONTROLPAD_BUTTON_COUNT;
+}
+
+constexpr uint8_t DEFAULT_BUTTON_USAGES[CONTROLPAD_BUTTON_COUNT + 1] = {
+  0x00,
+  0x1E, 0x1F, 0x20, 0x21, 0x22,
+  0x23, 0x24, 0x25, 0x26, 0x27,
+  0x04, 0x05, 0x06, 0x07, 0x08,
+  0x09, 0x0A, 0x0B, 0x0C, 0x0D,
+  0x0E, 0x0F, 0x10, 0x11
+};
+
+constexpr KeymapTable DEFAULT_KEYMAP = makeKeymap(DEFAULT_BUTTON_USAGES);
+
+static_assert(keymapValid(DEFAULT_KEYMAP), "default keymap must be a bijection between 24 buttons and key usages");
+static_assert(DEFAULT_KEYMAP.usage_to_button[0x00] == KEYMAP_NO_BUTTON, "usage 0x00 (no key) must not map to a button");
+static_assert(DEFAULT_KEYMAP.usage_to_button[0x1E] == 1 && DEFAULT_KEYMAP.button_to_usage[24] == 0x11, "corner buttons");
+static_assert(DEFAULT_KEYMAP.usage_to_button[0x0E] == 21, "button 21 sits in the 0x0E gap");
+
+// Runtime keymap: starts as a copy of DEFAULT_KEYMAP and can be replaced
+// wholesale by copying in another validated table
+class Keymap {
+public:
+  Keymap() : table(DEFAULT_KEYMAP) {}
+
+  uint8_t button(uint8_t usage) const { return table.usage_to_button[usage]; }
+
+  uint8_t usage(uint8_t button) const {
+    return button <= CONTROLPAD_BUTTON_COUNT ? table.button_to_usage[button] : 0;
+  }
+
+  bool load(const KeymapTable& override_table) {
+    if (!keymapValid(override_table)) return false;
+    memcpy(&table, &override_table, sizeof(table));
+    return true;
+  }
+
+  bool load(const uint8_t (&usages)[CONTROLPAD_BUTTON_COUNT + 1]) {
+    return load(makeKeymap(usages));
+  }
+
+  void reset() { memcpy(&table, &DEFAULT_KEYMAP, sizeof(table)); }
+
+private:
+  KeymapTable table;
+};
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// ===== PRESS-TO-LIGHT LATENCY =====
+// Follows one key press from the kbd_poll completion to the completion of the
+// 41 80 commit that lights its LED. kbd_poll hands every press a correlation
+// ID that travels in the event record; the LED path opens a sample with it,
+// marks the commit submission and the commit's send callback closes it:
+//
+//   press    kbd_poll completion (event timestamp)
+//   render   LED handler picked the event up in loop()
+//   submit   commit (41 80) handed to the USB host
+//   done     commit completion callback
+//
+// The LED path sends one frame at a time, so a single in-flight slot is
+// enough; a completion whose ID does not match the open sample is counted as
+// an orphan instead of being attributed to the wrong press.
+//
+// The distribution goes into a log-linear histogram (8 sub-buckets per power
+// of two, <= 12.5% error) so p99 over the whole run costs 1 KB and no sorting.
+
+#define LATENCY_SUB_BITS     3
+#define LATENCY_SUB_BUCKETS  (1u << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS      (32 * LATENCY_SUB_BUCKETS)
+#define LATENCY_NO_ID        0
+
+struct LatencyStage {
+  uint32_t count = 0;
+  uint32_t min_us = UINT32_MAX;
+  uint32_t max_us = 0;
+  uint64_t total_us = 0;
+
+  void add(uint32_t us) {
+    count++;
+    total_us += us;
+    if (us < min_us) min_us = us;
+    if (us > max_us) max_us = us;
+  }
+
+  uint32_t mean_us() const { return count ? (uint32_t)(total_us / count) : 0; }
+};
+
+class LatencyHistogram {
+public:
+  void reset() { memset(buckets, 0, sizeof(buckets)); total = 0; }
+
+  void add(uint32_t us) {
+    buckets[bucketOf(us)]++;
+    total++;
+  }
+
+  uint32_t count() const { return total; }
+
+  // Upper edge of the bucket holding the given percentile (0-100)
+  uint32_t percentile(uint8_t pct) const {
+    if (total == 0) return 0;
+    uint64_t target = ((uint64_t)total * pct + 99) / 100;
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (uint16_t i = 0; i < LATENCY_BUCKETS; i++) {
+      seen += buckets[i];
+      if (seen >= target) return bucketUpper(i);
+    }
+    return UINT32_MAX;
+  }
+
+  static uint16_t bucketOf(uint32_t us) {
+    if (us < LATENCY_SUB_BUCKETS) return (uint16_t)us;
+    uint8_t msb = 31 - __builtin_clz(us);
+    uint8_t sub = (us >> (msb - LATENCY_SUB_BITS)) & (LATENCY_SUB_BUCKETS - 1);
+    return (uint16_t)((msb - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS + sub);
+  }
+
+  static uint32_t bucketUpper(uint16_t bucket) {
+    if (bucket < LATENCY_SUB_BUCKETS) return bucket;
+    uint8_t msb = bucket / LATENCY_SUB_BUCKETS + LATENCY_SUB_BITS - 1;
+    uint32_t sub = bucket % LATENCY_SUB_BUCKETS;
+    uint64_t lower = ((uint64_t)(LATENCY_SUB_BUCKETS + sub)) << (msb - LATENCY_SUB_BITS);
+    uint64_t upper = lower + (1ull << (msb - LATENCY_SUB_BITS)) - 1;
+    return upper > UINT32_MAX ? UINT32_MAX : (uint32_t)upper;
+  }
+
+private:
+  uint32_t buckets[LATENCY_BUCKETS] = {};
+  uint32_t total = 0;
+};
+
+class PressToLightTracker {
+public:
+  // LED handler starts rendering the press with this ID
+  void begin(uint16_t id, uint32_t press_us, uint32_t now_us) {
+    if (open) abandoned++;       // Previous frame never committed
+    open = true;
+    open_id = id;
+    t_press = press_us;
+    t_render = now_us;
+    submitted = false;
+  }
+
+  // The commit for the open sample has been submitted
+  void submit(uint32_t now_us) {
+    if (open) {
+      t_submit = now_us;
+      submitted = true;
+    }
+  }
+
+  // Rendering gave up before a commit was submitted
+  void cancel() {
+    if (open) abandoned++;
+    open = false;
+  }
+
+  // Commit completion callback; ok = transfer succeeded
+  void complete(uint16_t id, uint32_t now_us, bool ok) {
+    if (!open || id != open_id || !submitted) {
+      orphans++;
+      return;
+    }
+    open = false;
+    if (!ok) {
+      failed++;
+      return;
+    }
+    uint32_t total = now_us - t_press;
+    press_to_render.add(t_render - t_press);
+    render_to_submit.add(t_submit - t_render);
+    submit_to_done.add(now_us - t_submit);
+    press_to_light.add(total);
+    histogram.add(total);
+    last_us = total;
+  }
+
+  void reset() {
+    press_to_render = LatencyStage();
+    render_to_submit = LatencyStage();
+    submit_to_done = LatencyStage();
+    press_to_light = LatencyStage();
+    histogram.reset();
+    orphans = abandoned = failed = 0;
+    last_us = 0;
+  }
+
+  uint32_t p99() const { return histogram.percentile(99); }
+  uint32_t p50() const { return histogram.percentile(50); }
+
+  LatencyStage press_to_render;
+  LatencyStage render_to_submit;
+  LatencyStage submit_to_done;
+  LatencyStage press_to_light;
+  LatencyHistogram histogram;
+  uint32_t orphans = 0;     // Completions with no matching open sample
+  uint32_t abandoned = 0;   // Samples replaced or cancelled before their commit
+  uint32_t failed = 0;      // Commits that completed with an error
+  uint32_t last_us = 0;
+
+private:
+  volatile bool open = false;
+  uint16_t open_id = LATENCY_NO_ID;
+  uint32_t t_press = 0;
+  uint32_t t_render = 0;
+  uint32_t t_submit = 0;
+  volatile bool submitted = false;  // Not t_submit != 0: micros() passes 0 every 71 minutes
+};
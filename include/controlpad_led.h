@@ -0,0 +1,175 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// ===== LED PROTOCOL =====
+// Encoder and decoder for the interface 1 LED commands. The official editor
+// sends one frame as five 64-byte OUT packets on EP 0x04:
+//
+//   56 81 00 00 01 00 00 00 02 00 00 00 bb bb bb bb   custom mode
+//   56 83 00 00 01 00 00 00 80 01 00 00 ff 00 00 00   LED data, part 1
+//   00 00 ff BR 00 00 00 00 | RGB from byte 24         (BR = brightness)
+//   56 83 01 00 | RGB from byte 4                      LED data, part 2
+//   41 80 00 ...                                       commit
+//   51 28 00 00 ff 00 ...                              finalize
+//
+// The RGB data is one 72-byte stream of 24 slots, 40 bytes in part 1 (bytes
+// 24-63) and 32 in part 2 (bytes 4-35). Slot 13 straddles the two packets: R
+// is the last byte of part 1, G and B open part 2. Slots run column by column
+// over the 5x5 grid (buttons 1, 6, 11, 16, 21, 2, 7, ...); the 25th grid
+// position has no button and no slot.
+//
+// No Arduino dependencies: the host tools in tools/ build against this header.
+
+#define LED_PACKET_LEN     64
+#define LED_COUNT          24
+#define LED_GRID_COLUMNS   5
+#define LED_PART1_OFFSET   24   // First RGB byte in part 1
+#define LED_PART2_OFFSET   4    // First RGB byte in part 2
+#define LED_PART1_BYTES    (LED_PACKET_LEN - LED_PART1_OFFSET)
+#define LED_STREAM_BYTES   (LED_COUNT * 3)
+#define LED_BRIGHTNESS_POS 19   // Part 1 header byte; 0xFF = full
+
+enum LedCommand : uint8_t {
+  LED_CMD_MODE,       // 56 81
+  LED_CMD_PART1,      // 56 83 00
+  LED_CMD_PART2,      // 56 83 01
+  LED_CMD_COMMIT,     // 41 80
+  LED_CMD_FINALIZE,   // 51 28
+  LED_CMD_OTHER
+};
+
+inline const char* ledCommandName(uint8_t c) {
+  switch (c) {
+    case LED_CMD_MODE:     return "mode";
+    case LED_CMD_PART1:    return "part1";
+    case LED_CMD_PART2:    return "part2";
+    case LED_CMD_COMMIT:   return "commit";
+    case LED_CMD_FINALIZE: return "finalize";
+    default:               return "other";
+  }
+}
+
+inline LedCommand ledCommandOf(const uint8_t* p, uint8_t len) {
+  if (len < 3) return LED_CMD_OTHER;
+  if (p[0] == 0x56 && p[1] == 0x81) return LED_CMD_MODE;
+  if (p[0] == 0x56 && p[1] == 0x83 && p[2] == 0x00) return LED_CMD_PART1;
+  if (p[0] == 0x56 && p[1] == 0x83 && p[2] == 0x01) return LED_CMD_PART2;
+  if (p[0] == 0x41 && p[1] == 0x80) return LED_CMD_COMMIT;
+  if (p[0] == 0x51 && p[1] == 0x28) return LED_CMD_FINALIZE;
+  return LED_CMD_OTHER;
+}
+
+// Stream slot for button 1-24; column-major over the 5-wide grid
+constexpr uint8_t ledSlot(uint8_t button) {
+  return (uint8_t)(((button - 1) % LED_GRID_COLUMNS) * LED_GRID_COLUMNS + (button - 1) / LED_GRID_COLUMNS);
+}
+
+constexpr uint8_t ledButtonAt(uint8_t slot) {
+  return (uint8_t)((slot % LED_GRID_COLUMNS) * LED_GRID_COLUMNS + slot / LED_GRID_COLUMNS + 1);
+}
+
+static_assert(ledSlot(1) == 0 && ledSlot(6) == 1 && ledSlot(2) == 5 && ledSlot(4) == 15 && ledSlot(5) == 20,
+              "slots follow the captured column order");
+static_assert(ledSlot(18) == 13 && ledButtonAt(13) == 18, "slot 13 straddles the packets");
+static_assert(ledSlot(20) == 23 && ledSlot(24) == 19, "button 20 takes the last slot");
+
+struct LedFrame {
+  uint8_t rgb[LED_COUNT][3];   // By button - 1
+  uint8_t brightness;
+
+  LedFrame() { clear(); }
+
+  void clear() {
+    memset(rgb, 0, sizeof(rgb));
+    brightness = 0xFF;
+  }
+
+  void set(uint8_t button, uint8_t r, uint8_t g, uint8_t b) {
+    if (button < 1 || button > LED_COUNT) return;
+    rgb[button - 1][0] = r;
+    rgb[button - 1][1] = g;
+    rgb[button - 1][2] = b;
+  }
+
+  void fill(uint8_t r, uint8_t g, uint8_t b) {
+    for (uint8_t i = 1; i <= LED_COUNT; i++) set(i, r, g, b);
+  }
+
+  bool operator==(const LedFrame& o) const {
+    return brightness == o.brightness && memcmp(rgb, o.rgb, sizeof(rgb)) == 0;
+  }
+  bool operator!=(const LedFrame& o) const { return !(*this == o); }
+};
+
+// ----- Encoders: each writes a full 64-byte packet -----
+
+inline void encodeLedMode(uint8_t* out) {
+  static const uint8_t head[16] = {0x56, 0x81, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+                                   0x02, 0x00, 0x00, 0x00, 0xbb, 0xbb, 0xbb, 0xbb};
+  memset(out, 0, LED_PACKET_LEN);
+  memcpy(out, head, sizeof(head));
+}
+
+// part 0 or 1 of the frame's RGB stream
+inline void encodeLedData(const LedFrame& frame, uint8_t part, uint8_t* out) {
+  memset(out, 0, LED_PACKET_LEN);
+  out[0] = 0x56;
+  out[1] = 0x83;
+  out[2] = part;
+  if (part == 0) {
+    static const uint8_t head[12] = {0x01, 0x00, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00};
+    memcpy(out + 4, head, sizeof(head));
+    out[18] = 0xff;
+    out[LED_BRIGHTNESS_POS] = frame.brightness;
+  }
+  uint8_t first = part == 0 ? 0 : LED_PART1_BYTES;
+  uint8_t last = part == 0 ? LED_PART1_BYTES : LED_STREAM_BYTES;
+  uint8_t* dst = out + (part == 0 ? LED_PART1_OFFSET : LED_PART2_OFFSET);
+  for (uint8_t i = first; i < last; i++) {
+    uint8_t slot = i / 3;
+    *dst++ = frame.rgb[ledButtonAt(slot) - 1][i % 3];
+  }
+}
+
+inline void encodeLedCommit(uint8_t* out) {
+  memset(out, 0, LED_PACKET_LEN);
+  out[0] = 0x41;
+  out[1] = 0x80;
+}
+
+inline void encodeLedFinalize(uint8_t* out) {
+  memset(out, 0, LED_PACKET_LEN);
+  out[0] = 0x51;
+  out[1] = 0x28;
+  out[4] = 0xff;
+}
+
+// All five packets of one frame, in send order
+inline void encodeLedFrame(const LedFrame& frame, uint8_t out[5][LED_PACKET_LEN]) {
+  encodeLedMode(out[0]);
+  encodeLedData(frame, 0, out[1]);
+  encodeLedData(frame, 1, out[2]);
+  encodeLedCommit(out[3]);
+  encodeLedFinalize(out[4]);
+}
+
+// ----- Decoder -----
+
+// Apply a 56 83 data packet to frame; false if it is not one. Only the bytes
+// that packet carries are touched, so part 1 then part 2 rebuilds a frame.
+inline bool decodeLedData(const uint8_t* p, uint8_t len, LedFrame& frame) {
+  LedCommand c = ledCommandOf(p, len);
+  if ((c != LED_CMD_PART1 && c != LED_CMD_PART2) || len < LED_PACKET_LEN) return false;
+  uint8_t part = c == LED_CMD_PART1 ? 0 : 1;
+  if (part == 0) frame.brightness = p[LED_BRIGHTNESS_POS];
+  uint8_t first = part == 0 ? 0 : LED_PART1_BYTES;
+  uint8_t last = part == 0 ? LED_PART1_BYTES : LED_STREAM_BYTES;
+  const uint8_t* src = p + (part == 0 ? LED_PART1_OFFSET : LED_PART2_OFFSET);
+  for (uint8_t i = first; i < last; i++) {
+    uint8_t slot = i / 3;
+    frame.rgb[ledButtonAt(slot) - 1][i % 3] = *src++;
+  }
+  return true;
+}
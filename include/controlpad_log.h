@@ -0,0 +1,76 @@
+#pragma once
+
+// ===== LOGGING =====
+// Serial logging with a compile-time level and per-subsystem switches.
+//
+//   LOG_ERROR / LOG_WARN / LOG_INFO / LOG_DEBUG / LOG_TRACE (subsystem, fmt, ...)
+//
+// A call below CONTROLPAD_LOG_LEVEL, or in a subsystem built with its
+// CONTROLPAD_LOG_<SUB> switch at 0, sits behind an `if` on a constant false
+// expression: the compiler still type-checks the arguments, but neither the
+// call nor the format string ends up in the firmware. The default level
+// (DEBUG) keeps today's output; build with
+//   -D CONTROLPAD_LOG_LEVEL=LOG_LEVEL_WARN
+// for production, or e.g. -D CONTROLPAD_LOG_CTRL=0 to silence one subsystem.
+//
+// Output that was explicitly asked for (serial command replies, the boot
+// timeline, the startup banner) goes straight to Serial and is not affected.
+
+#define LOG_LEVEL_NONE   0
+#define LOG_LEVEL_ERROR  1
+#define LOG_LEVEL_WARN   2
+#define LOG_LEVEL_INFO   3
+#define LOG_LEVEL_DEBUG  4
+#define LOG_LEVEL_TRACE  5   // Per-report hex dumps
+
+#ifndef CONTROLPAD_LOG_LEVEL
+#define CONTROLPAD_LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// Subsystem switches: 1 = follow CONTROLPAD_LOG_LEVEL, 0 = compiled out
+#ifndef CONTROLPAD_LOG_USB
+#define CONTROLPAD_LOG_USB   1   // Enumeration, polling, transfer completions
+#endif
+#ifndef CONTROLPAD_LOG_INIT
+#define CONTROLPAD_LOG_INIT  1   // Device init sequence, keymap
+#endif
+#ifndef CONTROLPAD_LOG_KBD
+#define CONTROLPAD_LOG_KBD   1   // Interface 0 keyboard reports
+#endif
+#ifndef CONTROLPAD_LOG_CTRL
+#define CONTROLPAD_LOG_CTRL  1   // Interface 1 control reports
+#endif
+#ifndef CONTROLPAD_LOG_LED
+#define CONTROLPAD_LOG_LED   1   // LED frames and commands
+#endif
+#ifndef CONTROLPAD_LOG_EVENT
+#define CONTROLPAD_LOG_EVENT 1   // Event queue, dispatcher, gestures
+#endif
+
+#define LOG_ENABLED(sub, level) (CONTROLPAD_LOG_##sub && (level) <= CONTROLPAD_LOG_LEVEL)
+
+// Statement placed in front of every emitted log line; main.cpp points it at
+// CPU accounting so time spent printing is charged to logging
+#ifndef LOG_ACCOUNTING_SCOPE
+#define LOG_ACCOUNTING_SCOPE()
+#endif
+
+#define LOG_AT(sub, level, ...) \
+  do { if (LOG_ENABLED(sub, level)) { LOG_ACCOUNTING_SCOPE(); Serial.printf(__VA_ARGS__); } } while (0)
+
+#define LOG_ERROR(sub, ...) LOG_AT(sub, LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(sub, ...)  LOG_AT(sub, LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(sub, ...)  LOG_AT(sub, LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(sub, ...) LOG_AT(sub, LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_TRACE(sub, ...) LOG_AT(sub, LOG_LEVEL_TRACE, __VA_ARGS__)
+
+// "prefix" followed by len bytes as 0xNN and a newline
+#define LOG_HEX(sub, level, prefix, buf, len) \
+  do { \
+    if (LOG_ENABLED(sub, level)) { \
+      LOG_ACCOUNTING_SCOPE(); \
+      Serial.print(prefix); \
+      for (int log_i_ = 0; log_i_ < (int)(len); log_i_++) Serial.printf("0x%02X ", (buf)[log_i_]); \
+      Serial.println(); \
+    } \
+  } while (0)
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// ===== MEMORY FOOTPRINT =====
+// Stack high-water marks by painting, and heap allocation counters.
+//
+// Stacks: a region is filled with STACK_PAINT_WORD once, while nothing below
+// the current stack pointer is in use. Stacks grow down, so the lowest word
+// that no longer holds the pattern is the deepest point ever reached; the
+// scan walks up from the bottom and stops there. A frame that happens to
+// write the pattern value itself would be under-reported by a word or so.
+//
+// USB completion callbacks do not run on the main stack: teensy4_usbhost
+// calls them on its host thread (TeensyAtomThreads), which has a stack of
+// its own. main.cpp registers that one from the first callback, when the
+// thread's stack bounds can be found.
+//
+// Heap: main.cpp wraps malloc/free (see platformio.ini) and counts into
+// HeapCounters; operator new goes through malloc and is counted too.
+
+#define STACK_PAINT_WORD 0xC5C5C5C5u
+
+#ifndef STACK_REGION_MAX
+#define STACK_REGION_MAX 4   // Main stack, USB host thread, room for more
+#endif
+
+struct StackRegion {
+  const char* name;
+  uint32_t* lo;   // Lowest address (stack limit)
+  uint32_t* hi;   // One past the highest address (initial stack pointer)
+
+  uint32_t size() const { return (uint32_t)((hi - lo) * sizeof(uint32_t)); }
+
+  // Bytes ever used, measured from the top
+  uint32_t highWater() const {
+    const uint32_t* p = lo;
+    while (p < hi && *p == STACK_PAINT_WORD) p++;
+    return (uint32_t)((hi - p) * sizeof(uint32_t));
+  }
+};
+
+class StackMonitor {
+public:
+  // Track [lo, hi) and paint [lo, paint_hi); paint_hi stops short of live
+  // frames when the region is the stack we are running on. Regions are added
+  // by one thread at a time (setup(), then the first USB callback) and become
+  // visible to size() only once painted.
+  bool add(const char* name, void* lo, void* hi, void* paint_hi) {
+    uint8_t n = count.load(std::memory_order_relaxed);
+    if (n >= STACK_REGION_MAX) return false;
+    StackRegion& r = regions[n];
+    r.name = name;
+    r.lo = alignUp(lo);
+    r.hi = (uint32_t*)((uintptr_t)hi & ~(uintptr_t)3);
+    uint32_t* end = (uint32_t*)((uintptr_t)paint_hi & ~(uintptr_t)3);
+    if (end > r.hi) end = r.hi;
+    for (uint32_t* p = r.lo; p < end; p++) *p = STACK_PAINT_WORD;
+    count.store(n + 1, std::memory_order_release);
+    return true;
+  }
+
+  uint8_t size() const { return count.load(std::memory_order_acquire); }
+  const StackRegion& operator[](uint8_t i) const { return regions[i]; }
+
+private:
+  static uint32_t* alignUp(void* p) { return (uint32_t*)(((uintptr_t)p + 3) & ~(uintptr_t)3); }
+
+  StackRegion regions[STACK_REGION_MAX];
+  std::atomic<uint8_t> count{0};
+};
+
+// Updated from malloc/free, which also run on the USB host thread
+struct HeapCounters {
+  std::atomic<uint32_t> allocs{0};
+  std::atomic<uint32_t> frees{0};
+  std::atomic<uint32_t> failed{0};
+  std::atomic<uint32_t> bytes_requested{0};   // Total since boot
+
+  void onAlloc(size_t size, const void* p) {
+    if (!p) {
+      failed.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    allocs.fetch_add(1, std::memory_order_relaxed);
+    bytes_requested.fetch_add((uint32_t)size, std::memory_order_relaxed);
+  }
+
+  void onFree(const void* p) {
+    if (p) frees.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  uint32_t live() const {
+    return allocs.load(std::memory_order_relaxed) - frees.load(std::memory_order_relaxed);
+  }
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "controlpad_ctrl_report.h"
+
+// ===== OUT STREAM MIRROR =====
+// A copy of every command the driver submits to EP 0x04, for comparing the
+// driver's traffic with the official editor's captures (tools/stream_diff).
+// submitTransfer() pushes a record into a ring when the mirror is on (serial
+// command "mirror on"). loop() prints the records as lines:
+//
+//   OUT <time_us> <result> <hex payload>
+//
+// time_us is micros() at submission, decimal. result is the submit status
+// (0 = on its way, anything else = refused and never sent). The payload is
+// printed in full, 128 hex digits for a 64-byte command. tools/pad_emulator
+// --record writes the same lines from its simulated clock. This header is
+// shared with the tools, so it must not depend on Arduino.
+
+#define MIRROR_LINE_MAX (32 + CTRL_REPORT_LEN * 2)
+
+struct MirrorRecord {
+  uint32_t time_us;
+  int8_t result;
+  uint8_t len;
+  uint8_t data[CTRL_REPORT_LEN];
+};
+
+inline int mirrorFormatLine(char* out, size_t size, const MirrorRecord& r) {
+  int n = snprintf(out, size, "OUT %lu %d ", (unsigned long)r.time_us, r.result);
+  for (uint8_t i = 0; i < r.len && n >= 0 && (size_t)n + 3 <= size; i++) {
+    n += snprintf(out + n, size - n, "%02x", r.data[i]);
+  }
+  if (n >= 0 && (size_t)n + 2 <= size) {
+    out[n++] = '\n';
+    out[n] = '\0';
+  }
+  return n;
+}
+
+inline int mirrorHexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Parses a mirror line; anything else in a serial log is rejected, so a whole
+// log can be fed through this
+inline bool mirrorParseLine(const char* line, MirrorRecord& r) {
+  if (strncmp(line, "OUT ", 4) != 0) return false;
+  unsigned long t;
+  int result, used = 0;
+  if (sscanf(line + 4, "%lu %d %n", &t, &result, &used) != 2 || !used) return false;
+  r.time_us = (uint32_t)t;
+  r.result = (int8_t)result;
+  r.len = 0;
+  for (const char* p = line + 4 + used; r.len < CTRL_REPORT_LEN; p += 2) {
+    int hi = mirrorHexDigit(p[0]);
+    int lo = hi < 0 ? -1 : mirrorHexDigit(p[1]);
+    if (lo < 0) break;
+    r.data[r.len++] = (uint8_t)(hi << 4 | lo);
+  }
+  return r.len > 0;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// ===== DRIVER STATISTICS =====
+// Counters bumped from the USB callbacks and loop(). Each is a relaxed atomic:
+// one increment on the hot path, no ordering, no locks. Readers take a
+// snapshot field by field, so a block printed while transfers complete can be
+// off by the few events that landed mid-print.
+
+struct StatCounter {
+  std::atomic<uint32_t> value{0};
+
+  void inc() { value.fetch_add(1, std::memory_order_relaxed); }
+  void set(uint32_t v) { value.store(v, std::memory_order_relaxed); }
+  uint32_t get() const { return value.load(std::memory_order_relaxed); }
+
+  // Raise to v if larger (single writer, so no CAS loop needed)
+  void max(uint32_t v) { if (v > get()) set(v); }
+};
+
+// Transfer result codes reported by the USB host, as listed in sent()
+#define USB_ERROR_CODES 10
+
+inline const char* usbErrorName(int result) {
+  switch (result) {
+    case -1:  return "USB_ERROR_TIMEOUT";
+    case -2:  return "USB_ERROR_STALL";
+    case -3:  return "USB_ERROR_NAK";
+    case -4:  return "USB_ERROR_DATA_TOGGLE";
+    case -5:  return "USB_ERROR_BABBLE";
+    case -6:  return "USB_ERROR_BUFFER_OVERRUN";
+    case -7:  return "USB_ERROR_BUFFER_UNDERRUN";
+    case -8:  return "USB_ERROR_NOT_ACCESSED";
+    case -9:  return "USB_ERROR_FIFO";
+    case -10: return "USB_ERROR_UNKNOWN";
+    default:  return "Unknown error code";
+  }
+}
+
+// Index into DriverStats::errors: 0..9 for codes -1..-10, 10 for anything else
+inline uint8_t usbErrorSlot(int result) {
+  return (result <= -1 && result >= -USB_ERROR_CODES) ? (uint8_t)(-result - 1) : USB_ERROR_CODES;
+}
+
+struct EndpointStats {
+  StatCounter submitted;    // InterruptMessage accepted
+  StatCounter rejected;     // InterruptMessage refused (nonzero return)
+  StatCounter completed;    // Completion callback with result >= 0
+  StatCounter failed;       // Completion callback with result < 0
+};
+
+struct DriverStats {
+  EndpointStats kbd_in;     // EP 0x81
+  EndpointStats ctrl_in;    // EP 0x83
+  EndpointStats ctrl_out;   // EP 0x04
+  StatCounter errors[USB_ERROR_CODES + 1];
+
+  StatCounter kbd_restarts;
+  StatCounter ctrl_restarts;
+
+  // LED frames: a frame starts with its first 56 83 00 data packet and is
+  // sent when its 41 80 commit is submitted; a frame that is abandoned (next
+  // frame starts first, or a send fails) counts as suppressed. A frame the
+  // pacer replaced before it went out never reaches the wire and is only
+  // counted as coalesced.
+  StatCounter frames_rendered;
+  StatCounter frames_sent;
+  StatCounter frames_suppressed;
+  StatCounter frames_coalesced;
+  StatCounter frame_interval_us;      // Between the last two commits
+  StatCounter frame_interval_max_us;
+  StatCounter last_commit_us;
+
+  void recordError(int result) { errors[usbErrorSlot(result)].inc(); }
+};
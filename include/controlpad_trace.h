@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// ===== BINARY TRACE RING =====
+// Always-on tracing for production builds. A trace point stores one 16-byte
+// record - cycle counter, event ID, phase and two arguments - into a static
+// ring; no formatting happens at the trace point. Claiming a slot is a single
+// atomic increment, so callbacks and loop() can all record, and the oldest
+// records are overwritten when nobody drains the ring.
+//
+// loop() drains the ring and prints records as hex lines (see
+// TRACE_LINE_FORMAT); tools/trace_decode turns a captured serial log into text
+// or Chrome/Perfetto trace JSON. This header is shared with that tool, so it
+// must not depend on Arduino.
+//
+// Consistency: writers are interrupt callbacks that run to completion, or
+// loop() itself, so every slot below head is complete by the time loop()
+// reads it. A slot overwritten while it was being copied is detected by
+// re-checking head afterwards and counted as lost.
+
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 256   // Records; power of two, 16 bytes each
+#endif
+
+static_assert((TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) == 0, "trace ring size must be a power of two");
+
+enum TracePhase : uint8_t {
+  TRACE_INSTANT = 0,
+  TRACE_BEGIN,
+  TRACE_END
+};
+
+enum TraceId : uint16_t {
+  TRACE_HEARTBEAT = 1,    // a0: millis(); keeps cycle-counter wraps decodable
+  TRACE_KBD_POLL,         // a0: key events decoded, a1: transfer result
+  TRACE_CTRL_POLL,        // a0: CtrlReportKind, a1: report bytes 0-3
+  TRACE_SENT,             // a0: command counter, a1: transfer result
+  TRACE_COMMIT,           // a0: press correlation ID, a1: transfer result
+  TRACE_DISPATCH,         // BEGIN/END around a drain; BEGIN a0: events queued, END a0: handled
+  TRACE_LED_FRAME,        // BEGIN/END around rendering and queueing a press frame; a0: button
+  TRACE_GESTURE,          // a0: button, a1: GestureType
+  TRACE_QUEUE_DROP,       // a0: total dropped events
+  TRACE_INIT_STEP,        // a0: init step, a1: transfer result
+  TRACE_ID_COUNT
+};
+
+struct TraceRecord {
+  uint32_t cycles;
+  uint16_t id;
+  uint8_t phase;
+  uint8_t reserved;
+  uint32_t a0;
+  uint32_t a1;
+};
+
+static_assert(sizeof(TraceRecord) == 16, "trace records are 16 bytes");
+
+// One record per line: "T cycles id phase a0 a1", all hex
+#define TRACE_LINE_FORMAT "T %08lX %04X %X %08lX %08lX\n"
+
+inline const char* traceName(uint16_t id) {
+  switch (id) {
+    case TRACE_HEARTBEAT:  return "heartbeat";
+    case TRACE_KBD_POLL:   return "kbd_poll";
+    case TRACE_CTRL_POLL:  return "ctrl_poll";
+    case TRACE_SENT:       return "sent";
+    case TRACE_COMMIT:     return "commit";
+    case TRACE_DISPATCH:   return "dispatch";
+    case TRACE_LED_FRAME:  return "led_frame";
+    case TRACE_GESTURE:    return "gesture";
+    case TRACE_QUEUE_DROP: return "queue_drop";
+    case TRACE_INIT_STEP:  return "init_step";
+    default:               return "?";
+  }
+}
+
+class TraceRing {
+public:
+  void record(uint32_t cycles, uint16_t id, uint8_t phase, uint32_t a0, uint32_t a1) {
+    uint32_t pos = head.fetch_add(1, std::memory_order_relaxed);
+    TraceRecord& r = ring[pos & (TRACE_RING_SIZE - 1)];
+    r.cycles = cycles;
+    r.id = id;
+    r.phase = phase;
+    r.reserved = 0;
+    r.a0 = a0;
+    r.a1 = a1;
+  }
+
+  // Copy out the oldest unread record; false when caught up. Records that
+  // were overwritten before they could be read are added to lost().
+  bool pop(TraceRecord& out) {
+    for (;;) {
+      uint32_t h = head.load(std::memory_order_acquire);
+      if (h - tail > TRACE_RING_SIZE) {
+        lost_count += h - tail - TRACE_RING_SIZE;
+        tail = h - TRACE_RING_SIZE;
+      }
+      if (tail == h) return false;
+
+      out = ring[tail & (TRACE_RING_SIZE - 1)];
+      tail++;
+      // A writer may have lapped us while copying
+      if (head.load(std::memory_order_acquire) - (tail - 1) <= TRACE_RING_SIZE) return true;
+      lost_count++;
+    }
+  }
+
+  uint32_t pending() const {
+    uint32_t n = head.load(std::memory_order_relaxed) - tail;
+    return n > TRACE_RING_SIZE ? TRACE_RING_SIZE : n;
+  }
+
+  uint32_t recorded() const { return head.load(std::memory_order_relaxed); }
+  uint32_t lost() const { return lost_count; }
+
+  // Drop everything not yet read
+  void discard() { tail = head.load(std::memory_order_relaxed); }
+
+private:
+  TraceRecord ring[TRACE_RING_SIZE];
+  std::atomic<uint32_t> head{0};
+  uint32_t tail = 0;          // loop() only
+  uint32_t lost_count = 0;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===== USB DESCRIPTOR WALKING =====
+// offer_interface() and findEndpoints() get the interface descriptor followed
+// by the rest of the configuration (class descriptors, endpoints, the next
+// interfaces) as raw bytes from the device. Every descriptor starts with
+// bLength, bDescriptorType; the walker steps by bLength and stops, flagging the
+// buffer as malformed, on a length below 2 (which would never advance) or one
+// that runs past the end. Endpoint fields are read byte by byte, so the buffer
+// needs no alignment.
+//
+// From the bootup capture: interface 0 has EP 0x81 (8 bytes), interface 1 has
+// EP 0x83 and EP 0x04 (64 bytes), interface 2 has EP 0x82; all interrupt.
+
+#define USB_DESC_HEADER_LEN     2
+#define USB_DESC_TYPE_INTERFACE 0x04
+#define USB_DESC_TYPE_ENDPOINT  0x05
+#define USB_DESC_ENDPOINT_LEN   7
+#define USB_EP_TYPE_MASK        0x03
+#define USB_EP_TYPE_INTERRUPT   0x03
+#define USB_EP_DIR_IN           0x80
+
+struct UsbEndpointInfo {
+  uint8_t address;         // bEndpointAddress, bit 7 = IN
+  uint8_t attributes;      // bmAttributes, bits 0-1 = transfer type
+  uint16_t max_packet;     // wMaxPacketSize
+  uint8_t interval;        // bInterval
+
+  bool isInterrupt() const { return (attributes & USB_EP_TYPE_MASK) == USB_EP_TYPE_INTERRUPT; }
+  bool isIn() const { return address & USB_EP_DIR_IN; }
+};
+
+class UsbDescriptorWalker {
+public:
+  // desc points at the interface descriptor, which is skipped
+  UsbDescriptorWalker(const void* desc, size_t length)
+      : p((const uint8_t*)desc), end((const uint8_t*)desc + length) {
+    next();
+  }
+
+  // Next descriptor after the interface, nullptr at the end or on a bad length
+  const uint8_t* next() {
+    size_t left = (size_t)(end - p);
+    if (left < USB_DESC_HEADER_LEN) return nullptr;
+    const uint8_t* d = p;
+    // One compare for both bounds: a length below 2 wraps around to huge
+    if ((size_t)d[0] - USB_DESC_HEADER_LEN > left - USB_DESC_HEADER_LEN) return stop();
+    p += d[0];
+    return d;
+  }
+
+  // Next endpoint descriptor; stops at the next interface, whose endpoints
+  // are not ours
+  bool nextEndpoint(UsbEndpointInfo& ep) {
+    while (const uint8_t* d = next()) {
+      if (d[1] == USB_DESC_TYPE_ENDPOINT) {
+        if (d[0] < USB_DESC_ENDPOINT_LEN) {
+          stop();
+          return false;
+        }
+        ep.address = d[2];
+        ep.attributes = d[3];
+        ep.max_packet = (uint16_t)(d[4] | (d[5] << 8));
+        ep.interval = d[6];
+        return true;
+      }
+      if (d[1] == USB_DESC_TYPE_INTERFACE) {
+        p = end;
+        return false;
+      }
+    }
+    return false;
+  }
+
+  // True when the walk stopped on a descriptor whose length was impossible
+  bool malformed() const { return bad; }
+
+private:
+  // Ends the walk on a malformed descriptor
+  const uint8_t* stop() {
+    bad = true;
+    p = end;
+    return nullptr;
+  }
+
+  const uint8_t* p;          // Never past end
+  const uint8_t* end;
+  bool bad = false;
+};
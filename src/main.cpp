@@ -1,6 +1,29 @@
 #include <Arduino.h>
 #include <teensy4_usbhost.h>
 #include <string.h>  // For memset
+#include <malloc.h>  // mallinfo() for the memory report
+#include "controlpad_boot_trace.h"
+#include "controlpad_cpu.h"
+#include "controlpad_ctrl_report.h"
+#include "controlpad_dispatch.h"
+#include "controlpad_effects.h"
+#include "controlpad_event.h"
+#include "controlpad_event_ring.h"
+#include "controlpad_frame.h"
+#include "controlpad_gesture.h"
+#include "controlpad_hid.h"
+#include "controlpad_init.h"
+#include "controlpad_keymap.h"
+#include "controlpad_latency.h"
+#include "controlpad_led.h"
+// Log lines are charged to CPU_LOG; CpuScope is defined with the globals below
+#define LOG_ACCOUNTING_SCOPE() CpuScope log_cpu_scope_(CPU_LOG)
+#include "controlpad_log.h"
+#include "controlpad_memory.h"
+#include "controlpad_mirror.h"
+#include "controlpad_stats.h"
+#include "controlpad_trace.h"
+#include "controlpad_usb_desc.h"
 
 // ===== CONTROLPAD CONSTANTS =====
 #define CONTROLPAD_VID  0x2516
@@ -10,10 +33,64 @@
 #define EP_OUT          0x04  // Interrupt OUT endpoint for commands
 #define EP_IN           0x83  // Interrupt IN endpoint for responses
 
+// Binary trace points are cheap enough to leave on; -D CONTROLPAD_TRACE=0 removes them
+#ifndef CONTROLPAD_TRACE
+#define CONTROLPAD_TRACE 1
+#endif
+
+// Busy/idle cycle accounting for the "stats" command; -D CONTROLPAD_CPU_ACCOUNTING=0 removes it
+#ifndef CONTROLPAD_CPU_ACCOUNTING
+#define CONTROLPAD_CPU_ACCOUNTING 1
+#endif
+
+// Fast boot skips the editor-only profile reads during initialization.
+// Build with -D CONTROLPAD_FAST_BOOT=0 to replay the full editor sequence.
+#ifndef CONTROLPAD_FAST_BOOT
+#define CONTROLPAD_FAST_BOOT 1
+#endif
+
+// Heap allocation counters; set together with the linker --wrap flags in platformio.ini
+#ifndef CONTROLPAD_WRAP_MALLOC
+#define CONTROLPAD_WRAP_MALLOC 0
+#endif
+
+// Benchmark build: -D CONTROLPAD_BENCH_MODE=1 prints the benchmark table at boot
+// instead of starting the USB host, so no pad needs to be attached
+#ifndef CONTROLPAD_BENCH_MODE
+#define CONTROLPAD_BENCH_MODE 0
+#endif
+
 // ===== CONTROLPAD PROTOCOL STRUCTURES =====
-struct controlpad_event {
-  uint8_t data[64];
-  uint8_t len;
+// Time events spend between the completion callback and loop() picking them up
+struct EventDelayStats {
+  uint32_t count = 0;
+  uint32_t min_us = UINT32_MAX;
+  uint32_t max_us = 0;
+  uint64_t total_us = 0;
+
+  void add(uint32_t delay_us) {
+    count++;
+    total_us += delay_us;
+    if (delay_us < min_us) min_us = delay_us;
+    if (delay_us > max_us) max_us = delay_us;
+  }
+
+  uint32_t mean_us() const { return count ? (uint32_t)(total_us / count) : 0; }
+};
+
+// Cycles spent inside a USB completion callback, to see what logging costs there
+struct CallbackCost {
+  uint32_t count = 0;
+  uint32_t max_cycles = 0;
+  uint64_t total_cycles = 0;
+
+  void add(uint32_t cycles) {
+    count++;
+    total_cycles += cycles;
+    if (cycles > max_cycles) max_cycles = cycles;
+  }
+
+  uint32_t meanCycles() const { return count ? (uint32_t)(total_cycles / count) : 0; }
 };
 
 struct ControlPadPacket {
@@ -25,8 +102,192 @@ struct ControlPadPacket {
 
 // ===== GLOBAL VARIABLES =====
 static DMAMEM TeensyUSBHost2 usbHost;
-ATOM_QUEUE controlpad_queue;
-controlpad_event controlpad_queue_data[8];
+
+// Boot timeline; DMAMEM is not cleared at startup so previous boots survive a warm reset
+static DMAMEM BootTrace bootTrace;
+static const uint32_t BOOT_TRACE_TIMEOUT_MS = 5000;  // Close the timeline if no frame is committed
+// Event records are 12 bytes, so 64 of them fit where 10 full-report events used to.
+// Must be a power of two; override with -D CONTROLPAD_QUEUE_DEPTH=...
+#ifndef CONTROLPAD_QUEUE_DEPTH
+#define CONTROLPAD_QUEUE_DEPTH 64
+#endif
+typedef EventRing<controlpad_event, CONTROLPAD_QUEUE_DEPTH> ControlPadEventQueue;
+ControlPadEventQueue controlpad_queue;
+ReportSlab controlReportSlab;  // Raw interface 1 reports referenced by queued events
+EventDelayStats eventDelayStats;
+PressToLightTracker pressLatency;  // kbd_poll completion -> LED commit completion
+CallbackCost kbdPollCost, ctrlPollCost, sentCost;
+DriverStats driverStats;  // Transfer, error and frame counters, see "stats" command
+TraceRing traceRing;  // Drained by loop() on request, see serviceTrace()
+EventRing<MirrorRecord, 16> outMirror;  // EP 0x04 commands while "mirror on", see serviceMirror()
+static bool outMirrorOn = false;
+
+static inline void traceAt(uint32_t cycles, TraceId id, uint8_t phase, uint32_t a0 = 0, uint32_t a1 = 0) {
+#if CONTROLPAD_TRACE
+  traceRing.record(cycles, id, phase, a0, a1);
+#endif
+}
+
+static inline void trace(TraceId id, uint32_t a0 = 0, uint32_t a1 = 0) { traceAt(ARM_DWT_CYCCNT, id, TRACE_INSTANT, a0, a1); }
+static inline void traceBegin(TraceId id, uint32_t a0 = 0, uint32_t a1 = 0) { traceAt(ARM_DWT_CYCCNT, id, TRACE_BEGIN, a0, a1); }
+static inline void traceEnd(TraceId id, uint32_t a0 = 0, uint32_t a1 = 0) { traceAt(ARM_DWT_CYCCNT, id, TRACE_END, a0, a1); }
+
+// Copy of one submitted command for the mirror; a full ring drops and counts
+static void mirrorOut(const uint8_t* data, uint16_t len, int result) {
+  MirrorRecord r;
+  r.time_us = micros();
+  r.result = (int8_t)constrain(result, -128, 127);
+  r.len = (uint8_t)min(len, (uint16_t)CTRL_REPORT_LEN);
+  memcpy(r.data, data, r.len);
+  outMirror.push(r);
+}
+
+StackMonitor stackMonitor;  // Painted in setup() and the first USB callback, see "mem" command
+HeapCounters heapCounters;
+
+#define STACK_PAINT_GUARD 256  // Bytes left unpainted below the caller's frame
+
+// The USB host thread's stack. kbd_poll/ctrl_poll/sent run there, not on the
+// main stack, so the LED arrays built in callbacks only show up in this mark.
+// Its bounds are in the AtomThreads TCB when the kernel is built with
+// ATOM_STACK_CHECKING; without it the stack cannot be located and "mem" says
+// so instead of reporting a number.
+#if __has_include(<atom.h>)
+extern "C" {
+#include <atom.h>
+}
+#endif
+
+#define USB_STACK_PENDING     0   // No USB callback yet
+#define USB_STACK_PAINTED     1
+#define USB_STACK_UNREACHABLE 2   // No TCB stack bounds in this build
+static std::atomic<uint8_t> usbStackState{USB_STACK_PENDING};
+
+// Called at the top of every USB callback; only the first one does anything.
+// Depth reached before it (enumeration) is painted over and not counted.
+static inline void registerUsbThreadStack() {
+  if (usbStackState.load(std::memory_order_relaxed) != USB_STACK_PENDING) return;
+#ifdef ATOM_STACK_CHECKING
+  ATOM_TCB* tcb = atomCurrentContext();
+  if (tcb && tcb->stack_bottom) {
+    uint8_t marker;
+    uint8_t* lo = (uint8_t*)tcb->stack_bottom;
+    stackMonitor.add("usb host", lo, lo + tcb->stack_size, (void*)((uintptr_t)&marker - STACK_PAINT_GUARD));
+    usbStackState.store(USB_STACK_PAINTED, std::memory_order_relaxed);
+    return;
+  }
+#endif
+  usbStackState.store(USB_STACK_UNREACHABLE, std::memory_order_relaxed);
+}
+
+// Heap allocation counting. platformio.ini links with --wrap for these four
+// and defines CONTROLPAD_WRAP_MALLOC; operator new calls malloc, so it is
+// covered too. newlib's internal _malloc_r calls (stdio) are not.
+#if CONTROLPAD_WRAP_MALLOC
+extern "C" {
+void* __real_malloc(size_t size);
+void __real_free(void* p);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* p, size_t size);
+
+void* __wrap_malloc(size_t size) {
+  void* p = __real_malloc(size);
+  heapCounters.onAlloc(size, p);
+  return p;
+}
+
+void __wrap_free(void* p) {
+  heapCounters.onFree(p);
+  __real_free(p);
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+  void* p = __real_calloc(n, size);
+  heapCounters.onAlloc(n * size, p);
+  return p;
+}
+
+// A resize is counted as a free of the old block plus a new allocation
+void* __wrap_realloc(void* p, size_t size) {
+  void* q = __real_realloc(p, size);
+  if (size == 0) {
+    heapCounters.onFree(p);
+  } else {
+    if (p && q) heapCounters.onFree(p);
+    heapCounters.onAlloc(size, q);
+  }
+  return q;
+}
+}
+#endif
+
+CpuAccounting cpuAccount;  // Cycles per CpuCategory, rolled up once a second in loop()
+
+// Category switches come from loop() and from USB callbacks that can preempt
+// it, so each switch runs with interrupts masked. PRIMASK is saved rather than
+// blindly re-enabled because callbacks switch categories too.
+static inline uint32_t cpuLock() {
+#if defined(__arm__)
+  uint32_t primask;
+  __asm__ volatile("mrs %0, primask\n\tcpsid i" : "=r"(primask) :: "memory");
+  return primask;
+#else
+  return 0;
+#endif
+}
+
+static inline void cpuUnlock(uint32_t primask) {
+#if defined(__arm__)
+  __asm__ volatile("msr primask, %0" :: "r"(primask) : "memory");
+#else
+  (void)primask;
+#endif
+}
+
+static inline uint8_t cpuEnter(uint8_t category) {
+#if CONTROLPAD_CPU_ACCOUNTING
+  uint32_t m = cpuLock();
+  uint8_t prev = cpuAccount.enter(category, ARM_DWT_CYCCNT);
+  cpuUnlock(m);
+  return prev;
+#else
+  return category;
+#endif
+}
+
+static inline void cpuLeave(uint8_t prev) {
+#if CONTROLPAD_CPU_ACCOUNTING
+  uint32_t m = cpuLock();
+  cpuAccount.leave(prev, ARM_DWT_CYCCNT);
+  cpuUnlock(m);
+#else
+  (void)prev;
+#endif
+}
+
+// Charges the enclosing block to one category
+struct CpuScope {
+  uint8_t prev;
+  explicit CpuScope(uint8_t category) : prev(cpuEnter(category)) {}
+  ~CpuScope() { cpuLeave(prev); }
+};
+
+// delay() used to pace the device protocol; the core only spins, so it is
+// headroom for interrupts but not for loop()
+static inline void paceDelay(uint32_t ms) {
+  CpuScope wait(CPU_WAIT);
+  delay(ms);
+}
+
+// USB completion callback body under CPU_USB accounting and a cycle-cost probe
+template <typename F>
+static inline void accountCallback(CallbackCost& cost, F&& body) {
+  CpuScope usb(CPU_USB);
+  registerUsbThreadStack();
+  uint32_t c = ARM_DWT_CYCCNT;
+  body();
+  cost.add(ARM_DWT_CYCCNT - c);
+}
 
 // Forward declaration for the global driver instance
 class USBControlPad;
@@ -42,24 +303,45 @@ private:
   // Interface 0 (Keyboard) endpoints and data
   uint8_t kbd_ep_in = 0x81;   // Standard keyboard endpoint
   uint8_t kbd_report[8] __attribute__((aligned(32)));
+  HidReportDecoder kbd_decoder;  // Previous key state for press/release diffing
+  CtrlReportDecoder ctrl_decoder;  // Interface 1 echoes and key notifications
+  Keymap keymap;                 // HID usage <-> button number, see controlpad_keymap.h
   
   // Interface 1 (Control/LED) endpoints and data  
   uint8_t ctrl_ep_in = 0x83;   // Control input endpoint
   uint8_t ctrl_ep_out = 0x04;  // Control output endpoint
   uint8_t ctrl_report[64] __attribute__((aligned(32)));
   
-  // State buffers to hold full 25-button RGBW values for custom mode
-  uint8_t statePacket1[64];  // Buttons 1-13
-  uint8_t statePacket2[64];  // Buttons 14-25
+  // Full LED state for custom mode, and the two data packets encoded from it
+  LedFrame ledState;
+  uint8_t statePacket1[64];  // LED data part 1: slots 0-13 (R)
+  uint8_t statePacket2[64];  // LED data part 2: slots 13 (GB)-23
   
   uint8_t report_len = 64;
+  FrameAccounting frames;        // 56 83 00 / 41 80 pairing on EP 0x04, feeds driverStats
   bool initialized = false;
-  ATOM_QUEUE* queue = nullptr;
+  ControlPadEventQueue* queue = nullptr;
+  
+  // Init sequence state; the steps are CONTROLPAD_INIT_STEPS
+  uint8_t init_cmd[64] __attribute__((aligned(32)));  // Must outlive the transfer
+  volatile bool init_running = false;
+  uint8_t init_step = 0;
+  uint8_t init_repeat = 0;
+  uint8_t init_attempt = 0;
+  uint16_t init_sent = 0;
+  uint16_t init_skipped = 0;
+  uint32_t init_start_us = 0;
   
   // Separate callbacks for different interfaces
   USBCallback kbd_poll_cb;
   USBCallback ctrl_poll_cb;
   USBCallback send_cb;
+  USBCallback commit_cb;         // send_cb plus press-to-light bookkeeping for LED commits
+  USBCallback init_cb;           // send_cb plus the next init step; only init_cmd uses it
+  
+  uint16_t press_seq = 0;        // Correlation IDs handed to key presses
+  volatile uint16_t commit_id = LATENCY_NO_ID;  // Press whose commit is in flight
+  FramePacer ledPacer;           // Press feedback frames, sent from loop() by serviceLedFrames()
 
 public:
   // Static initialization test
@@ -74,10 +356,12 @@ public:
   
   // Constructor for USB_Driver_FactoryGlue (requires USB_Device*)
   USBControlPad(USB_Device* dev) : USB_Driver_FactoryGlue<USBControlPad>(dev), 
-                                   kbd_poll_cb([this](int r) { kbd_poll(r); }),
-                                   ctrl_poll_cb([this](int r) { ctrl_poll(r); }),
-                                   send_cb([this](int r) { sent(r); }) {
-    Serial.println("🔧 USBControlPad DUAL INTERFACE driver instance created");
+                                   kbd_poll_cb([this](int r) { accountCallback(kbdPollCost, [&] { kbd_poll(r); }); }),
+                                   ctrl_poll_cb([this](int r) { accountCallback(ctrlPollCost, [&] { ctrl_poll(r); }); }),
+                                   send_cb([this](int r) { accountCallback(sentCost, [&] { sent(r); }); }),
+                                   commit_cb([this](int r) { accountCallback(sentCost, [&] { committed(r); }); }),
+                                   init_cb([this](int r) { accountCallback(sentCost, [&] { initSent(r); }); }) {
+    LOG_INFO(USB, "🔧 USBControlPad DUAL INTERFACE driver instance created\n");
     factory_registered = true;
   }
   
@@ -85,63 +369,68 @@ public:
   // These are called by the factory system during device enumeration
   
   static bool offer_interface(const usb_interface_descriptor* iface, size_t length) {
-    Serial.printf("\n🔍 *** USBControlPad::offer_interface called ***\n");
-    Serial.printf("   Interface: %d\n", iface->bInterfaceNumber);
-    Serial.printf("   Class: 0x%02X\n", iface->bInterfaceClass);
-    Serial.printf("   SubClass: 0x%02X\n", iface->bInterfaceSubClass);
-    Serial.printf("   Protocol: 0x%02X\n", iface->bInterfaceProtocol);
-    Serial.printf("   NumEndpoints: %d\n", iface->bNumEndpoints);
-    Serial.printf("   AltSetting: %d\n", iface->bAlternateSetting);
+    bootTrace.mark(BOOT_OFFER_INTERFACE, iface->bInterfaceNumber, micros());
+    LOG_INFO(USB, "\n🔍 *** USBControlPad::offer_interface called ***\n");
+    LOG_INFO(USB, "   Interface: %d\n", iface->bInterfaceNumber);
+    LOG_INFO(USB, "   Class: 0x%02X\n", iface->bInterfaceClass);
+    LOG_INFO(USB, "   SubClass: 0x%02X\n", iface->bInterfaceSubClass);
+    LOG_INFO(USB, "   Protocol: 0x%02X\n", iface->bInterfaceProtocol);
+    LOG_INFO(USB, "   NumEndpoints: %d\n", iface->bNumEndpoints);
+    LOG_INFO(USB, "   AltSetting: %d\n", iface->bAlternateSetting);
     
     // Debug endpoint information
-    const uint8_t *desc = (const uint8_t*)iface;
-    const uint8_t *end = desc + length;
-    desc += desc[0]; // Skip interface descriptor
-    
-    Serial.println("   Endpoints:");
+    LOG_INFO(USB, "   Endpoints:\n");
     bool hasInEndpoint = false;
     bool hasOutEndpoint = false;
     
-    while (desc < end - 2) {
-      if (desc[1] == USB_DT_ENDPOINT) {
-        const usb_endpoint_descriptor *ep = (const usb_endpoint_descriptor*)desc;
-        Serial.printf("     - EP 0x%02X: type=0x%02X, maxPacket=%d\n", 
-                      ep->bEndpointAddress, ep->bmAttributes, ep->wMaxPacketSize);
-        
-        if ((ep->bmAttributes & 0x03) == USB_ENDPOINT_INTERRUPT) {
-          if (ep->bEndpointAddress & 0x80) {
-            hasInEndpoint = true;
-          } else {
-            hasOutEndpoint = true;
-          }
+    UsbDescriptorWalker walker(iface, length);
+    UsbEndpointInfo ep;
+    while (walker.nextEndpoint(ep)) {
+      LOG_INFO(USB, "     - EP 0x%02X: type=0x%02X, maxPacket=%d\n", 
+                    ep.address, ep.attributes, ep.max_packet);
+      
+      if (ep.isInterrupt()) {
+        if (ep.isIn()) {
+          hasInEndpoint = true;
+        } else {
+          hasOutEndpoint = true;
         }
       }
-      desc += desc[0];
+    }
+    if (walker.malformed()) {
+      LOG_WARN(USB, "   ⚠️ Malformed descriptor after interface %d, endpoint list cut short\n", iface->bInterfaceNumber);
     }
     
     // ACCEPT BOTH Interface 0 (input) AND Interface 1 (LED control)
     // Only reject Interface 2 (unknown)
     if (iface->bInterfaceClass == 0x03 && 
         (iface->bInterfaceNumber == 0 || iface->bInterfaceNumber == 1)) {
-      Serial.printf("✅ USBControlPad ACCEPTING Interface %d for full control!\n\n", iface->bInterfaceNumber);
+      // Both report on an interrupt IN; LED commands go out on interface 1's OUT
+      if (!hasInEndpoint || (iface->bInterfaceNumber == 1 && !hasOutEndpoint)) {
+        LOG_WARN(USB, "❌ USBControlPad rejecting interface %d (missing interrupt %s endpoint)\n\n",
+                      iface->bInterfaceNumber, hasInEndpoint ? "OUT" : "IN");
+        return false;
+      }
+      LOG_INFO(USB, "✅ USBControlPad ACCEPTING Interface %d for full control!\n\n", iface->bInterfaceNumber);
       return true;
     }
     
-    Serial.printf("❌ USBControlPad rejecting interface %d ", iface->bInterfaceNumber);
+    LOG_INFO(USB, "❌ USBControlPad rejecting interface %d ", iface->bInterfaceNumber);
     if (iface->bInterfaceNumber == 2) {
-      Serial.println("(Interface 2 not needed)");
+      LOG_INFO(USB, "(Interface 2 not needed)\n");
     } else {
-      Serial.println("(not HID or wrong interface)");
+      LOG_INFO(USB, "(not HID or wrong interface)\n");
     }
-    Serial.println();
+    LOG_INFO(USB, "\n");
     
     return false;
   }
   
   static USB_Driver* attach_interface(const usb_interface_descriptor* iface, size_t length, USB_Device* dev) {
-    Serial.printf("\n🎯 *** USBControlPad::attach_interface called ***\n");
-    Serial.printf("   Attaching to Interface: %d\n", iface->bInterfaceNumber);
-    Serial.printf("   Class: 0x%02X, SubClass: 0x%02X, Protocol: 0x%02X\n", 
+    bootTrace.mark(BOOT_ATTACH_INTERFACE, iface->bInterfaceNumber, micros());
+    LOG_INFO(USB, "\n🎯 *** USBControlPad::attach_interface called ***\n");
+    LOG_INFO(USB, "   Attaching to Interface: %d\n", iface->bInterfaceNumber);
+    LOG_INFO(USB, "   Class: 0x%02X, SubClass: 0x%02X, Protocol: 0x%02X\n", 
                   iface->bInterfaceClass, iface->bInterfaceSubClass, iface->bInterfaceProtocol);
     
     // Create driver instance on FIRST interface encountered (Interface 0 or 1)
@@ -160,73 +449,107 @@ public:
       driver->begin(&controlpad_queue);
       
       driver_instance_created = true;
-      Serial.printf("✅ USBControlPad DUAL INTERFACE driver created (primary: Interface %d)!\n\n", iface->bInterfaceNumber);
+      LOG_INFO(USB, "✅ USBControlPad DUAL INTERFACE driver created (primary: Interface %d)!\n\n", iface->bInterfaceNumber);
       return driver;
     } else {
       // Second interface: Don't create a new driver, just acknowledge
-      Serial.printf("✅ Interface %d acknowledged (using existing dual-interface driver)!\n\n", iface->bInterfaceNumber);
+      LOG_INFO(USB, "✅ Interface %d acknowledged (using existing dual-interface driver)!\n\n", iface->bInterfaceNumber);
       return nullptr;  // Don't create a second driver instance
     }
   }
   
   // Instance methods
   void detach() override {
-    Serial.println("❌ USBControlPad detached");
+    LOG_ERROR(USB, "❌ USBControlPad detached\n");
+    if (controlPadDriver == this) controlPadDriver = nullptr;
     initialized = false;
+    ledPacer.clear();
     kbd_polling = false;
     ctrl_polling = false;
+    kbd_decoder.reset();
+    ctrl_decoder.reset();
+  }
+  
+  // Every transfer goes through here so the driver stats see it
+  int submitTransfer(uint8_t ep, uint16_t len, void* data, const USBCallback* cb) {
+    int result = InterruptMessage(ep, len, data, cb);
+    EndpointStats& es = endpointStats(ep);
+    if (result == 0) {
+      es.submitted.inc();
+    } else {
+      es.rejected.inc();
+    }
+    if (ep == ctrl_ep_out && len >= 3) {
+      frames.note((const uint8_t*)data, result == 0, micros(), driverStats);
+    }
+    if (outMirrorOn && ep == ctrl_ep_out) {
+      mirrorOut((const uint8_t*)data, len, result);
+    }
+    return result;
+  }
+  
+  EndpointStats& endpointStats(uint8_t ep) {
+    if (ep == kbd_ep_in) return driverStats.kbd_in;
+    if (ep == ctrl_ep_in) return driverStats.ctrl_in;
+    return driverStats.ctrl_out;
+  }
+  
+  static void noteCompletion(EndpointStats& es, int result) {
+    if (result >= 0) {
+      es.completed.inc();
+    } else {
+      es.failed.inc();
+      driverStats.recordError(result);
+    }
   }
   
   void setupDualInterface() {
-    Serial.println("🔧 Setting up dual interface operation...");
+    LOG_INFO(USB, "🔧 Setting up dual interface operation...\n");
     // Set fixed endpoints based on USB capture analysis
     kbd_ep_in = 0x81;    // Interface 0 keyboard input
     ctrl_ep_in = 0x83;   // Interface 1 control input  
     ctrl_ep_out = 0x04;  // Interface 1 control output
-    Serial.printf("✅ Keyboard EP: 0x%02X, Control EP IN: 0x%02X, OUT: 0x%02X\n", 
+    LOG_INFO(USB, "✅ Keyboard EP: 0x%02X, Control EP IN: 0x%02X, OUT: 0x%02X\n", 
                   kbd_ep_in, ctrl_ep_in, ctrl_ep_out);
   }
   
-  bool begin(ATOM_QUEUE *q) {
+  bool begin(ControlPadEventQueue *q) {
     queue = q;
     if (queue != nullptr) {
-      initializeDevice();
+      // Polling must be up first: the health check needs it and the device
+      // echoes every init command on EP 0x83
       startDualPolling();
+      initializeDevice();
     }
     return true;
   }
   
   void findEndpoints(const usb_interface_descriptor* iface, size_t length) {
-    Serial.printf("🔍 Finding endpoints in interface %d...\n", iface->bInterfaceNumber);
-    
-    const uint8_t *desc = (const uint8_t*)iface;
-    const uint8_t *end = desc + length;
+    LOG_INFO(USB, "🔍 Finding endpoints in interface %d...\n", iface->bInterfaceNumber);
     
-    // Skip interface descriptor
-    desc += desc[0];
-    
-    while (desc < end - 2) {
-      if (desc[1] == USB_DT_ENDPOINT) {
-        const usb_endpoint_descriptor *ep = (const usb_endpoint_descriptor*)desc;
-        Serial.printf("📍 Found endpoint: 0x%02X, type: 0x%02X, maxPacket: %d\n", 
-                      ep->bEndpointAddress, ep->bmAttributes, ep->wMaxPacketSize);
-        
-        if ((ep->bmAttributes & 0x03) == USB_ENDPOINT_INTERRUPT) {
-          if (ep->bEndpointAddress & 0x80) {
-            kbd_ep_in = ep->bEndpointAddress;
-            Serial.printf("✅ Set EP_IN: 0x%02X\n", kbd_ep_in);
-          } else {
-            ctrl_ep_out = ep->bEndpointAddress;
-            Serial.printf("✅ Set EP_OUT: 0x%02X\n", ctrl_ep_out);
-          }
+    UsbDescriptorWalker walker(iface, length);
+    UsbEndpointInfo ep;
+    while (walker.nextEndpoint(ep)) {
+      LOG_INFO(USB, "📍 Found endpoint: 0x%02X, type: 0x%02X, maxPacket: %d\n", 
+                    ep.address, ep.attributes, ep.max_packet);
+      
+      if (ep.isInterrupt()) {
+        if (ep.isIn()) {
+          kbd_ep_in = ep.address;
+          LOG_INFO(USB, "✅ Set EP_IN: 0x%02X\n", kbd_ep_in);
+        } else {
+          ctrl_ep_out = ep.address;
+          LOG_INFO(USB, "✅ Set EP_OUT: 0x%02X\n", ctrl_ep_out);
         }
       }
-      desc += desc[0];
+    }
+    if (walker.malformed()) {
+      LOG_WARN(USB, "⚠️ Malformed descriptor in interface %d, using the endpoints found so far\n", iface->bInterfaceNumber);
     }
   }
   
   bool sendCompleteRedSequence() {
-    Serial.println("🔥 Sending COMPLETE sequence from USB capture to set button 1 red");
+    LOG_DEBUG(LED, "🔥 Sending COMPLETE sequence from USB capture to set button 1 red\n");
     
     // Based on the capture, I see several commands. Let me send the key ones:
     
@@ -270,33 +593,33 @@ public:
       0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
     };
     
-    Serial.println("🔄 Step 1: Setup command (56 81...)");
-    int result1 = InterruptMessage(ctrl_ep_out, 64, cmd1, &send_cb);
-    delay(12);  // Match USB capture timing: ~10-12ms
+    LOG_DEBUG(LED, "🔄 Step 1: Setup command (56 81...)\n");
+    int result1 = submitTransfer(ctrl_ep_out, 64, cmd1, &send_cb);
+    paceDelay(12);  // Match USB capture timing: ~10-12ms
     
-    Serial.println("🔄 Step 2: Main LED command (56 83 00...)");
-    int result2 = InterruptMessage(ctrl_ep_out, 64, cmd2, &send_cb);
-    delay(11);  // Match USB capture timing
+    LOG_DEBUG(LED, "🔄 Step 2: Main LED command (56 83 00...)\n");
+    int result2 = submitTransfer(ctrl_ep_out, 64, cmd2, &send_cb);
+    paceDelay(11);  // Match USB capture timing
     
-    Serial.println("🔄 Step 3: LED index command (56 83 01...)");
-    int result3 = InterruptMessage(ctrl_ep_out, 64, cmd3, &send_cb);
-    delay(12);  // Match USB capture timing
+    LOG_DEBUG(LED, "🔄 Step 3: LED index command (56 83 01...)\n");
+    int result3 = submitTransfer(ctrl_ep_out, 64, cmd3, &send_cb);
+    paceDelay(12);  // Match USB capture timing
     
-    Serial.println("🔄 Step 4: Mode command (41 80...)");
-    int result4 = InterruptMessage(ctrl_ep_out, 64, cmd4, &send_cb);
-    delay(9);   // Match USB capture timing
+    LOG_DEBUG(LED, "🔄 Step 4: Mode command (41 80...)\n");
+    int result4 = submitTransfer(ctrl_ep_out, 64, cmd4, &send_cb);
+    paceDelay(9);   // Match USB capture timing
     
-    Serial.println("🔄 Step 5: Final red command (51 28...)");
-    int result5 = InterruptMessage(ctrl_ep_out, 64, cmd5, &send_cb);
+    LOG_DEBUG(LED, "🔄 Step 5: Final red command (51 28...)\n");
+    int result5 = submitTransfer(ctrl_ep_out, 64, cmd5, &send_cb);
     
-    Serial.printf("📊 Results: %d %d %d %d %d\n", result1, result2, result3, result4, result5);
+    LOG_DEBUG(LED, "📊 Results: %d %d %d %d %d\n", result1, result2, result3, result4, result5);
     
     return (result1 == 0 && result2 == 0 && result3 == 0 && result4 == 0 && result5 == 0);
   }
 
   // NEW: 5-Command LED Protocol based on breakdown analysis
   bool send5CommandLEDSequence(uint8_t buttonNumber, uint8_t r, uint8_t g, uint8_t b) {
-    Serial.printf("🎯 Setting LED for button %d to RGB(%d,%d,%d) using 5-command protocol\n", buttonNumber, r, g, b);
+    LOG_DEBUG(LED, "🎯 Setting LED for button %d to RGB(%d,%d,%d) using 5-command protocol\n", buttonNumber, r, g, b);
     
     // Command 1: Set effect (custom mode)
     uint8_t cmd1_data[62] = {0};
@@ -307,10 +630,10 @@ public:
     cmd1_data[12] = 0xbb; cmd1_data[13] = 0xbb; cmd1_data[14] = 0xbb; cmd1_data[15] = 0xbb;
     
     if (!sendRawCommand(0x56, 0x81, cmd1_data, 62)) {
-      Serial.println("❌ Command 1 failed");
+      LOG_ERROR(LED, "❌ Command 1 failed\n");
       return false;
     }
-    delay(12);  // Match USB capture timing: ~10-12ms
+    paceDelay(12);  // Match USB capture timing: ~10-12ms
     
     // Command 2: Package 1 of 2 - LED data part 1
     uint8_t cmd2_data[62] = {0};
@@ -372,17 +695,17 @@ public:
     // For now, just handle the first 8 buttons to test the fix
     
     // Debug: Show the exact packet for verification
-    Serial.print("📦 Command 2 packet (first 32 bytes): ");
+    LOG_DEBUG(LED, "📦 Command 2 packet (first 32 bytes): ");
     for (int i = 0; i < 32; i++) {
-      Serial.printf("%02X", cmd2_data[i]);
+      LOG_DEBUG(LED, "%02X", cmd2_data[i]);
     }
-    Serial.println();
+    LOG_DEBUG(LED, "\n");
     
     if (!sendRawCommand(0x56, 0x83, cmd2_data, 62)) {
-      Serial.println("❌ Command 2 failed");
+      LOG_ERROR(LED, "❌ Command 2 failed\n");
       return false;
     }
-    delay(11);  // Match USB capture timing
+    paceDelay(11);  // Match USB capture timing
     
     // Command 3: Package 2 of 2 - remaining LED data
     uint8_t cmd3_data[62] = {0x01, 0x00}; // Only the data part, not command bytes
@@ -412,7 +735,7 @@ public:
     // Button 4 is at offsets 8,9,10
     if (buttonNumber == 4) {
       cmd3_data[8] = r; cmd3_data[9] = g; cmd3_data[10] = b;  // Button 4
-      Serial.printf("🎨 Setting Button 4 at cmd3 offset 8-10: RGB(%d,%d,%d)\n", r, g, b);
+      LOG_DEBUG(LED, "🎨 Setting Button 4 at cmd3 offset 8-10: RGB(%d,%d,%d)\n", r, g, b);
     } else {
       cmd3_data[8] = 0x65; cmd3_data[9] = 0x66; cmd3_data[10] = 0x67; // Default values
     }
@@ -426,212 +749,119 @@ public:
     // Button 5 is at offsets 23,24,25
     if (buttonNumber == 5) {
       cmd3_data[23] = r; cmd3_data[24] = g; cmd3_data[25] = b;  // Button 5
-      Serial.printf("🎨 Setting Button 5 at cmd3 offset 23-25: RGB(%d,%d,%d)\n", r, g, b);
+      LOG_DEBUG(LED, "🎨 Setting Button 5 at cmd3 offset 23-25: RGB(%d,%d,%d)\n", r, g, b);
     } else {
       cmd3_data[23] = 0x33; cmd3_data[24] = 0x34; cmd3_data[25] = 0x35; // Default values
     }
     
     if (!sendRawCommand(0x56, 0x83, cmd3_data, 62)) {
-      Serial.println("❌ Command 3 failed");
+      LOG_ERROR(LED, "❌ Command 3 failed\n");
       return false;
     }
-    delay(12);  // Match USB capture timing
+    paceDelay(12);  // Match USB capture timing
     
     // Command 4: Apply command
     uint8_t cmd4_data[62] = {0};
     if (!sendRawCommand(0x41, 0x80, cmd4_data, 62)) {
-      Serial.println("❌ Command 4 failed");
+      LOG_ERROR(LED, "❌ Command 4 failed\n");
       return false;
     }
-    delay(9);   // Match USB capture timing
+    paceDelay(9);   // Match USB capture timing
     
     // Command 5: Final command
     uint8_t cmd5_data[62] = {0xff, 0x00};
     if (!sendRawCommand(0x51, 0x28, cmd5_data, 62)) {
-      Serial.println("❌ Command 5 failed");
+      LOG_ERROR(LED, "❌ Command 5 failed\n");
       return false;
     }
     
-    Serial.println("✅ 5-command LED sequence completed!");
+    LOG_DEBUG(LED, "✅ 5-command LED sequence completed!\n");
     return true;
   }
 
   // NEW: Simplified test function using exact breakdown mapping
-  bool sendSimpleLEDTest(uint8_t buttonNumber, uint8_t r, uint8_t g, uint8_t b) {
-    Serial.printf("🧪 COMPLETE STATE LED Protocol: Button %d = RGB(%d,%d,%d)\n", buttonNumber, r, g, b);
-    
-    // Command 1: EXACT custom mode pattern from working capture
-    uint8_t cmd1[64] = {
-      0x56, 0x81, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0xbb, 0xbb, 0xbb, 0xbb,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-    };
-    
-    // Command 2: Complete LED state from working capture with ALL buttons defined
-    uint8_t cmd2[64] = {
-      0x56, 0x83, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 
-      // LED data starts here (position 24) - ALL 24 buttons get proper values
-      0xfb, 0xfc, 0xfd,  // Button 1 (positions 24-26) - default or target
-      0xfb, 0xfc, 0xfd,  // Button 6 (positions 27-29)
-      0xfb, 0xfc, 0xfd,  // Button 11 (positions 30-32)
-      0xfb, 0xfc, 0xfd,  // Button 16 (positions 33-35)
-      0xfb, 0xfc, 0xfd,  // Button 21 (positions 36-38)
-      0xc9, 0xca, 0xcb,  // Button 2 (positions 39-41)
-      0xc9, 0xca, 0xcb,  // Button 7 (positions 42-44)
-      0xc9, 0xca, 0xcb,  // Button 12 (positions 45-47)
-      0xc9, 0xca, 0xcb,  // Button 17 (positions 48-50)
-      0xc9, 0xca, 0xcb,  // Button 22 (positions 51-53)
-      0x97, 0x98, 0x99,  // Button 3 (positions 54-56)
-      0x97, 0x98, 0x99,  // Button 8 (positions 57-59)
-      0x97, 0x98, 0x99,  // Button 13 (positions 60-62)
-      0x97               // Button 18 R component (position 63)
-    };
-    
-    // Override the specific button with bright target color
-    if (buttonNumber == 1) {
-      cmd2[24] = r; cmd2[25] = g; cmd2[26] = b;  // Button 1
-    } else if (buttonNumber == 6) {
-      cmd2[27] = r; cmd2[28] = g; cmd2[29] = b;  // Button 6
-    } else if (buttonNumber == 11) {
-      cmd2[30] = r; cmd2[31] = g; cmd2[32] = b;  // Button 11   
-    } else if (buttonNumber == 16) {
-      cmd2[33] = r; cmd2[34] = g; cmd2[35] = b;  // Button 16
-    } else if (buttonNumber == 21) {
-      cmd2[36] = r; cmd2[37] = g; cmd2[38] = b;  // Button 21
-    } else if (buttonNumber == 2) {
-      cmd2[39] = r; cmd2[40] = g; cmd2[41] = b;  // Button 2
-    } else if (buttonNumber == 7) {
-      cmd2[42] = r; cmd2[43] = g; cmd2[44] = b;  // Button 7
-    } else if (buttonNumber == 12) {
-      cmd2[45] = r; cmd2[46] = g; cmd2[47] = b;  // Button 12
-    } else if (buttonNumber == 17) {
-      cmd2[48] = r; cmd2[49] = g; cmd2[50] = b;  // Button 17
-     } else if (buttonNumber == 22) {
-      cmd2[51] = r; cmd2[52] = g; cmd2[53] = b;  // Button 22
-    } else if (buttonNumber == 3) {
-      cmd2[54] = r; cmd2[55] = g; cmd2[56] = b;  // Button 3
-    } else if (buttonNumber == 8) {
-      cmd2[57] = r; cmd2[58] = g; cmd2[59] = b;  // Button 8
-  } else if (buttonNumber == 13) {
-      cmd2[60] = r; cmd2[61] = g; cmd2[62] = b;  // Button 13
-    } else if (buttonNumber == 18) {
-      cmd2[63] = r;  // Button 18 R component (continues in cmd3)
-    }
-    
-    // Command 3: Complete remaining LED state from working capture
-    uint8_t cmd3[64] = {
-      0x56, 0x83, 0x01,
-      0x00, 0x98, 0x99,        // Button 18 GB (positions 4-5) - continues from cmd2 R
-      0x97, 0x98, 0x99,        // Button 23 (positions 6-8)
-      0x65, 0x66, 0x67,        // Button 4 (positions 9-11)
-      0x65, 0x66, 0x67,        // Button 9 (positions 12-14)
-      0x65, 0x66, 0x67,        // Button 14 (positions 15-17)
-      0x65, 0x66, 0x67,        // Button 19 (positions 18-20)
-      0x65, 0x66, 0x67,        // Button 24 (positions 21-23)
-      0x33, 0x34, 0x35,        // Button 5 (positions 24-26) *** CORRECT POSITION ***
-      0x33, 0x34, 0x35,        // Button 10 (positions 27-29)
-      0x33, 0x34, 0x35,        // Button 15 (positions 30-32)
-      0x33, 0x34, 0x35,        // Button 20 (positions 33-35)
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-    };
-    
-    // Override specific buttons in cmd3 with target colors
-    if (buttonNumber == 18) {
-      // Complete Button 18 GB components (only 2 bytes in cmd3)
-      cmd3[4] = g; cmd3[5] = b;  // Button 18 GB (positions 4-5)
-    } else if (buttonNumber == 23) {
-      cmd3[6] = r; cmd3[7] = g; cmd3[8] = b;     // Button 23 (positions 6-8)
-    } else if (buttonNumber == 4) {
-      cmd3[9] = r; cmd3[10] = g; cmd3[11] = b;   // Button 4 (positions 9-11)
-    } else if (buttonNumber == 9) {
-      cmd3[12] = r; cmd3[13] = g; cmd3[14] = b;  // Button 9 (positions 12-14)
-    } else if (buttonNumber == 14) {
-      cmd3[15] = r; cmd3[16] = g; cmd3[17] = b;  // Button 14 (positions 15-17)
-    } else if (buttonNumber == 19) {
-      cmd3[18] = r; cmd3[19] = g; cmd3[20] = b;  // Button 19 (positions 18-20)
-    } else if (buttonNumber == 24) {
-      cmd3[21] = r; cmd3[22] = g; cmd3[23] = b;  // Button 24 (positions 21-23)
-     } else if (buttonNumber == 5) {
-      cmd3[24] = r; cmd3[25] = g; cmd3[26] = b;  // Button 5 (positions 24-26) *** FIXED ***
-    } else if (buttonNumber == 10) {
-      cmd3[27] = r; cmd3[28] = g; cmd3[29] = b;  // Button 10 (positions 27-29)
-    } else if (buttonNumber == 15) {
-      cmd3[30] = r; cmd3[31] = g; cmd3[32] = b;  // Button 15 (positions 30-32)
-    } else if (buttonNumber == 20) {
-      cmd3[33] = r; cmd3[34] = g; cmd3[35] = b;  // Button 20 (positions 33-35)
-    }
-    
-    // Commands 4 and 5: EXACT patterns from working capture
-    uint8_t cmd4[64] = {
-      0x41, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-    };
-    
-    uint8_t cmd5[64] = {
-      0x51, 0x28, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-    };
-    
-    Serial.printf("🎯 Sending COMPLETE LED state for button %d with all 24 buttons defined\n", buttonNumber);
-    
-    // Send the complete 5-command sequence
-    Serial.println("📤 Command 1: Custom mode");
-    int result1 = InterruptMessage(ctrl_ep_out, 64, cmd1, &send_cb);
-    if (result1 != 0) {
-      Serial.printf("❌ Command 1 failed: %d\n", result1);
-      return false;
-    }
-    delay(12);
-    
-    Serial.println("📤 Command 2: Complete LED state package 1");
-    int result2 = InterruptMessage(ctrl_ep_out, 64, cmd2, &send_cb);
-    if (result2 != 0) {
-      Serial.printf("❌ Command 2 failed: %d\n", result2);
+  // Renders the frame and queues it on the pacer; serviceLedFrames() sends it
+  // from loop() with the capture's gaps. corr_id != LATENCY_NO_ID marks the
+  // commit for press-to-light measurement.
+  bool sendSimpleLEDTest(uint8_t buttonNumber, uint8_t r, uint8_t g, uint8_t b, uint16_t corr_id = LATENCY_NO_ID,
+                         uint32_t press_us = 0) {
+    LOG_DEBUG(LED, "🧪 COMPLETE STATE LED Protocol: Button %d = RGB(%d,%d,%d)\n", buttonNumber, r, g, b);
+    // Runs from the LED handler; a press during init is not worth blocking loop() for
+    if (!initialized) {
+      LOG_WARN(LED, "⚠️ Device not initialized yet, LED feedback for button %d skipped\n", buttonNumber);
       return false;
     }
-    delay(11);
     
-    Serial.println("📤 Command 3: Complete LED state package 2");
-    int result3 = InterruptMessage(ctrl_ep_out, 64, cmd3, &send_cb);
-    if (result3 != 0) {
-      Serial.printf("❌ Command 3 failed: %d\n", result3);
-      return false;
+    // Only the newest state is worth sending: a frame still waiting is replaced
+    if (const PacedFrame* stale = ledPacer.waitingFrame()) {
+      driverStats.frames_coalesced.inc();
+      LOG_DEBUG(LED, "🔀 Frame for press %u replaced before it went out\n", stale->corr_id);
     }
-    delay(12);
+    uint8_t cpuPrev = cpuEnter(CPU_ENCODE);
     
-    Serial.println("📤 Command 4: Apply");
-    int result4 = InterruptMessage(ctrl_ep_out, 64, cmd4, &send_cb);
-    if (result4 != 0) {
-      Serial.printf("❌ Command 4 failed: %d\n", result4);
-      return false;
-    }
-    delay(9);
+    // Column background from the working capture with the target button on top
+    LedFrame frame;
+    renderPressFeedback(frame, buttonNumber, r, g, b);
     
-    Serial.println("📤 Command 5: Finalize");
-    int result5 = InterruptMessage(ctrl_ep_out, 64, cmd5, &send_cb);
-    if (result5 != 0) {
-      Serial.printf("❌ Command 5 failed: %d\n", result5);
-      return false;
-    }
+    // Mode, LED data part 1 and 2, commit, finalize
+    PacedFrame& paced = ledPacer.next();
+    encodeLedFrame(frame, paced.packets);
+    paced.corr_id = corr_id;
+    paced.press_us = press_us;
+    paced.queued_us = micros();
+    ledPacer.queue();
     
-    Serial.printf("✅ COMPLETE LED state sent - Button %d highlighted!\n", buttonNumber);
+    cpuLeave(cpuPrev);
+    LOG_DEBUG(LED, "🎯 COMPLETE LED state for button %d queued with all 24 buttons defined\n", buttonNumber);
     return true;
   }
 
+  // Submits the LED frame packets that are due; called on every loop() pass.
+  // The press-to-light sample opens when a frame starts going out, so the
+  // tracker still follows one frame at a time.
+  void serviceLedFrames() {
+    if (!ledPacer.busy()) return;
+    struct Port {
+      USBControlPad* pad;
+      
+      void start(const PacedFrame& f) {
+        if (f.corr_id != LATENCY_NO_ID) pressLatency.begin(f.corr_id, f.press_us, f.queued_us);
+      }
+      
+      int submit(uint8_t i, uint8_t* packet, const PacedFrame& f) {
+        static const char* const names[LED_FRAME_PACKETS] = {
+          "Custom mode", "Complete LED state package 1", "Complete LED state package 2", "Apply", "Finalize"};
+        LOG_DEBUG(LED, "📤 Command %d: %s\n", i + 1, names[i]);
+        bool measured = i == LED_FRAME_COMMIT && f.corr_id != LATENCY_NO_ID;
+        if (measured) {
+          // Recorded before submitting so the completion can never beat it
+          pad->commit_id = f.corr_id;
+          pressLatency.submit(micros());
+        }
+        return pad->submitTransfer(pad->ctrl_ep_out, 64, packet, measured ? &pad->commit_cb : &pad->send_cb);
+      }
+      
+      void refused(const PacedFrame& f, uint8_t i, int result) {
+        LOG_ERROR(LED, "❌ Command %d failed: %d\n", i + 1, result);
+        if (f.corr_id != LATENCY_NO_ID && i <= LED_FRAME_COMMIT) pressLatency.cancel();
+      }
+    } port = {this};
+    
+    CpuScope render(CPU_RENDER);
+    ledPacer.service(micros(), port);
+  }
+  
+  bool ledFramesPending() const { return ledPacer.busy(); }
+  uint32_t ledFrameDueUs() const { return ledPacer.dueUs(micros()); }   // Next packet, while pending
+  uint16_t commitPressId() const { return commit_id; }                  // Press of the commit in flight
+
   bool sendExactLEDCommand() {
     // Call the complete red sequence
     return sendCompleteRedSequence();
   }
 
   bool sendGreenPattern() {
-    Serial.println("🟢 Sending COMPLETE GREEN sequence (5 steps)");
+    LOG_DEBUG(LED, "🟢 Sending COMPLETE GREEN sequence (5 steps)\n");
     
     // Step 1: Setup command (same as red)
     uint8_t cmd1[64] = {
@@ -673,32 +903,32 @@ public:
       0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
     };
     
-    Serial.println("🔄 GREEN Step 1: Setup command");
-    int result1 = InterruptMessage(ctrl_ep_out, 64, cmd1, &send_cb);
-    delay(50);
+    LOG_DEBUG(LED, "🔄 GREEN Step 1: Setup command\n");
+    int result1 = submitTransfer(ctrl_ep_out, 64, cmd1, &send_cb);
+    paceDelay(50);
     
-    Serial.println("🔄 GREEN Step 2: Main LED command");
-    int result2 = InterruptMessage(ctrl_ep_out, 64, cmd2, &send_cb);
-    delay(50);
+    LOG_DEBUG(LED, "🔄 GREEN Step 2: Main LED command\n");
+    int result2 = submitTransfer(ctrl_ep_out, 64, cmd2, &send_cb);
+    paceDelay(50);
     
-    Serial.println("🔄 GREEN Step 3: LED index command");
-    int result3 = InterruptMessage(ctrl_ep_out, 64, cmd3, &send_cb);
-    delay(50);
+    LOG_DEBUG(LED, "🔄 GREEN Step 3: LED index command\n");
+    int result3 = submitTransfer(ctrl_ep_out, 64, cmd3, &send_cb);
+    paceDelay(50);
     
-    Serial.println("🔄 GREEN Step 4: Mode command");
-    int result4 = InterruptMessage(ctrl_ep_out, 64, cmd4, &send_cb);
-    delay(50);
+    LOG_DEBUG(LED, "🔄 GREEN Step 4: Mode command\n");
+    int result4 = submitTransfer(ctrl_ep_out, 64, cmd4, &send_cb);
+    paceDelay(50);
     
-    Serial.println("🔄 GREEN Step 5: Final green command");
-    int result5 = InterruptMessage(ctrl_ep_out, 64, cmd5, &send_cb);
+    LOG_DEBUG(LED, "🔄 GREEN Step 5: Final green command\n");
+    int result5 = submitTransfer(ctrl_ep_out, 64, cmd5, &send_cb);
     
-    Serial.printf("📊 GREEN Results: %d %d %d %d %d\n", result1, result2, result3, result4, result5);
+    LOG_DEBUG(LED, "📊 GREEN Results: %d %d %d %d %d\n", result1, result2, result3, result4, result5);
     
     return (result1 == 0 && result2 == 0 && result3 == 0 && result4 == 0 && result5 == 0);
   }
 
   bool sendBluePattern() {
-    Serial.println("🔵 Sending COMPLETE BLUE sequence (5 steps)");
+    LOG_DEBUG(LED, "🔵 Sending COMPLETE BLUE sequence (5 steps)\n");
     
     // Steps 1, 3, 4 same as red - only step 2 and 5 change for blue
     uint8_t cmd1[64] = {
@@ -736,17 +966,17 @@ public:
       0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
     };
     
-    InterruptMessage(ctrl_ep_out, 64, cmd1, &send_cb); delay(50);
-    InterruptMessage(ctrl_ep_out, 64, cmd2, &send_cb); delay(50);
-    InterruptMessage(ctrl_ep_out, 64, cmd3, &send_cb); delay(50);
-    InterruptMessage(ctrl_ep_out, 64, cmd4, &send_cb); delay(50);
-    InterruptMessage(ctrl_ep_out, 64, cmd5, &send_cb);
+    submitTransfer(ctrl_ep_out, 64, cmd1, &send_cb); paceDelay(50);
+    submitTransfer(ctrl_ep_out, 64, cmd2, &send_cb); paceDelay(50);
+    submitTransfer(ctrl_ep_out, 64, cmd3, &send_cb); paceDelay(50);
+    submitTransfer(ctrl_ep_out, 64, cmd4, &send_cb); paceDelay(50);
+    submitTransfer(ctrl_ep_out, 64, cmd5, &send_cb);
     
     return true;
   }
 
   bool sendYellowPattern() {
-    Serial.println("🟡 Sending COMPLETE YELLOW sequence (5 steps)");
+    LOG_DEBUG(LED, "🟡 Sending COMPLETE YELLOW sequence (5 steps)\n");
     
     uint8_t cmd1[64] = {
       0x56, 0x81, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0xbb, 0xbb, 0xbb, 0xbb,
@@ -783,17 +1013,17 @@ public:
       0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
     };
     
-    InterruptMessage(ctrl_ep_out, 64, cmd1, &send_cb); delay(50);
-    InterruptMessage(ctrl_ep_out, 64, cmd2, &send_cb); delay(50);
-    InterruptMessage(ctrl_ep_out, 64, cmd3, &send_cb); delay(50);
-    InterruptMessage(ctrl_ep_out, 64, cmd4, &send_cb); delay(50);
-    InterruptMessage(ctrl_ep_out, 64, cmd5, &send_cb);
+    submitTransfer(ctrl_ep_out, 64, cmd1, &send_cb); paceDelay(50);
+    submitTransfer(ctrl_ep_out, 64, cmd2, &send_cb); paceDelay(50);
+    submitTransfer(ctrl_ep_out, 64, cmd3, &send_cb); paceDelay(50);
+    submitTransfer(ctrl_ep_out, 64, cmd4, &send_cb); paceDelay(50);
+    submitTransfer(ctrl_ep_out, 64, cmd5, &send_cb);
     
     return true;
   }
 
   bool sendPurplePattern() {
-    Serial.println("🟣 Sending COMPLETE PURPLE sequence (5 steps)");
+    LOG_DEBUG(LED, "🟣 Sending COMPLETE PURPLE sequence (5 steps)\n");
     
     uint8_t cmd1[64] = {
       0x56, 0x81, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0xbb, 0xbb, 0xbb, 0xbb,
@@ -830,17 +1060,17 @@ public:
       0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
     };
     
-    InterruptMessage(ctrl_ep_out, 64, cmd1, &send_cb); delay(50);
-    InterruptMessage(ctrl_ep_out, 64, cmd2, &send_cb); delay(50);
-    InterruptMessage(ctrl_ep_out, 64, cmd3, &send_cb); delay(50);
-    InterruptMessage(ctrl_ep_out, 64, cmd4, &send_cb); delay(50);
-    InterruptMessage(ctrl_ep_out, 64, cmd5, &send_cb);
+    submitTransfer(ctrl_ep_out, 64, cmd1, &send_cb); paceDelay(50);
+    submitTransfer(ctrl_ep_out, 64, cmd2, &send_cb); paceDelay(50);
+    submitTransfer(ctrl_ep_out, 64, cmd3, &send_cb); paceDelay(50);
+    submitTransfer(ctrl_ep_out, 64, cmd4, &send_cb); paceDelay(50);
+    submitTransfer(ctrl_ep_out, 64, cmd5, &send_cb);
     
     return true;
   }
 
   bool sendWhitePattern() {
-    Serial.println("⚪ Sending COMPLETE WHITE sequence (5 steps)");
+    LOG_DEBUG(LED, "⚪ Sending COMPLETE WHITE sequence (5 steps)\n");
     
     uint8_t cmd1[64] = {
       0x56, 0x81, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0xbb, 0xbb, 0xbb, 0xbb,
@@ -877,17 +1107,17 @@ public:
       0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
     };
     
-    InterruptMessage(ctrl_ep_out, 64, cmd1, &send_cb); delay(50);
-    InterruptMessage(ctrl_ep_out, 64, cmd2, &send_cb); delay(50);
-    InterruptMessage(ctrl_ep_out, 64, cmd3, &send_cb); delay(50);
-    InterruptMessage(ctrl_ep_out, 64, cmd4, &send_cb); delay(50);
-    InterruptMessage(ctrl_ep_out, 64, cmd5, &send_cb);
+    submitTransfer(ctrl_ep_out, 64, cmd1, &send_cb); paceDelay(50);
+    submitTransfer(ctrl_ep_out, 64, cmd2, &send_cb); paceDelay(50);
+    submitTransfer(ctrl_ep_out, 64, cmd3, &send_cb); paceDelay(50);
+    submitTransfer(ctrl_ep_out, 64, cmd4, &send_cb); paceDelay(50);
+    submitTransfer(ctrl_ep_out, 64, cmd5, &send_cb);
     
     return true;
   }
 
   bool sendButtonSpecificRed(uint8_t buttonIndex) {
-    Serial.printf("🔴 Sending RED to specific button %d (5 steps)\n", buttonIndex);
+    LOG_DEBUG(LED, "🔴 Sending RED to specific button %d (5 steps)\n", buttonIndex);
     
     // Step 1: Setup command (same)
     uint8_t cmd1[64] = {
@@ -929,20 +1159,20 @@ public:
       0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
     };
     
-    Serial.printf("🔄 RED Step 1: Setup command\n");
-    InterruptMessage(ctrl_ep_out, 64, cmd1, &send_cb); delay(50);
+    LOG_DEBUG(LED, "🔄 RED Step 1: Setup command\n");
+    submitTransfer(ctrl_ep_out, 64, cmd1, &send_cb); paceDelay(50);
     
-    Serial.printf("🔄 RED Step 2: Main LED command\n");
-    InterruptMessage(ctrl_ep_out, 64, cmd2, &send_cb); delay(50);
+    LOG_DEBUG(LED, "🔄 RED Step 2: Main LED command\n");
+    submitTransfer(ctrl_ep_out, 64, cmd2, &send_cb); paceDelay(50);
     
-    Serial.printf("🔄 RED Step 3: LED index command (button %d)\n", buttonIndex);
-    InterruptMessage(ctrl_ep_out, 64, cmd3, &send_cb); delay(50);
+    LOG_DEBUG(LED, "🔄 RED Step 3: LED index command (button %d)\n", buttonIndex);
+    submitTransfer(ctrl_ep_out, 64, cmd3, &send_cb); paceDelay(50);
     
-    Serial.printf("🔄 RED Step 4: Mode command\n");
-    InterruptMessage(ctrl_ep_out, 64, cmd4, &send_cb); delay(50);
+    LOG_DEBUG(LED, "🔄 RED Step 4: Mode command\n");
+    submitTransfer(ctrl_ep_out, 64, cmd4, &send_cb); paceDelay(50);
     
-    Serial.printf("🔄 RED Step 5: Final red command\n");
-    InterruptMessage(ctrl_ep_out, 64, cmd5, &send_cb);
+    LOG_DEBUG(LED, "🔄 RED Step 5: Final red command\n");
+    submitTransfer(ctrl_ep_out, 64, cmd5, &send_cb);
     
     return true;
   }
@@ -950,7 +1180,7 @@ public:
   bool sendLEDCommand(uint8_t ledIndex, uint8_t r, uint8_t g, uint8_t b) {
     // For now, if trying to set LED 1 to red, use the exact pattern
     if (ledIndex == 1 && r == 255 && g == 0 && b == 0) {
-      Serial.println("🔴 Using EXACT red pattern for button 1");
+      LOG_DEBUG(LED, "🔴 Using EXACT red pattern for button 1\n");
       return sendExactLEDCommand();
     }
     
@@ -970,30 +1200,30 @@ public:
     packet.data[6] = 0xFF;
     packet.data[7] = 0x00;
     
-    Serial.printf("📤 Sending NEW LED command: 0x%02X 0x%02X 0x%02X [%02X %02X %02X] to EP 0x%02X\n", 
+    LOG_DEBUG(LED, "📤 Sending NEW LED command: 0x%02X 0x%02X 0x%02X [%02X %02X %02X] to EP 0x%02X\n", 
                   packet.vendor_id, packet.cmd1, packet.cmd2, r, g, b, ctrl_ep_out);
     
     // Add retry logic for LED commands
     int maxRetries = 3;
     for (int attempt = 0; attempt < maxRetries; attempt++) {
       // Send via interrupt transfer to the LED control OUT endpoint
-      int result = InterruptMessage(ctrl_ep_out, 64, &packet, &send_cb);
+      int result = submitTransfer(ctrl_ep_out, 64, &packet, &send_cb);
       if (result == 0) {
         if (attempt > 0) {
-          Serial.printf("✅ NEW LED Command succeeded on attempt %d\n", attempt + 1);
+          LOG_DEBUG(LED, "✅ NEW LED Command succeeded on attempt %d\n", attempt + 1);
         } else {
-          Serial.println("✅ NEW LED Command queued successfully");
+          LOG_DEBUG(LED, "✅ NEW LED Command queued successfully\n");
         }
         return true;
       } else {
-        Serial.printf("⚠️ NEW LED Command attempt %d failed: %d\n", attempt + 1, result);
+        LOG_WARN(LED, "⚠️ NEW LED Command attempt %d failed: %d\n", attempt + 1, result);
         if (attempt < maxRetries - 1) {
-          delay(20);  // Wait before retry
+          paceDelay(20);  // Wait before retry
         }
       }
     }
     
-    Serial.printf("❌ NEW LED Command failed after %d attempts\n", maxRetries);
+    LOG_ERROR(LED, "❌ NEW LED Command failed after %d attempts\n", maxRetries);
     return false;
   }
   
@@ -1010,35 +1240,35 @@ public:
       memcpy(&packet[2], data, copyLen);
     }
     
-    Serial.printf("📤 Sending 64-byte command: 0x%02X 0x%02X (data len: %zu)\n", cmd1, cmd2, dataLen);
+    LOG_DEBUG(LED, "📤 Sending 64-byte command: 0x%02X 0x%02X (data len: %zu)\n", cmd1, cmd2, dataLen);
     
     // Send raw 64-byte packet to control endpoint
     int maxRetries = 3;
     for (int attempt = 0; attempt < maxRetries; attempt++) {
-      int result = InterruptMessage(ctrl_ep_out, 64, packet, &send_cb);
+      int result = submitTransfer(ctrl_ep_out, 64, packet, &send_cb);
       if (result == 0) {
         if (attempt > 0) {
-          Serial.printf("✅ 64-byte command succeeded on attempt %d\n", attempt + 1);
+          LOG_DEBUG(LED, "✅ 64-byte command succeeded on attempt %d\n", attempt + 1);
         }
         return true;
       } else {
-        Serial.printf("⚠️ 64-byte command attempt %d failed: %d\n", attempt + 1, result);
+        LOG_WARN(LED, "⚠️ 64-byte command attempt %d failed: %d\n", attempt + 1, result);
         if (attempt < maxRetries - 1) {
-          delay(20);
+          paceDelay(20);
         }
       }
     }
     
-    Serial.printf("❌ 64-byte command failed after %d attempts\n", maxRetries);
+    LOG_ERROR(LED, "❌ 64-byte command failed after %d attempts\n", maxRetries);
     return false;
   }
 
   // NEW: Test both packet sizes to see which works
   bool sendTestPacket(uint8_t cmd1, uint8_t cmd2, uint8_t* data, size_t dataLen) {
-    Serial.printf("🧪 Testing packet sizes for command 0x%02X 0x%02X\n", cmd1, cmd2);
+    LOG_DEBUG(LED, "🧪 Testing packet sizes for command 0x%02X 0x%02X\n", cmd1, cmd2);
     
     // Try 64-byte first (traditional USB interrupt packet size)
-    Serial.println("   Trying 64-byte packet...");
+    LOG_DEBUG(LED, "   Trying 64-byte packet...\n");
     uint8_t packet64[64] = {0};
     packet64[0] = cmd1;
     packet64[1] = cmd2;
@@ -1047,18 +1277,18 @@ public:
       memcpy(&packet64[2], data, copyLen);
     }
     
-    int result64 = InterruptMessage(ctrl_ep_out, 64, packet64, &send_cb);
-    Serial.printf("   64-byte result: %d\n", result64);
+    int result64 = submitTransfer(ctrl_ep_out, 64, packet64, &send_cb);
+    LOG_DEBUG(LED, "   64-byte result: %d\n", result64);
     
     if (result64 == 0) {
-      Serial.println("✅ 64-byte packet worked!");
+      LOG_DEBUG(LED, "✅ 64-byte packet worked!\n");
       return true;
     }
     
-    delay(50);
+    paceDelay(50);
     
     // Try 91-byte if 64 failed
-    Serial.println("   Trying 91-byte packet...");
+    LOG_DEBUG(LED, "   Trying 91-byte packet...\n");
     uint8_t packet91[91] = {0};
     packet91[0] = cmd1;
     packet91[1] = cmd2;
@@ -1067,21 +1297,21 @@ public:
       memcpy(&packet91[2], data, copyLen);
     }
     
-    int result91 = InterruptMessage(ctrl_ep_out, 91, packet91, &send_cb);
-    Serial.printf("   91-byte result: %d\n", result91);
+    int result91 = submitTransfer(ctrl_ep_out, 91, packet91, &send_cb);
+    LOG_DEBUG(LED, "   91-byte result: %d\n", result91);
     
     if (result91 == 0) {
-      Serial.println("✅ 91-byte packet worked!");
+      LOG_DEBUG(LED, "✅ 91-byte packet worked!\n");
       return true;
     }
     
-    Serial.println("❌ Both packet sizes failed!");
+    LOG_ERROR(LED, "❌ Both packet sizes failed!\n");
     return false;
   }
 
   bool sendCommand(uint8_t cmd1, uint8_t cmd2, uint8_t* extraData = nullptr, size_t extraLen = 0) {
     if (!initialized) {
-      Serial.println("❌ Device not initialized");
+      LOG_ERROR(LED, "❌ Device not initialized\n");
       return false;
     }
     
@@ -1094,13 +1324,13 @@ public:
       memcpy(packet.data, extraData, copyLen);
     }
     
-    Serial.printf("📤 Sending cmd [%02X %02X] to EP 0x%02X\n", cmd1, cmd2, ctrl_ep_out);
+    LOG_DEBUG(LED, "📤 Sending cmd [%02X %02X] to EP 0x%02X\n", cmd1, cmd2, ctrl_ep_out);
     
     // Use callback-based transfer
-    int result = InterruptMessage(ctrl_ep_out, 64, (uint8_t*)&packet, &send_cb);
+    int result = submitTransfer(ctrl_ep_out, 64, (uint8_t*)&packet, &send_cb);
     
     if (result != 0) {
-      Serial.printf("❌ Command failed with result: %d\n", result);
+      LOG_ERROR(LED, "❌ Command failed with result: %d\n", result);
     }
     
     return (result == 0);
@@ -1109,91 +1339,87 @@ public:
   // Helper function for sending raw control data
   int sendControlData(uint8_t* data, size_t length) {
     if (length > 64) {
-      Serial.printf("❌ Data too large: %d bytes (max 64)\n", length);
+      LOG_ERROR(LED, "❌ Data too large: %d bytes (max 64)\n", length);
       return -2;
     }
-    Serial.printf("📤 Sending %d bytes to EP 0x%02X\n", length, ctrl_ep_out);
-    return InterruptMessage(ctrl_ep_out, length, data, &send_cb);
+    LOG_DEBUG(LED, "📤 Sending %d bytes to EP 0x%02X\n", length, ctrl_ep_out);
+    return submitTransfer(ctrl_ep_out, length, data, &send_cb);
   }
 
   bool checkDeviceHealth() {
-    Serial.println("🔍 Checking device health...");
+    LOG_INFO(USB, "🔍 Checking device health...\n");
     
     // Check if we have valid endpoints
     if (ctrl_ep_out == 0) {
-      Serial.println("❌ Control OUT endpoint not set!");
+      LOG_ERROR(USB, "❌ Control OUT endpoint not set!\n");
       return false;
     }
     
     if (ctrl_ep_in == 0) {
-      Serial.println("❌ Control IN endpoint not set!");
+      LOG_ERROR(USB, "❌ Control IN endpoint not set!\n");
       return false;
     }
     
     // Check polling status
     if (!kbd_polling && !ctrl_polling) {
-      Serial.println("❌ No polling active!");
+      LOG_ERROR(USB, "❌ No polling active!\n");
       return false;
     }
     
-    Serial.printf("✅ Device appears healthy:\n");
-    Serial.printf("   - Control OUT EP: 0x%02X\n", ctrl_ep_out);
-    Serial.printf("   - Control IN EP: 0x%02X\n", ctrl_ep_in);
-    Serial.printf("   - Keyboard polling: %s\n", kbd_polling ? "ACTIVE" : "INACTIVE");
-    Serial.printf("   - Control polling: %s\n", ctrl_polling ? "ACTIVE" : "INACTIVE");
-    Serial.printf("   - Initialized: %s\n", initialized ? "YES" : "NO");
+    LOG_INFO(USB, "✅ Device appears healthy:\n");
+    LOG_INFO(USB, "   - Control OUT EP: 0x%02X\n", ctrl_ep_out);
+    LOG_INFO(USB, "   - Control IN EP: 0x%02X\n", ctrl_ep_in);
+    LOG_INFO(USB, "   - Keyboard polling: %s\n", kbd_polling ? "ACTIVE" : "INACTIVE");
+    LOG_INFO(USB, "   - Control polling: %s\n", ctrl_polling ? "ACTIVE" : "INACTIVE");
+    LOG_INFO(USB, "   - Initialized: %s\n", initialized ? "YES" : "NO");
     
     return true;
   }
   
   bool setLEDs(uint8_t r, uint8_t g, uint8_t b) {
-    Serial.printf("🎯 Setting LED color using NEW PROTOCOL: R=%d G=%d B=%d\n", r, g, b);
+    LOG_DEBUG(LED, "🎯 Setting LED color using NEW PROTOCOL: R=%d G=%d B=%d\n", r, g, b);
     
     // Check device health first
     if (!checkDeviceHealth()) {
-      Serial.println("❌ Device health check failed, aborting LED operation");
+      LOG_ERROR(LED, "❌ Device health check failed, aborting LED operation\n");
       return false;
     }
     
-    if (!initialized) {
-      Serial.println("⚠️ Device not initialized yet, initializing now...");
-      initializeDevice();
-      delay(500);  // Give initialization time to complete
-    }
+    if (!waitForInit()) return false;
     
     // Test with NEW protocol - just set button 1 to the specified color
-    Serial.println("🔧 Using NEW LED protocol from USB capture...");
+    LOG_DEBUG(LED, "🔧 Using NEW LED protocol from USB capture...\n");
     
     if (sendLEDCommand(1, r, g, b)) {
-      Serial.println("✅ NEW LED Protocol command sent successfully!");
+      LOG_DEBUG(LED, "✅ NEW LED Protocol command sent successfully!\n");
       return true;
     } else {
-      Serial.println("❌ NEW LED Protocol failed, trying old approach...");
+      LOG_ERROR(LED, "❌ NEW LED Protocol failed, trying old approach...\n");
       
       // Fallback to old protocol if new one fails
-      Serial.println("📡 Fallback: Using old LED protocol...");
+      LOG_DEBUG(LED, "📡 Fallback: Using old LED protocol...\n");
       
       // STEP 1: Switch to custom mode (if not already done)
       if (!sendCommand(0x1E, 0x00)) {  // Disable effects
-        Serial.println("❌ Failed to disable effects, continuing anyway...");
+        LOG_ERROR(LED, "❌ Failed to disable effects, continuing anyway...\n");
       }
-      delay(100);
+      paceDelay(100);
       
       // STEP 2: Set custom mode with proper timing
       uint8_t customModeData[] = {0x01, 0x00, 0x00, 0x00};
       if (!sendCommand(0x1C, 0x01, customModeData, 4)) {
-        Serial.println("❌ Failed to set custom mode, continuing anyway...");
+        LOG_ERROR(LED, "❌ Failed to set custom mode, continuing anyway...\n");
       }
-      delay(200);  // Longer delay for mode switch
+      paceDelay(200);  // Longer delay for mode switch
       
       // STEP 3: Try setting just one LED with old protocol
       uint8_t colorData[] = {r, g, b, 0xFF};
       if (sendCommand(0x18, 1, colorData, 4)) {
-        Serial.println("✅ Old protocol LED command sent");
+        LOG_DEBUG(LED, "✅ Old protocol LED command sent\n");
         // Apply changes
-        delay(100);
+        paceDelay(100);
         if (sendCommand(0x1F, 0x01)) {
-          Serial.println("✅ Old protocol LED changes applied");
+          LOG_DEBUG(LED, "✅ Old protocol LED changes applied\n");
           return true;
         }
       }
@@ -1202,382 +1428,388 @@ public:
     }
   }
   
-  bool initializeProfiles() {
-    Serial.println("🎮 INITIALIZING DEVICE PROFILES...");
-    
-    // Profile enumeration sequence from working capture: 0x52 0x80 0x00-0x17
-    // This appears to be required before LED control becomes functional
-    for (uint8_t profile = 0x00; profile <= 0x17; profile++) {
-      uint8_t profileCmd[64] = {0};
-      profileCmd[0] = 0x52;
-      profileCmd[1] = 0x80;
-      profileCmd[2] = profile;
-      
-      Serial.printf("📋 Setting profile %02X...\n", profile);
-      sendControlData(profileCmd, 64);
-      delay(10); // Small delay between profile commands
-    }
-    
-    Serial.println("✅ Profile initialization complete");
-    return true;
+  void initializeStatePackets() {
+    ledState.clear();
+    encodeStatePackets();
   }
 
+  void encodeStatePackets() {
+    encodeLedData(ledState, 0, statePacket1);
+    encodeLedData(ledState, 1, statePacket2);
+  }
+
+  // Initialization runs as an asynchronous sequence: each command is submitted only
+  // after the previous OUT transfer completed (see initSent()), so nothing here
+  // blocks the USB host thread with delay(). Steps marked skippable are the 24
+  // profile reads (52 80 xx) the official editor issues at boot; the device
+  // answers them on EP 0x83 but they are not needed to drive the LEDs in custom
+  // mode. LED commands are refused until the sequence has finished, see
+  // waitForInit().
   bool initializeDevice() {
     if (initialized) return true;
+    if (init_running) return false;  // Sequence already in flight
     
-    Serial.println("🔧 INITIALIZING CONTROLPAD DEVICE...");
+    LOG_INFO(INIT, "🔧 INITIALIZING CONTROLPAD DEVICE...\n");
     
     if (!checkDeviceHealth()) {
-      Serial.println("❌ Device health check failed");
+      LOG_ERROR(INIT, "❌ Device health check failed\n");
       return false;
     }
     
-    // Start dual interface polling first
-    startDualPolling();
-    delay(100);
-    
-    // CRITICAL: Device initialization commands (from working capture)
-    Serial.println("🔧 Sending device initialization commands...");
+    initializeStatePackets();
     
-    // Command 1: 42000000010000010000...
-    uint8_t initCmd1[64] = {0};
-    initCmd1[0] = 0x42; initCmd1[1] = 0x00; initCmd1[2] = 0x00; initCmd1[3] = 0x00;
-    initCmd1[4] = 0x01; initCmd1[5] = 0x00; initCmd1[6] = 0x00; initCmd1[7] = 0x01;
-    sendControlData(initCmd1, 64);
-    delay(20);
+    init_running = true;
+    init_step = 0;
+    init_repeat = 0;
+    init_attempt = 0;
+    init_sent = 0;
+    init_skipped = 0;
+    init_start_us = micros();
     
-    // Command 2: 42100000010000010000...
-    uint8_t initCmd2[64] = {0};
-    initCmd2[0] = 0x42; initCmd2[1] = 0x10; initCmd2[2] = 0x00; initCmd2[3] = 0x00;
-    initCmd2[4] = 0x01; initCmd2[5] = 0x00; initCmd2[6] = 0x00; initCmd2[7] = 0x01;
-    sendControlData(initCmd2, 64);
-    delay(20);
-    
-    // Command 3: 43000000010000000000...
-    uint8_t initCmd3[64] = {0};
-    initCmd3[0] = 0x43; initCmd3[1] = 0x00; initCmd3[2] = 0x00; initCmd3[3] = 0x00;
-    initCmd3[4] = 0x01; initCmd3[5] = 0x00; initCmd3[6] = 0x00; initCmd3[7] = 0x00;
-    sendControlData(initCmd3, 64);
-    delay(20);
-    
-    // Commit initialization
-    sendCommitCommand();
-    delay(50);
-
-    // CRITICAL: Initialize profiles first (required for LED control)
-    Serial.println("🎮 Initializing device profiles...");
-    if (!initializeProfiles()) {
-      Serial.println("❌ Failed to initialize profiles");
-      return false;
+    LOG_INFO(INIT, "🔧 Starting %s init sequence...\n", CONTROLPAD_FAST_BOOT ? "FAST" : "FULL");
+    sendInitStep();
+    return false;  // Completes asynchronously, see finishInitSequence()
+  }
+  
+  void sendInitStep() {
+    // Skip over steps the fast-boot profile does not need
+    while (init_step < INIT_STEP_COUNT && CONTROLPAD_FAST_BOOT && CONTROLPAD_INIT_STEPS[init_step].skippable) {
+      init_skipped += CONTROLPAD_INIT_STEPS[init_step].repeat;
+      init_step++;
     }
-    delay(100);
     
-    // Set to custom mode for LED control
-    Serial.println("🎨 Setting device to CUSTOM MODE for LED control...");
-    if (!switchToCustomMode()) {
-      Serial.println("❌ Failed to switch to custom mode");
-      return false;
+    if (init_step >= INIT_STEP_COUNT) {
+      finishInitSequence();
+      return;
     }
-    delay(100);
     
-    // Initialize state buffers with exact headers from working capture
-    memset(statePacket1, 0, sizeof(statePacket1));
-    memset(statePacket2, 0, sizeof(statePacket2));
+    const ControlPadInitStep& step = CONTROLPAD_INIT_STEPS[init_step];
+    buildInitCommand(step, init_repeat, init_cmd);
     
-    // Packet 1: 568300000100000080010000...RGB data... 
-    statePacket1[0]=0x56; statePacket1[1]=0x83; statePacket1[2]=0x00; statePacket1[3]=0x00;
-    statePacket1[4]=0x01; statePacket1[5]=0x00; statePacket1[6]=0x00; statePacket1[7]=0x00;
-    statePacket1[8]=0x80; statePacket1[9]=0x01; statePacket1[10]=0x00; statePacket1[11]=0x00;
+    int result = submitTransfer(ctrl_ep_out, 64, init_cmd, &init_cb);
+    if (result != 0) {
+      LOG_ERROR(INIT, "❌ Init step '%s' could not be submitted: %d\n", step.label, result);
+      init_running = false;
+    }
+  }
+  
+  // Completion of init_cmd. Other EP 0x04 transfers complete through send_cb
+  // and never advance the sequence.
+  void initSent(int result) {
+    sent(result);
+    if (init_running) advanceInitSequence(result);
+  }
+  
+  void advanceInitSequence(int result) {
+    if (result < 0) {
+      if (++init_attempt < 3) {
+        LOG_WARN(INIT, "⚠️ Init step '%s' failed (%d), retrying\n", CONTROLPAD_INIT_STEPS[init_step].label, result);
+        sendInitStep();
+      } else {
+        LOG_ERROR(INIT, "❌ Init step '%s' failed after %d attempts\n", CONTROLPAD_INIT_STEPS[init_step].label, init_attempt);
+        init_running = false;
+      }
+      return;
+    }
     
-    // Packet 2: 56830100...RGB data...
-    statePacket2[0]=0x56; statePacket2[1]=0x83; statePacket2[2]=0x01; statePacket2[3]=0x00;
+    trace(TRACE_INIT_STEP, init_step, result);
+    init_attempt = 0;
+    init_sent++;
+    bootTrace.mark(BOOT_INIT_COMMAND, init_cmd[0], micros());
+    if (++init_repeat >= CONTROLPAD_INIT_STEPS[init_step].repeat) {
+      init_repeat = 0;
+      init_step++;
+    }
+    sendInitStep();
+  }
+  
+  void finishInitSequence() {
+    uint32_t total_us = micros() - init_start_us;
+    init_running = false;
     initialized = true;
+    bootTrace.mark(BOOT_INIT_DONE, init_sent, micros());
+    
+    LOG_INFO(INIT, "⏱️ Init sequence done in %luus: %d cmds sent, %d skipped\n",
+                  (unsigned long)total_us, init_sent, init_skipped);
     
-    Serial.println("✅ ControlPad device initialized successfully");
-    Serial.println("🎯 Ready for LED commands!");
+    LOG_INFO(INIT, "✅ ControlPad device initialized successfully\n");
+    LOG_INFO(INIT, "🎯 Ready for LED commands!\n");
+  }
+  
+  // Starts init if needed and waits for it to finish, for the LED commands run
+  // from loop() and the serial console. Init is completion-paced, so this polls
+  // rather than sleeping a fixed time; never call it from a USB callback.
+  // These commands send their packets back to back, so a press feedback frame
+  // still going out through the pacer is finished first rather than interleaved.
+  bool waitForInit(uint32_t timeout_ms = 500) {
+    if (!initialized) {
+      LOG_WARN(LED, "⚠️ Device not initialized yet, initializing now...\n");
+      initializeDevice();
+      uint32_t start = millis();
+      while (init_running && millis() - start < timeout_ms) {
+        paceDelay(1);
+      }
+      if (!initialized) {
+        LOG_ERROR(LED, "❌ Device initialization did not finish, LED command dropped\n");
+        return false;
+      }
+    }
+    while (ledPacer.busy()) {
+      serviceLedFrames();
+      if (ledPacer.busy()) paceDelay(1);
+    }
     return true;
   }
   
+  // Replace the usage -> button mapping at runtime; rejected unless it is a full bijection
+  bool loadKeymap(const KeymapTable& table) {
+    bool ok = keymap.load(table);
+    LOG_INFO(INIT, "%s Keymap override %s\n", ok ? "✅" : "❌", ok ? "loaded" : "rejected (invalid table)");
+    return ok;
+  }
+  
+  // Light the LED of a freshly pressed key (runs from the event dispatcher in loop()).
+  // press_id/press_us come from kbd_poll and feed the press-to-light tracker.
+  void handleKeyPress(uint8_t usage, uint16_t press_id = LATENCY_NO_ID, uint32_t press_us = 0) {
+    uint8_t buttonNumber = keymap.button(usage);
+    if (buttonNumber == KEYMAP_NO_BUTTON) {
+      LOG_DEBUG(LED, "🔍 Unmapped key: 0x%02X - ignored\n", usage);
+      return;
+    }
+    
+    const uint8_t* rgb = DEMO_BUTTON_COLORS[buttonNumber - 1];
+    LOG_DEBUG(LED, "🎯 Mapping HID 0x%02X to Button %d with RGB(%d,%d,%d)\n", usage, buttonNumber, rgb[0], rgb[1], rgb[2]);
+    sendSimpleLEDTest(buttonNumber, rgb[0], rgb[1], rgb[2], press_id, press_us);
+  }
+  
   void kbd_poll(int result) {
+    uint32_t now_us = micros();  // Stamp before any logging skews it
     static int kbd_counter = 0;
+    noteCompletion(driverStats.kbd_in, result);
     
     if (result > 0 && queue) {
       kbd_counter++;
+      bootTrace.markOnce(BOOT_FIRST_KBD_POLL, 0, now_us);
       
       // Debug: Show what's actually in the keyboard packet
       if (kbd_counter % 50 == 1) {  // Only print occasionally to avoid spam
-        Serial.printf("⌨️ Keyboard poll #%d (8 bytes): ", kbd_counter);
-        for (int i = 0; i < 8; i++) {
-          Serial.printf("0x%02X ", kbd_report[i]);
-        }
-        Serial.println();
+        LOG_TRACE(KBD, "⌨️ Keyboard poll #%d (8 bytes): ", kbd_counter);
+        LOG_HEX(KBD, LOG_LEVEL_TRACE, "", kbd_report, 8);
       }
       
-      // Check if there's actually a key press (non-zero data)
-      bool hasKeyPress = false;
-      for (int i = 0; i < 8; i++) {
-        if (kbd_report[i] != 0) {
-          hasKeyPress = true;
-          break;
-        }
-      }
+      // Diff against the previous report: one event per changed key
+      HidKeyEvent keyEvents[HID_MAX_KEY_EVENTS];
+      uint8_t numEvents = kbd_decoder.decode(kbd_report, (uint8_t)min(result, 8), now_us, keyEvents);
+      trace(TRACE_KBD_POLL, numEvents, result);
       
-      if (hasKeyPress) {
-        controlpad_event event;
-        if (result > 8) result = 8;
-        memcpy(&event.data, kbd_report, result);
-        event.len = (uint8_t)result;
-        atomQueuePut(queue, 0, &event);  // Non-blocking
-        
-        Serial.printf("📤 QUEUE PUT: Added keyboard event (len=%d) to queue\n", event.len);
-        Serial.printf("🎯 ACTUAL KEY PRESS detected! Packet: ");
-        for (int i = 0; i < 8; i++) {
-          Serial.printf("0x%02X ", kbd_report[i]);
+      if (numEvents > 0) {
+        for (uint8_t i = 0; i < numEvents; i++) {
+          // Presses get a correlation ID that follows them to the LED commit
+          uint16_t press_id = LATENCY_NO_ID;
+          if (keyEvents[i].pressed) {
+            if (++press_seq == LATENCY_NO_ID) press_seq = 1;
+            press_id = press_seq;
+          }
+          controlpad_event event = {EVENT_KEY, keymap.button(keyEvents[i].usage),
+                                    (uint8_t)(keyEvents[i].pressed ? EVENT_EDGE_PRESS : EVENT_EDGE_RELEASE),
+                                    keyEvents[i].usage, press_id, keyEvents[i].timestamp_us};
+          queue->push(event);  // Drops and counts when full
         }
-        Serial.println();
         
-        // Process button mapping immediately in kbd_poll (most reliable)
-        if (controlPadDriver) {
-          Serial.printf("🔥 KEY PRESSED: 0x%02X - Processing in kbd_poll\n", kbd_report[2]);
-          
-          // Map HID codes to button numbers based on breakdown file
-          uint8_t buttonNumber = 0;
-          uint8_t r = 255, g = 0, b = 0; // Default red
-          
-          switch(kbd_report[2]) {
-            // Row 1: Buttons 1-5
-            case 0x1E: buttonNumber = 1; r = 255; g = 0; b = 0; break;     // Button 1: Red
-            case 0x1F: buttonNumber = 2; r = 0; g = 255; b = 0; break;     // Button 2: Green  
-            case 0x20: buttonNumber = 3; r = 0; g = 0; b = 255; break;     // Button 3: Blue
-            case 0x21: buttonNumber = 4; r = 255; g = 255; b = 0; break;   // Button 4: Yellow
-            case 0x22: buttonNumber = 5; r = 255; g = 125; b = 255; break; // Button 5: Magenta
-            
-            // Row 2: Buttons 6-10 (based on breakdown mapping)
-            case 0x23: buttonNumber = 6; r = 0; g = 255; b = 255; break;   // Button 6: Cyan
-            case 0x24: buttonNumber = 7; r = 255; g = 128; b = 0; break;   // Button 7: Orange
-            case 0x25: buttonNumber = 8; r = 128; g = 0; b = 255; break;   // Button 8: Purple
-            case 0x26: buttonNumber = 9; r = 255; g = 255; b = 255; break; // Button 9: White
-            case 0x27: buttonNumber = 10; r = 255; g = 128; b = 128; break; // Button 10: Light Red
-            
-            // Row 3: Buttons 11-15
-            case 0x04: buttonNumber = 11; r = 255; g = 64; b = 64; break;   // Button 11: Light Red
-            case 0x05: buttonNumber = 12; r = 64; g = 255; b = 64; break;   // Button 12: Light Green
-            case 0x06: buttonNumber = 13; r = 64; g = 64; b = 255; break;   // Button 13: Light Blue
-            case 0x07: buttonNumber = 14; r = 192; g = 192; b = 0; break;   // Button 14: Dark Yellow
-            case 0x08: buttonNumber = 15; r = 192; g = 0; b = 192; break;   // Button 15: Dark Magenta
-            
-            // Row 4: Buttons 16-20
-            case 0x09: buttonNumber = 16; r = 0; g = 192; b = 192; break;   // Button 16: Dark Cyan
-            case 0x0A: buttonNumber = 17; r = 255; g = 192; b = 128; break; // Button 17: Peach
-            case 0x0B: buttonNumber = 18; r = 128; g = 255; b = 192; break; // Button 18: Mint (split RGB!)
-            case 0x0C: buttonNumber = 19; r = 192; g = 128; b = 255; break; // Button 19: Lavender
-            case 0x0D: buttonNumber = 20; r = 255; g = 255; b = 128; break; // Button 20: Light Yellow
-            
-            // Row 5: Buttons 21-24 (button 24 is 2-wide)
-            case 0x00: buttonNumber = 21; r = 128; g = 255; b = 255; break; // Button 21: Light Cyan
-            case 0x0F: buttonNumber = 22; r = 255; g = 128; b = 255; break; // Button 22: Light Magenta
-            case 0x10: buttonNumber = 23; r = 255; g = 255; b = 192; break; // Button 23: Cream
-            case 0x11: buttonNumber = 24; r = 64; g = 128; b = 192; break;  // Button 24: Steel Blue
-            
-            default:
-              Serial.printf("🔍 Unknown key: 0x%02X - using button 1 with white\n", kbd_report[2]);
-              buttonNumber = 1; r = 255; g = 255; b = 255;
-              break;
-          }
-          
-          if (buttonNumber > 0) {
-            Serial.printf("🎯 Mapping HID 0x%02X to Button %d with RGB(%d,%d,%d)\n", kbd_report[2], buttonNumber, r, g, b);
-            controlPadDriver->sendSimpleLEDTest(buttonNumber, r, g, b);
-          }
+        LOG_DEBUG(KBD, "📤 QUEUE PUT: Added %d keyboard event(s) to queue\n", numEvents);
+        
+        for (uint8_t i = 0; i < numEvents; i++) {
+          LOG_DEBUG(KBD, "🎯 KEY %s: 0x%02X @%luus\n", keyEvents[i].pressed ? "PRESS" : "RELEASE",
+                        keyEvents[i].usage, (unsigned long)keyEvents[i].timestamp_us);
         }
       }
       
       // Restart keyboard polling
-      int restart = InterruptMessage(kbd_ep_in, 8, kbd_report, &kbd_poll_cb);
+      int restart = submitTransfer(kbd_ep_in, 8, kbd_report, &kbd_poll_cb);
       if (restart != 0) {
-        Serial.printf("⚠️ Failed to restart keyboard polling: %d\n", restart);
+        LOG_WARN(KBD, "⚠️ Failed to restart keyboard polling: %d\n", restart);
         kbd_polling = false;
       }
     } else if (result < 0) {
-      Serial.printf("⚠️ Keyboard poll failed: %d\n", result);
+      LOG_WARN(KBD, "⚠️ Keyboard poll failed: %d\n", result);
       kbd_polling = false;
       // Retry after delay in main loop
     }
   }
   
   void ctrl_poll(int result) {
+    uint32_t now_us = micros();
     static int ctrl_counter = 0;
+    noteCompletion(driverStats.ctrl_in, result);
     
     if (result > 0 && queue) {
       ctrl_counter++;
       
-      // Only show control poll results occasionally and when there's actual data
-      bool hasControlData = false;
-      for (int i = 0; i < min(result, 64); i++) {
-        if (ctrl_report[i] != 0) {
-          hasControlData = true;
-          break;
-        }
+      // The device echoes every command on EP 0x83; the first commit echoed
+      // after init means the first frame is on the LEDs
+      if (result > 64) result = 64;
+      if (initialized && result >= 2 && ctrl_report[0] == 0x41 && ctrl_report[1] == 0x80) {
+        bootTrace.markOnce(BOOT_FIRST_FRAME, 0, now_us);
+      }
+      
+      CtrlReport report = ctrl_decoder.decode(ctrl_report, (uint8_t)result);
+      if (report.kind != CTRL_REPORT_EMPTY) {
+        trace(TRACE_CTRL_POLL, report.kind, ctrl_report[0] | (ctrl_report[1] << 8) | (ctrl_report[2] << 16) | ((uint32_t)ctrl_report[3] << 24));
       }
       
-      if (hasControlData) {
+      if (report.kind != CTRL_REPORT_EMPTY) {
         controlpad_event event;
-        if (result > 64) result = 64;
-        memcpy(&event.data, ctrl_report, result);
-        event.len = (uint8_t)result;
-        atomQueuePut(queue, 0, &event);  // Non-blocking
+        if (report.kind == CTRL_REPORT_KEY) {
+          event = {EVENT_CTRL_KEY, KEYMAP_NO_BUTTON,
+                   (uint8_t)(report.down ? EVENT_EDGE_PRESS : EVENT_EDGE_RELEASE),
+                   report.key, REPORT_SLAB_NONE, now_us};
+        } else {
+          event = {EVENT_CTRL_REPORT, KEYMAP_NO_BUTTON, EVENT_EDGE_RELEASE, (uint8_t)result,
+                   controlReportSlab.put(ctrl_report, (uint8_t)result), now_us};
+        }
+        queue->push(event);  // Drops and counts when full
         
-        Serial.printf("🎮 CONTROL Event #%d: ", ctrl_counter);
-        for (int i = 0; i < min(8, result); i++) {
-          Serial.printf("0x%02X ", ctrl_report[i]);
+        if (report.kind == CTRL_REPORT_KEY) {
+          LOG_DEBUG(CTRL, "🎮 CONTROL key 0x%02X %s @ %lu us (keys 0x%08lX, changed 0x%08lX)\n",
+                        report.key, report.down ? "DOWN" : "UP", (unsigned long)now_us,
+                        (unsigned long)report.pressed, (unsigned long)report.changed);
+        } else if (report.kind == CTRL_REPORT_ECHO) {
+          LOG_DEBUG(CTRL, "🎮 CONTROL echo %02X %02X [%u] #%d\n", report.cmd, report.sub, report.index, ctrl_counter);
+        } else if (report.kind == CTRL_REPORT_NOTIFY) {
+          LOG_DEBUG(CTRL, "🎮 CONTROL notify %02X %02X\n", report.cmd, report.sub);
+        } else {
+          LOG_DEBUG(CTRL, "🎮 CONTROL Event #%d: ", ctrl_counter);
+          LOG_HEX(CTRL, LOG_LEVEL_DEBUG, "", ctrl_report, min(8, result));
         }
-        Serial.println();
       } else if (ctrl_counter % 100 == 1) {
         // Occasional heartbeat to show control polling is working
-        Serial.printf("🎮 Control poll #%d (empty data)\n", ctrl_counter);
+        LOG_DEBUG(CTRL, "🎮 Control poll #%d (empty data)\n", ctrl_counter);
       }
       
       // Restart control polling
-      int restart = InterruptMessage(ctrl_ep_in, 64, ctrl_report, &ctrl_poll_cb);
+      int restart = submitTransfer(ctrl_ep_in, 64, ctrl_report, &ctrl_poll_cb);
       if (restart != 0) {
-        Serial.printf("⚠️ Failed to restart control polling: %d\n", restart);
+        LOG_WARN(CTRL, "⚠️ Failed to restart control polling: %d\n", restart);
         ctrl_polling = false;
       }
     } else if (result < 0) {
-      Serial.printf("⚠️ Control poll failed: %d\n", result);
+      LOG_WARN(CTRL, "⚠️ Control poll failed: %d\n", result);
       ctrl_polling = false;
       // Retry after delay in main loop
     }
   }
   
+  // Completion of an LED commit that carries a press correlation ID
+  void committed(int result) {
+    uint32_t now_us = micros();  // Before sent() logs anything
+    sent(result);
+    pressLatency.complete(commit_id, now_us, result >= 0);
+    trace(TRACE_COMMIT, commit_id, result);
+  }
+  
   void sent(int result) {
     static int commandCounter = 0;
     commandCounter++;
+    trace(TRACE_SENT, commandCounter, result);
+    noteCompletion(driverStats.ctrl_out, result);
     
     if (result >= 0) {
       // Only show every 10th success to reduce spam, but always show first few
       if (commandCounter <= 5 || commandCounter % 10 == 0) {
-        Serial.printf("📤 Command #%d sent successfully (result: %d)\n", commandCounter, result);
+        LOG_DEBUG(USB, "📤 Command #%d sent successfully (result: %d)\n", commandCounter, result);
       }
     } else {
       // Always show failures with detailed error codes
-      Serial.printf("❌ Command #%d FAILED: %d", commandCounter, result);
-      
-      // Provide more context for common USB error codes
-      switch (result) {
-        case -1: Serial.println(" (USB_ERROR_TIMEOUT)"); break;
-        case -2: Serial.println(" (USB_ERROR_STALL)"); break;
-        case -3: Serial.println(" (USB_ERROR_NAK)"); break;
-        case -4: Serial.println(" (USB_ERROR_DATA_TOGGLE)"); break;
-        case -5: Serial.println(" (USB_ERROR_BABBLE)"); break;
-        case -6: Serial.println(" (USB_ERROR_BUFFER_OVERRUN)"); break;
-        case -7: Serial.println(" (USB_ERROR_BUFFER_UNDERRUN)"); break;
-        case -8: Serial.println(" (USB_ERROR_NOT_ACCESSED)"); break;
-        case -9: Serial.println(" (USB_ERROR_FIFO)"); break;
-        case -10: Serial.println(" (USB_ERROR_UNKNOWN)"); break;
-        default: Serial.println(" (Unknown error code)"); break;
-      }
+      LOG_ERROR(USB, "❌ Command #%d FAILED: %d (%s)\n", commandCounter, result, usbErrorName(result));
       
       // Suggest possible solutions
       if (result == -1) {
-        Serial.println("💡 Timeout suggests device may not be ready for LED commands");
+        LOG_ERROR(USB, "💡 Timeout suggests device may not be ready for LED commands\n");
       } else if (result == -2) {
-        Serial.println("💡 Stall suggests endpoint or command not supported");
+        LOG_ERROR(USB, "💡 Stall suggests endpoint or command not supported\n");
       } else if (result == -3) {
-        Serial.println("💡 NAK suggests device is busy, try slowing down commands");
+        LOG_ERROR(USB, "💡 NAK suggests device is busy, try slowing down commands\n");
       }
     }
   }
   
   void startDualPolling() {
-    Serial.println("🔄 Starting DUAL INTERFACE polling...");
+    LOG_INFO(USB, "🔄 Starting DUAL INTERFACE polling...\n");
     
     // Start polling Interface 0 (Keyboard - 8 byte packets)
-    Serial.printf("📡 Starting keyboard polling on EP 0x%02X...\n", kbd_ep_in);
-    int kbd_result = InterruptMessage(kbd_ep_in, 8, kbd_report, &kbd_poll_cb);
+    LOG_INFO(USB, "📡 Starting keyboard polling on EP 0x%02X...\n", kbd_ep_in);
+    int kbd_result = submitTransfer(kbd_ep_in, 8, kbd_report, &kbd_poll_cb);
     if (kbd_result == 0) {
       kbd_polling = true;
-      Serial.println("✅ Keyboard polling started successfully");
+      LOG_INFO(USB, "✅ Keyboard polling started successfully\n");
     } else {
-      Serial.printf("❌ Failed to start keyboard polling: %d\n", kbd_result);
+      LOG_ERROR(USB, "❌ Failed to start keyboard polling: %d\n", kbd_result);
     }
     
     // Start polling Interface 1 (Control - 64 byte packets) 
-    Serial.printf("📡 Starting control polling on EP 0x%02X...\n", ctrl_ep_in);
-    int ctrl_result = InterruptMessage(ctrl_ep_in, 64, ctrl_report, &ctrl_poll_cb);
+    LOG_INFO(USB, "📡 Starting control polling on EP 0x%02X...\n", ctrl_ep_in);
+    int ctrl_result = submitTransfer(ctrl_ep_in, 64, ctrl_report, &ctrl_poll_cb);
     if (ctrl_result == 0) {
       ctrl_polling = true;
-      Serial.println("✅ Control polling started successfully");
+      LOG_INFO(USB, "✅ Control polling started successfully\n");
     } else {
-      Serial.printf("❌ Failed to start control polling: %d\n", ctrl_result);
+      LOG_ERROR(USB, "❌ Failed to start control polling: %d\n", ctrl_result);
     }
   }
   
   void restartKeyboardPolling() {
     if (!kbd_polling) {
-      int result = InterruptMessage(kbd_ep_in, 8, kbd_report, &kbd_poll_cb);
+      int result = submitTransfer(kbd_ep_in, 8, kbd_report, &kbd_poll_cb);
       if (result == 0) {
         kbd_polling = true;
-        Serial.println("✅ Keyboard polling restarted");
+        driverStats.kbd_restarts.inc();
+        LOG_INFO(USB, "✅ Keyboard polling restarted\n");
       } else {
-        Serial.printf("❌ Failed to restart keyboard polling: %d\n", result);
+        LOG_ERROR(USB, "❌ Failed to restart keyboard polling: %d\n", result);
       }
     }
   }
   
   void restartControlPolling() {
     if (!ctrl_polling) {
-      int result = InterruptMessage(ctrl_ep_in, 64, ctrl_report, &ctrl_poll_cb);
+      int result = submitTransfer(ctrl_ep_in, 64, ctrl_report, &ctrl_poll_cb);
       if (result == 0) {
         ctrl_polling = true;
-        Serial.println("✅ Control polling restarted");
+        driverStats.ctrl_restarts.inc();
+        LOG_INFO(USB, "✅ Control polling restarted\n");
       } else {
-        Serial.printf("❌ Failed to restart control polling: %d\n", result);
+        LOG_ERROR(USB, "❌ Failed to restart control polling: %d\n", result);
       }
     }
   }
 
   bool sendRealLEDCommand(uint8_t buttonIndex, uint8_t r, uint8_t g, uint8_t b, uint8_t w = 0) {
-    Serial.printf("🎯 REAL LED COMMAND: Button %d -> RGB(%d,%d,%d)\n", buttonIndex, r, g, b);
+    LOG_DEBUG(LED, "🎯 REAL LED COMMAND: Button %d -> RGB(%d,%d,%d)\n", buttonIndex, r, g, b);
 
-    if (buttonIndex < 1 || buttonIndex > 25) {
-      Serial.printf("❌ Invalid button index: %d\n", buttonIndex);
+    if (buttonIndex < 1 || buttonIndex > LED_COUNT) {
+      LOG_ERROR(LED, "❌ Invalid button index: %d\n", buttonIndex);
       return false;
     }
 
-    // Column-based mapping: button1, button6, button11, button16, button21, button2, button7, etc.
-    // 5x5 grid arranged by columns: [1,6,11,16,21], [2,7,12,17,22], [3,8,13,18,23], [4,9,14,19,24], [5,10,15,20,25]
-    uint8_t idx = buttonIndex - 1;  // 0-based index
-    uint8_t row = idx % 5;          // Row within column (0-4)
-    uint8_t col = idx / 5;          // Column number (0-4) 
-    uint8_t pos = row * 5 + col;    // Column-major position
-    
-    Serial.printf("🗺️ Button %d -> row=%d, col=%d, pos=%d\n", buttonIndex, row, col, pos);
+    LOG_DEBUG(LED, "🗺️ Button %d -> slot %d\n", buttonIndex, ledSlot(buttonIndex));
+    if (!waitForInit()) return false;
 
     // Switch to custom mode if not already done
     switchToCustomMode();
-    delay(20);
-    
-    // Update full LED state buffers at the mapped position (RGB, no white)
-    if (pos < 13) {
-      size_t off = 12 + pos * 3;
-      statePacket1[off]     = r;
-      statePacket1[off + 1] = g;
-      statePacket1[off + 2] = b;
-      Serial.printf("📦 Packet1[%d:%d] = RGB(%d,%d,%d)\n", off, off+2, r, g, b);
-    } else {
-      size_t off = 4 + (pos - 13) * 3;
-      statePacket2[off]     = r;
-      statePacket2[off + 1] = g;
-      statePacket2[off + 2] = b;
-      Serial.printf("📦 Packet2[%d:%d] = RGB(%d,%d,%d)\n", off, off+2, r, g, b);
+    paceDelay(20);
+    
+    // Update the full LED state (RGB, no white) and re-encode both packets
+    {
+      CpuScope encode(CPU_ENCODE);
+      ledState.set(buttonIndex, r, g, b);
+      encodeStatePackets();
     }
     // Send full-state packets to apply LED changes
-    Serial.println("📤 Sending LED state packets...");
+    LOG_DEBUG(LED, "📤 Sending LED state packets...\n");
     sendControlData(statePacket1, 64);
-    delay(10);
+    paceDelay(10);
     sendControlData(statePacket2, 64);
-    delay(10);
+    paceDelay(10);
     
     // CRITICAL: Send commit command to apply changes  
     sendCommitCommand();
@@ -1587,23 +1819,25 @@ public:
 
   // Switch to static mode
   bool switchToStaticMode() {
-    Serial.println("🔧 SWITCHING TO STATIC MODE...");
-    // Payload from capture: frame15353 static (offset8=0x02, then background pattern)
+    LOG_DEBUG(LED, "🔧 SWITCHING TO STATIC MODE...\n");
+    if (!waitForInit()) return false;
+    // Payload from "5681 modes static custom.txt": offset 8 = 0x01 (0x02 is custom), then background pattern
     static const uint8_t modeStatic[64] = {
       0x56, 0x81, 0x00, 0x00,
       0x01, 0x00, 0x00, 0x00,
-      0x02, 0x00, 0x00, 0x00,
+      0x01, 0x00, 0x00, 0x00,
       0x55, 0x55, 0x55, 0x55
     };
-    Serial.println("📤 Sending STATIC MODE via interrupt...");
+    LOG_DEBUG(LED, "📤 Sending STATIC MODE via interrupt...\n");
     sendControlData((uint8_t*)modeStatic, 64);
-    delay(50);
+    paceDelay(50);
     return true;
   }
 
   // Switch to custom mode
   bool switchToCustomMode() {
-    Serial.println("🔧 SWITCHING TO CUSTOM MODE...");
+    LOG_DEBUG(LED, "🔧 SWITCHING TO CUSTOM MODE...\n");
+    if (!waitForInit()) return false;
     // Exact payload from working capture: 568100000100000002000000bbbbbbbb...
     static const uint8_t modeCustom[64] = {
       0x56, 0x81, 0x00, 0x00,
@@ -1617,53 +1851,40 @@ public:
       0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
       0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
     };
-    Serial.println("📤 Sending CUSTOM MODE via interrupt...");
+    LOG_DEBUG(LED, "📤 Sending CUSTOM MODE via interrupt...\n");
     sendControlData((uint8_t*)modeCustom, 64);
-    delay(50);
+    paceDelay(50);
     return true;
   }
 
   // Add demo helper to set all LEDs at once
   void setAllLEDs(uint8_t r, uint8_t g, uint8_t b) {
-    Serial.printf("☑️ Setting ALL LEDs to RGB(%d,%d,%d)\n", r, g, b);
-    if (!initialized) initializeDevice();
+    LOG_DEBUG(LED, "☑️ Setting ALL LEDs to RGB(%d,%d,%d)\n", r, g, b);
+    if (!waitForInit()) return;
     
     // Ensure we're in custom mode
     switchToCustomMode();
-    delay(20);
-    
-    // Update full state buffers for all 25 buttons using corrected column-based mapping
-    for (uint8_t button = 1; button <= 25; button++) {
-      uint8_t idx = button - 1;       // 0-based index
-      uint8_t row = idx % 5;          // Row within column (0-4)
-      uint8_t col = idx / 5;          // Column number (0-4) 
-      uint8_t pos = row * 5 + col;    // Column-major position
-      
-      if (pos < 13) {
-        size_t off = 12 + pos * 3;
-        statePacket1[off]     = r;
-        statePacket1[off + 1] = g;
-        statePacket1[off + 2] = b;
-      } else {
-        size_t off = 4 + (pos - 13) * 3;
-        statePacket2[off]     = r;
-        statePacket2[off + 1] = g;
-        statePacket2[off + 2] = b;
-      }
+    paceDelay(20);
+    
+    // Same colour on every button
+    {
+      CpuScope encode(CPU_ENCODE);
+      renderSolid(ledState, 0, r, g, b);
+      encodeStatePackets();
     }
     
     // Send updated full-state packets
-    Serial.println("📤 Sending ALL LED state packets...");
-    Serial.print("📦 Packet1 header: ");
+    LOG_DEBUG(LED, "📤 Sending ALL LED state packets...\n");
+    LOG_DEBUG(LED, "📦 Packet1 header: ");
     for (int i = 0; i < 12; i++) {
-      Serial.printf("%02X ", statePacket1[i]);
+      LOG_DEBUG(LED, "%02X ", statePacket1[i]);
     }
-    Serial.println();
+    LOG_DEBUG(LED, "\n");
     
     sendControlData(statePacket1, 64);
-    delay(20);
+    paceDelay(20);
     sendControlData(statePacket2, 64);
-    delay(20);
+    paceDelay(20);
     
     // CRITICAL: Send commit command to apply LED changes
     sendCommitCommand();
@@ -1671,30 +1892,26 @@ public:
 
   // Test function to set specific button to red (matching working capture)
   bool testButton1Red() {
-    Serial.println("🧪 TESTING: Setting Button 1 to RED (matching working capture)");
-    
-    if (!initialized) initializeDevice();
+    LOG_DEBUG(LED, "🧪 TESTING: Setting Button 1 to RED (matching working capture)\n");
     
-    // Clear all LEDs first
-    memset(statePacket1 + 12, 0, 52);  // Clear RGB data in packet1 
-    memset(statePacket2 + 4, 0, 60);   // Clear RGB data in packet2
+    if (!waitForInit()) return false;
     
-    // Set button 1 to red - should be position 0 (bytes 12-14 in packet1)
-    statePacket1[12] = 0xFF;  // Red
-    statePacket1[13] = 0x00;  // Green
-    statePacket1[14] = 0x00;  // Blue
+    // Clear all LEDs, then button 1 red - slot 0 (bytes 24-26 in packet1)
+    ledState.clear();
+    ledState.set(1, 0xFF, 0x00, 0x00);
+    encodeStatePackets();
     
-    Serial.println("📤 Sending test LED command...");
-    Serial.print("📦 Packet1 first 20 bytes: ");
+    LOG_DEBUG(LED, "📤 Sending test LED command...\n");
+    LOG_DEBUG(LED, "📦 Packet1 first 20 bytes: ");
     for (int i = 0; i < 20; i++) {
-      Serial.printf("%02X ", statePacket1[i]);
+      LOG_DEBUG(LED, "%02X ", statePacket1[i]);
     }
-    Serial.println();
+    LOG_DEBUG(LED, "\n");
     
     sendControlData(statePacket1, 64);
-    delay(20);
+    paceDelay(20);
     sendControlData(statePacket2, 64);
-    delay(20);
+    paceDelay(20);
     
     // CRITICAL: Send commit command to apply changes
     sendCommitCommand();
@@ -1704,22 +1921,20 @@ public:
 
   // Send commit command to apply LED changes (0x41 0x80 from working capture)
   bool sendCommitCommand() {
-    uint8_t commitCmd[64] = {0};
-    commitCmd[0] = 0x41;
-    commitCmd[1] = 0x80;
-    // Rest stays zero
+    uint8_t commitCmd[64];
+    encodeLedCommit(commitCmd);
     
-    Serial.println("💾 Sending COMMIT command to apply LED changes...");
+    LOG_DEBUG(LED, "💾 Sending COMMIT command to apply LED changes...\n");
     sendControlData(commitCmd, 64);
-    delay(10);
+    paceDelay(10);
     return true;
   }
 
   // Test function to replicate exact working pattern from capture
   bool testExactWorkingPattern() {
-    Serial.println("🔥 TESTING: Exact working pattern from USB capture");
+    LOG_DEBUG(LED, "🔥 TESTING: Exact working pattern from USB capture\n");
     
-    if (!initialized) initializeDevice();
+    if (!waitForInit()) return false;
     
     // Clear packets first
     memset(statePacket1 + 12, 0, 52);
@@ -1762,21 +1977,24 @@ public:
       0x00, 0x00, 0x00   // Black
     };
     
-    // Copy exact working patterns  
+    // Copy exact working patterns (raw bytes, header included), then pick the
+    // colours back up so later single-button updates start from this state
     memcpy(statePacket1 + 12, workingData1, sizeof(workingData1));
     memcpy(statePacket2 + 4, workingData2, sizeof(workingData2));
+    decodeLedData(statePacket1, 64, ledState);
+    decodeLedData(statePacket2, 64, ledState);
     
-    Serial.println("📤 Sending EXACT working LED pattern...");
-    Serial.print("📦 Packet1 data: ");
+    LOG_DEBUG(LED, "📤 Sending EXACT working LED pattern...\n");
+    LOG_DEBUG(LED, "📦 Packet1 data: ");
     for (int i = 12; i < 30; i++) {
-      Serial.printf("%02X ", statePacket1[i]);
+      LOG_DEBUG(LED, "%02X ", statePacket1[i]);
     }
-    Serial.println();
+    LOG_DEBUG(LED, "\n");
     
     sendControlData(statePacket1, 64);
-    delay(20);
+    paceDelay(20);
     sendControlData(statePacket2, 64);
-    delay(20);
+    paceDelay(20);
     sendCommitCommand();
     
     return true;
@@ -1787,12 +2005,584 @@ public:
 bool USBControlPad::factory_registered = false;
 bool USBControlPad::driver_instance_created = false;
 
+// ===== BOOT TIMELINE =====
+
+// One line per boot: offsets of every milestone relative to setup() entry
+void printBootTimeline(const BootRecord& rec) {
+  uint32_t start = rec.startUs();
+  Serial.printf("⏱️ Boot [%08lX]:", (unsigned long)rec.build_id);
+  for (uint8_t i = 0; i < rec.count; i++) {
+    const BootMark& m = rec.marks[i];
+    Serial.printf(" %s", BootTrace::name(m.milestone));
+    if (m.milestone == BOOT_OFFER_INTERFACE || m.milestone == BOOT_ATTACH_INTERFACE) {
+      Serial.printf("%d", m.arg);
+    } else if (m.milestone == BOOT_INIT_COMMAND) {
+      Serial.printf("%02X", m.arg);
+    }
+    Serial.printf("@%lu", (unsigned long)(m.us - start));
+  }
+  Serial.printf(" | total %luus", (unsigned long)(rec.endUs() - start));
+  if (rec.dropped) Serial.printf(" (%d marks dropped)", rec.dropped);
+  Serial.println();
+}
+
+// Previous boots kept in RAM, oldest first
+void printBootHistory() {
+  Serial.printf("📜 Previous %d boots:\n", bootTrace.storedBoots() - 1);
+  for (int ago = bootTrace.storedBoots() - 1; ago >= 1; ago--) {
+    const BootRecord* rec = bootTrace.previous(ago);
+    if (rec && rec->count) printBootTimeline(*rec);
+  }
+}
+
+// Ends the boot timeline at the first committed frame, or after a timeout
+void serviceBootTrace() {
+  if (bootTrace.closed()) return;
+  
+  const BootMark* setupMark = bootTrace.current().find(BOOT_SETUP);
+  bool timedOut = setupMark && (micros() - setupMark->us) > BOOT_TRACE_TIMEOUT_MS * 1000UL;
+  if (!bootTrace.seen(BOOT_FIRST_FRAME) && !timedOut) return;
+  
+  bootTrace.close();
+  // DMAMEM is cached; write the record back so it survives a reset
+  arm_dcache_flush(&bootTrace, sizeof(bootTrace));
+  printBootTimeline(bootTrace.current());
+}
+
+// ===== EVENT HANDLERS =====
+// Subscribed in setup(); loop() drains the queue through the dispatcher.
+// LED feedback used to run inside kbd_poll, i.e. in the USB interrupt, where
+// setLEDs() could never see the init sequence finish. It now runs here.
+
+#ifndef CONTROLPAD_MIDI_CHANNEL
+#define CONTROLPAD_MIDI_CHANNEL   1
+#endif
+#ifndef CONTROLPAD_MIDI_BASE_NOTE
+#define CONTROLPAD_MIDI_BASE_NOTE 36   // Button 1 = C2, the usual drum-pad start
+#endif
+
+#if defined(USB_MIDI) || defined(USB_MIDI_SERIAL) || defined(USB_MIDI_AUDIO_SERIAL)
+#define CONTROLPAD_HAS_USB_MIDI 1
+#else
+#define CONTROLPAD_HAS_USB_MIDI 0
+#endif
+
+#define DISPATCH_MAPPED_BUTTONS (DISPATCH_ALL_BUTTONS & ~1u)  // Buttons 1-24, not "no button"
+
+// Max time one loop() pass spends on events. Handlers must not block to fit
+// in it: LED feedback queues its frame on the pacer and returns.
+static const uint32_t DISPATCH_BUDGET_US = 500;
+EventDispatcher dispatcher;
+
+GestureRecognizer gestures;     // Thresholds: GestureConfig defaults, change with gestures.setConfig()
+
+static inline uint32_t cycleCount() { return ARM_DWT_CYCCNT; }
+
+// Gestures go back through the event queue like any other event
+static inline void queueGesture(const controlpad_event& gesture) {
+  trace(TRACE_GESTURE, gesture.button, gesture.code);
+  controlpad_queue.push(gesture);
+}
+
+// Time for gestures.tick(): now, or the oldest event still queued if that is
+// earlier, so a release waiting behind the dispatch budget is not overtaken
+// by its own long-press deadline
+static inline uint32_t gestureNow() {
+  uint32_t now = micros();
+  controlpad_event oldest;
+  if (controlpad_queue.peek(oldest) && (int32_t)(oldest.timestamp_us - now) < 0) now = oldest.timestamp_us;
+  return now;
+}
+
+static inline uint32_t cyclesToNs(uint32_t cycles) {
+  return (uint32_t)((uint64_t)cycles * 1000 / (F_CPU_ACTUAL / 1000000));
+}
+
+// Arrival time is the callback timestamp; the gap to now is queueing/dispatch delay
+void delayStatsHandler(const controlpad_event& event, void*) {
+  eventDelayStats.add(micros() - event.timestamp_us);
+  if (eventDelayStats.count % 100 == 0) {
+    const DispatchStats& ds = dispatcher.statistics();
+    LOG_DEBUG(EVENT, "⏱️ Event delay over %lu events: min %luus, mean %luus, max %luus (queue high water %lu/%lu)\n",
+                  (unsigned long)eventDelayStats.count, (unsigned long)eventDelayStats.min_us,
+                  (unsigned long)eventDelayStats.mean_us(), (unsigned long)eventDelayStats.max_us,
+                  (unsigned long)controlpad_queue.highWater(), (unsigned long)ControlPadEventQueue::capacity());
+    LOG_DEBUG(EVENT, "⏱️ Dispatch cost: min %luns, mean %luns, max %luns per event; largest batch %lu, %lu budget stops\n",
+                  (unsigned long)cyclesToNs(ds.min_cycles), (unsigned long)cyclesToNs(ds.meanCycles()),
+                  (unsigned long)cyclesToNs(ds.max_cycles), (unsigned long)ds.max_batch,
+                  (unsigned long)ds.budget_stops);
+  }
+}
+
+void ledFeedbackHandler(const controlpad_event& event, void*) {
+  if (event.edge == EVENT_EDGE_PRESS && controlPadDriver) {
+    CpuScope render(CPU_RENDER);
+    traceBegin(TRACE_LED_FRAME, event.button, event.report);
+    controlPadDriver->handleKeyPress(event.code, event.report, event.timestamp_us);
+    traceEnd(TRACE_LED_FRAME, event.button, event.report);
+  }
+}
+
+void gestureHandler(const controlpad_event& event, void*) {
+  gestures.onKey(event.button, event.edge == EVENT_EDGE_PRESS, event.timestamp_us, queueGesture);
+}
+
+#if CONTROLPAD_HAS_USB_MIDI
+void midiHandler(const controlpad_event& event, void*) {
+  uint8_t note = CONTROLPAD_MIDI_BASE_NOTE + event.button - 1;
+  if (event.edge == EVENT_EDGE_PRESS) {
+    usbMIDI.sendNoteOn(note, 127, CONTROLPAD_MIDI_CHANNEL);
+  } else {
+    usbMIDI.sendNoteOff(note, 0, CONTROLPAD_MIDI_CHANNEL);
+  }
+}
+#endif
+
+void logHandler(const controlpad_event& event, void*) {
+  uint32_t delay_us = micros() - event.timestamp_us;
+  
+  if (event.type == EVENT_KEY) {
+    if (event.edge == EVENT_EDGE_PRESS) {
+      LOG_DEBUG(EVENT, "⌨️ KEYBOARD Key Press: 0x%02X (button %d) at %luus (+%luus in queue)\n",
+                    event.code, event.button, (unsigned long)event.timestamp_us, (unsigned long)delay_us);
+    }
+  } else if (event.type == EVENT_CTRL_KEY) {
+    LOG_DEBUG(EVENT, "🎮 CONTROL key 0x%02X %s at %luus (+%luus in queue)\n", event.code,
+                  event.edge == EVENT_EDGE_PRESS ? "DOWN" : "UP",
+                  (unsigned long)event.timestamp_us, (unsigned long)delay_us);
+  } else if (event.type == EVENT_GESTURE) {
+    if (event.code == GESTURE_HOLD_REPEAT) {
+      LOG_DEBUG(EVENT, "👆 Button %d %s #%u at %luus\n", event.button, GestureRecognizer::name(event.code),
+                    event.report, (unsigned long)event.timestamp_us);
+    } else {
+      LOG_DEBUG(EVENT, "👆 Button %d %s at %luus\n", event.button, GestureRecognizer::name(event.code),
+                    (unsigned long)event.timestamp_us);
+    }
+  } else if (event.type == EVENT_CTRL_REPORT) {
+    // Control event from Interface 1 - reduce spam
+    static int controlEventCounter = 0;
+    if (++controlEventCounter % 20 == 1) {  // Show every 20th event
+      uint8_t data[REPORT_SLAB_BYTES];
+      uint8_t len = 0;
+      if (controlReportSlab.get(event.report, data, &len)) {
+        LOG_DEBUG(EVENT, "🎮 CONTROL Event #%d: ", controlEventCounter);
+        for (int i = 0; i < min(8, (int)len); i++) {
+          LOG_DEBUG(EVENT, "0x%02X ", data[i]);
+        }
+        LOG_DEBUG(EVENT, "\n");
+      } else {
+        LOG_WARN(EVENT, "⚠️ CONTROL Event #%d: report slot already reused\n", controlEventCounter);
+      }
+    }
+  }
+}
+
+void registerEventHandlers() {
+  // Order matters: delay stats first so logging does not inflate them
+  dispatcher.subscribe(DISPATCH_ALL_TYPES, DISPATCH_ALL_BUTTONS, delayStatsHandler, nullptr, "delay");
+  dispatcher.subscribe(DISPATCH_TYPE(EVENT_KEY), DISPATCH_MAPPED_BUTTONS, ledFeedbackHandler, nullptr, "led");
+  dispatcher.subscribe(DISPATCH_TYPE(EVENT_KEY), DISPATCH_MAPPED_BUTTONS, gestureHandler, nullptr, "gesture");
+#if CONTROLPAD_HAS_USB_MIDI
+  dispatcher.subscribe(DISPATCH_TYPE(EVENT_KEY), DISPATCH_MAPPED_BUTTONS, midiHandler, nullptr, "midi");
+#endif
+  dispatcher.subscribe(DISPATCH_ALL_TYPES, DISPATCH_ALL_BUTTONS, logHandler, nullptr, "log");
+  
+  LOG_INFO(EVENT, "📋 Event handlers:");
+  for (uint8_t i = 0; i < dispatcher.handlerCount(); i++) {
+    LOG_INFO(EVENT, " %s", dispatcher.handler(i).name);
+  }
+  LOG_INFO(EVENT, "\n");
+}
+
+// ===== BENCHMARK MODE =====
+// The cases from controlpad_bench.h timed with the DWT cycle counter, once
+// with the code in ITCM (FASTRUN, where Teensy 4 runs code by default) and
+// once in flash behind the instruction cache (FLASHMEM). flatten inlines the
+// encoders and decoders into each case, so the whole hot path sits in the
+// chosen memory; library calls such as memset stay where the linker put them.
+// The table matches tools/bench, with cycles/op filled in.
+#if CONTROLPAD_BENCH_MODE
+#define BENCH_CODE __attribute__((flatten)) FASTRUN
+#include "controlpad_bench.h"
+
+namespace bench_flash {
+#undef BENCH_CODE
+#define BENCH_CODE __attribute__((flatten)) FLASHMEM
+#include "controlpad_bench_cases.inc"
+}
+
+static const uint32_t BENCH_MIN_ITERATIONS = 1000;
+static const uint8_t BENCH_REPETITIONS = 5;
+
+static uint32_t benchCycles(const BenchCase& c, uint32_t iterations) {
+  uint32_t start = ARM_DWT_CYCCNT;
+  c.run(iterations, c.arg);
+  return ARM_DWT_CYCCNT - start;
+}
+
+static void runBenchTable(const char* placement, const BenchCase* cases, uint8_t count) {
+  uint32_t mhz = F_CPU_ACTUAL / 1000000;
+  uint32_t target = F_CPU_ACTUAL / 20;  // ~50 ms per timed run, far from a counter wrap
+  char row[96];
+  Serial.printf("\n⏱️ Benchmarks, code in %s, %lu MHz, fastest of %u runs\n", placement, (unsigned long)mhz,
+                BENCH_REPETITIONS);
+  benchFormatHeader(row, sizeof(row));
+  Serial.println(row);
+
+  for (uint8_t i = 0; i < count; i++) {
+    const BenchCase& c = cases[i];
+    uint32_t n = BENCH_MIN_ITERATIONS;
+    uint32_t cycles = benchCycles(c, n);  // Also warms the caches for flash code
+    while (cycles < target && n < (1u << 24)) {
+      n *= 2;
+      cycles = benchCycles(c, n);
+    }
+    uint32_t best = UINT32_MAX;
+    for (uint8_t r = 0; r < BENCH_REPETITIONS; r++) {
+      uint32_t run = benchCycles(c, n);
+      if (run < best) best = run;
+    }
+    double perOp = (double)best / n;
+    uint32_t roundedCycles = (uint32_t)(perOp + 0.5);
+    benchFormatRow(row, sizeof(row), c.name, perOp * 1000.0 / mhz, roundedCycles ? roundedCycles : 1, n);
+    Serial.println(row);
+  }
+}
+
+void runBenchmarks() {
+  BenchCase cases[BENCH_MAX_CASES];
+  runBenchTable("ITCM", cases, benchCases(cases));
+  runBenchTable("flash", cases, bench_flash::benchCases(cases));
+  Serial.println("\n✅ Benchmarks done; send 'bench' to run them again");
+}
+#endif
+
+// ===== SERIAL COMMANDS =====
+// One command per line on the USB serial port:
+//   latency         press-to-light distribution and per-stage breakdown
+//   latency reset   start a fresh measurement
+//   callbacks       time spent in the USB completion callbacks
+//   stats           driver statistics block (human readable)
+//   stats raw       the same as one key=value line for scripts
+//   trace           dump unread trace records (decode with tools/trace_decode)
+//   trace on|off    stream trace records continuously
+
+static void printStage(const char* name, const LatencyStage& st) {
+  Serial.printf("   %-16s min %6luus  mean %6luus  max %6luus\n", name,
+                st.count ? (unsigned long)st.min_us : 0UL, (unsigned long)st.mean_us(), (unsigned long)st.max_us);
+}
+
+void printLatencyStats() {
+  const PressToLightTracker& t = pressLatency;
+  Serial.printf("⏱️ Press-to-light over %lu presses: min %luus, mean %luus, p50 %luus, p99 %luus, max %luus\n",
+                (unsigned long)t.press_to_light.count,
+                t.press_to_light.count ? (unsigned long)t.press_to_light.min_us : 0UL,
+                (unsigned long)t.press_to_light.mean_us(), (unsigned long)t.p50(), (unsigned long)t.p99(),
+                (unsigned long)t.press_to_light.max_us);
+  printStage("press->render", t.press_to_render);
+  printStage("render->submit", t.render_to_submit);
+  printStage("submit->done", t.submit_to_done);
+  Serial.printf("   last %luus, failed %lu, abandoned %lu, orphan completions %lu\n",
+                (unsigned long)t.last_us, (unsigned long)t.failed, (unsigned long)t.abandoned,
+                (unsigned long)t.orphans);
+}
+
+static void printCallbackCost(const char* name, const CallbackCost& c) {
+  Serial.printf("   %-10s %8lu calls  mean %6luns  max %7luns\n", name, (unsigned long)c.count,
+                (unsigned long)cyclesToNs(c.meanCycles()), (unsigned long)cyclesToNs(c.max_cycles));
+}
+
+void printCallbackCosts() {
+  Serial.printf("⏱️ USB callback cost (log level %d):\n", CONTROLPAD_LOG_LEVEL);
+  printCallbackCost("kbd_poll", kbdPollCost);
+  printCallbackCost("ctrl_poll", ctrlPollCost);
+  printCallbackCost("sent", sentCost);
+}
+
+// Last one-second window; busy excludes idle spinning and pacing delays
+static void printCpuStats() {
+#if CONTROLPAD_CPU_ACCOUNTING
+  if (cpuAccount.windowCount() == 0) {
+    Serial.println("   cpu        no full window yet");
+    return;
+  }
+  uint32_t busy = cpuAccount.busyPermille();
+  Serial.printf("   cpu        busy %lu.%lu%%, peak %lu.%lu%% over %lus at %luMHz\n", (unsigned long)(busy / 10),
+                (unsigned long)(busy % 10), (unsigned long)(cpuAccount.peakBusyPermille() / 10),
+                (unsigned long)(cpuAccount.peakBusyPermille() % 10), (unsigned long)cpuAccount.windowCount(),
+                (unsigned long)(F_CPU_ACTUAL / 1000000));
+  Serial.print("             ");
+  for (uint8_t c = 0; c < CPU_CATEGORY_COUNT; c++) {
+    uint32_t pm = cpuAccount.permille(c);
+    Serial.printf(" %s %lu.%lu%%", cpuCategoryName(c), (unsigned long)(pm / 10), (unsigned long)(pm % 10));
+  }
+  Serial.println();
+#endif
+}
+
+static void printEndpointStats(const char* name, const EndpointStats& es) {
+  Serial.printf("   %-10s submitted %8lu  rejected %4lu  completed %8lu  failed %4lu\n", name,
+                (unsigned long)es.submitted.get(), (unsigned long)es.rejected.get(),
+                (unsigned long)es.completed.get(), (unsigned long)es.failed.get());
+}
+
+void printDriverStats() {
+  const DriverStats& st = driverStats;
+  Serial.println("📊 Driver stats:");
+  printEndpointStats("kbd 0x81", st.kbd_in);
+  printEndpointStats("ctrl 0x83", st.ctrl_in);
+  printEndpointStats("out 0x04", st.ctrl_out);
+  
+  Serial.print("   errors    ");
+  bool anyError = false;
+  for (uint8_t i = 0; i <= USB_ERROR_CODES; i++) {
+    uint32_t n = st.errors[i].get();
+    if (n == 0) continue;
+    Serial.printf(" %s=%lu", i < USB_ERROR_CODES ? usbErrorName(-(int)i - 1) : "other", (unsigned long)n);
+    anyError = true;
+  }
+  Serial.println(anyError ? "" : " none");
+  
+  Serial.printf("   restarts   kbd %lu, ctrl %lu\n", (unsigned long)st.kbd_restarts.get(), (unsigned long)st.ctrl_restarts.get());
+  Serial.printf("   queue      high water %lu/%lu, dropped %lu\n", (unsigned long)controlpad_queue.highWater(),
+                (unsigned long)ControlPadEventQueue::capacity(), (unsigned long)controlpad_queue.droppedCount());
+  Serial.printf("   frames     rendered %lu, sent %lu, suppressed %lu, coalesced %lu\n",
+                (unsigned long)st.frames_rendered.get(), (unsigned long)st.frames_sent.get(),
+                (unsigned long)st.frames_suppressed.get(), (unsigned long)st.frames_coalesced.get());
+  Serial.printf("   interval   current %luus, max %luus\n", (unsigned long)st.frame_interval_us.get(),
+                (unsigned long)st.frame_interval_max_us.get());
+  printCpuStats();
+}
+
+// One line, space separated key=value pairs; keys never change meaning
+void printDriverStatsRaw() {
+  const DriverStats& st = driverStats;
+  const EndpointStats* eps[3] = {&st.kbd_in, &st.ctrl_in, &st.ctrl_out};
+  const char* names[3] = {"kbd", "ctrl", "out"};
+  Serial.print("STATS");
+  for (uint8_t i = 0; i < 3; i++) {
+    Serial.printf(" %s_sub=%lu %s_rej=%lu %s_ok=%lu %s_fail=%lu", names[i], (unsigned long)eps[i]->submitted.get(),
+                  names[i], (unsigned long)eps[i]->rejected.get(), names[i], (unsigned long)eps[i]->completed.get(),
+                  names[i], (unsigned long)eps[i]->failed.get());
+  }
+  for (uint8_t i = 0; i < USB_ERROR_CODES; i++) {
+    Serial.printf(" err%d=%lu", -(int)i - 1, (unsigned long)st.errors[i].get());
+  }
+  Serial.printf(" err_other=%lu", (unsigned long)st.errors[USB_ERROR_CODES].get());
+  Serial.printf(" kbd_restarts=%lu ctrl_restarts=%lu q_high=%lu q_cap=%lu q_drop=%lu",
+                (unsigned long)st.kbd_restarts.get(), (unsigned long)st.ctrl_restarts.get(),
+                (unsigned long)controlpad_queue.highWater(), (unsigned long)ControlPadEventQueue::capacity(),
+                (unsigned long)controlpad_queue.droppedCount());
+  Serial.printf(" frames_rendered=%lu frames_sent=%lu frames_suppressed=%lu frames_coalesced=%lu frame_us=%lu frame_max_us=%lu",
+                (unsigned long)st.frames_rendered.get(), (unsigned long)st.frames_sent.get(),
+                (unsigned long)st.frames_suppressed.get(), (unsigned long)st.frames_coalesced.get(),
+                (unsigned long)st.frame_interval_us.get(), (unsigned long)st.frame_interval_max_us.get());
+#if CONTROLPAD_CPU_ACCOUNTING
+  // Cycles in the last window per category, plus the window length
+  Serial.printf(" cpu_window=%lu cpu_busy_pm=%lu cpu_peak_pm=%lu", (unsigned long)cpuAccount.totalCycles(),
+                (unsigned long)cpuAccount.busyPermille(), (unsigned long)cpuAccount.peakBusyPermille());
+  for (uint8_t c = 0; c < CPU_CATEGORY_COUNT; c++) {
+    Serial.printf(" cpu_%s=%lu", cpuCategoryName(c), (unsigned long)cpuAccount.cycles(c));
+  }
+#endif
+  Serial.println();
+}
+
+// ===== TRACE OUTPUT =====
+static bool traceStreaming = false;
+static bool traceDumpPending = false;
+static const uint8_t TRACE_LINES_PER_PASS = 16;  // Keep loop() responsive while draining
+
+static void printTraceHeader() {
+  Serial.printf("TRACE BEGIN hz=%lu recorded=%lu lost=%lu\n", (unsigned long)F_CPU_ACTUAL,
+                (unsigned long)traceRing.recorded(), (unsigned long)traceRing.lost());
+}
+
+// Drains a bounded number of records per pass; "TRACE END" closes a dump
+void serviceTrace() {
+  if (!traceStreaming && !traceDumpPending) return;
+  CpuScope work(CPU_LOOP);
+  
+  TraceRecord r;
+  for (uint8_t i = 0; i < TRACE_LINES_PER_PASS; i++) {
+    if (!traceRing.pop(r)) {
+      if (traceDumpPending) {
+        Serial.println("TRACE END");
+        traceDumpPending = false;
+      }
+      return;
+    }
+    Serial.printf(TRACE_LINE_FORMAT, (unsigned long)r.cycles, r.id, r.phase,
+                  (unsigned long)r.a0, (unsigned long)r.a1);
+  }
+}
+
+// ===== OUT STREAM MIRROR =====
+static bool mirrorEndPending = false;
+static const uint8_t MIRROR_LINES_PER_PASS = 8;  // 140-character lines
+
+// Prints mirrored commands as OUT lines; "MIRROR END" once drained after "mirror off"
+void serviceMirror() {
+  if (!outMirrorOn && !mirrorEndPending) return;
+  CpuScope work(CPU_LOOP);
+  
+  MirrorRecord r;
+  char line[MIRROR_LINE_MAX];
+  for (uint8_t i = 0; i < MIRROR_LINES_PER_PASS; i++) {
+    if (!outMirror.pop(r)) {
+      if (mirrorEndPending) {
+        Serial.printf("MIRROR END dropped=%lu\n", (unsigned long)outMirror.droppedCount());
+        mirrorEndPending = false;
+      }
+      return;
+    }
+    mirrorFormatLine(line, sizeof(line), r);
+    Serial.print(line);
+  }
+}
+
+// Cycles per trace point, measured once at startup on an empty ring
+uint32_t measureTraceCost() {
+  const uint8_t N = 32;
+  uint32_t start = ARM_DWT_CYCCNT;
+  for (uint8_t i = 0; i < N; i++) {
+    trace(TRACE_HEARTBEAT, i);
+  }
+  uint32_t cost = (ARM_DWT_CYCCNT - start) / N;
+  traceRing.discard();
+  return cost;
+}
+
+// ===== MEMORY REPORT =====
+// Section boundaries from the Teensy 4.x linker script. RAM1 (512K FlexRAM) is
+// split into ITCM code blocks and DTCM; DTCM holds .data, .bss and the main
+// stack, which grows down from _estack towards _ebss. RAM2 (OCRAM) holds
+// DMAMEM variables followed by the heap.
+extern "C" {
+extern unsigned long _stext, _etext, _sdata, _edata, _sbss, _ebss, _estack;
+extern unsigned long _heap_start, _heap_end, _itcm_block_count;
+extern char* __brkval;
+}
+
+#define RAM1_SIZE       (512u * 1024)
+#define ITCM_BLOCK_SIZE (32u * 1024)
+#define OCRAM_START     0x20200000u
+// Paint the free part of the main stack; call first thing in setup(). The
+// USB host thread's stack is added from its first callback.
+void paintStacks() {
+  uint8_t marker;
+  stackMonitor.add("main", &_ebss, &_estack, (void*)((uintptr_t)&marker - STACK_PAINT_GUARD));
+}
+
+static inline uint32_t addrDiff(const void* hi, const void* lo) {
+  return (uint32_t)((uintptr_t)hi - (uintptr_t)lo);
+}
+
+void printMemoryReport() {
+  uint32_t itcm = (uint32_t)(uintptr_t)&_itcm_block_count * ITCM_BLOCK_SIZE;
+  Serial.println("🧠 Memory:");
+  Serial.printf("   RAM1       itcm %luK (code %lu), dtcm %luK: data %lu, bss %lu, stack space %lu\n",
+                (unsigned long)(itcm / 1024), (unsigned long)addrDiff(&_etext, &_stext),
+                (unsigned long)((RAM1_SIZE - itcm) / 1024), (unsigned long)addrDiff(&_edata, &_sdata),
+                (unsigned long)addrDiff(&_ebss, &_sbss), (unsigned long)addrDiff(&_estack, &_ebss));
+  
+  struct mallinfo mi = mallinfo();
+  char* brk = __brkval ? __brkval : (char*)&_heap_start;
+  Serial.printf("   RAM2       dmamem %lu, heap %lu in use / %lu claimed, %lu free above\n",
+                (unsigned long)((uintptr_t)&_heap_start - OCRAM_START), (unsigned long)mi.uordblks,
+                (unsigned long)addrDiff(brk, &_heap_start), (unsigned long)addrDiff(&_heap_end, brk));
+  Serial.printf("   heap       allocs %lu, frees %lu, live %lu, failed %lu, bytes requested %lu\n",
+                (unsigned long)heapCounters.allocs.load(), (unsigned long)heapCounters.frees.load(),
+                (unsigned long)heapCounters.live(), (unsigned long)heapCounters.failed.load(),
+                (unsigned long)heapCounters.bytes_requested.load());
+#if !CONTROLPAD_WRAP_MALLOC
+  Serial.println("              (allocation counting off: build without the malloc --wrap flags)");
+#endif
+  for (uint8_t i = 0; i < stackMonitor.size(); i++) {
+    const StackRegion& r = stackMonitor[i];
+    Serial.printf("   stack      %s: peak %lu of %lu bytes\n", r.name, (unsigned long)r.highWater(),
+                  (unsigned long)r.size());
+  }
+  uint8_t usbStack = usbStackState.load(std::memory_order_relaxed);
+  if (usbStack == USB_STACK_PENDING) {
+    Serial.println("   stack      usb host: not measured yet (no USB callback so far)");
+  } else if (usbStack == USB_STACK_UNREACHABLE) {
+    Serial.println("   stack      usb host: not measured (no stack bounds from AtomThreads, needs ATOM_STACK_CHECKING)");
+  }
+}
+
+void handleSerialCommand(const char* cmd) {
+  CpuScope work(CPU_LOOP);
+  if (strcmp(cmd, "latency") == 0) {
+    printLatencyStats();
+  } else if (strcmp(cmd, "latency reset") == 0) {
+    pressLatency.reset();
+    Serial.println("⏱️ Press-to-light stats reset");
+  } else if (strcmp(cmd, "callbacks") == 0) {
+    printCallbackCosts();
+  } else if (strcmp(cmd, "stats") == 0) {
+    printDriverStats();
+  } else if (strcmp(cmd, "stats raw") == 0) {
+    printDriverStatsRaw();
+  } else if (strcmp(cmd, "mem") == 0) {
+    printMemoryReport();
+  } else if (strcmp(cmd, "trace") == 0) {
+    printTraceHeader();
+    traceDumpPending = true;
+  } else if (strcmp(cmd, "trace on") == 0) {
+    printTraceHeader();
+    traceStreaming = true;
+  } else if (strcmp(cmd, "trace off") == 0) {
+    traceStreaming = false;
+    Serial.println("TRACE END");
+  } else if (strcmp(cmd, "mirror on") == 0) {
+    Serial.printf("MIRROR BEGIN t=%lu\n", (unsigned long)micros());
+    outMirrorOn = true;
+    mirrorEndPending = false;
+  } else if (strcmp(cmd, "mirror off") == 0) {
+    outMirrorOn = false;
+    mirrorEndPending = true;
+#if CONTROLPAD_BENCH_MODE
+  } else if (strcmp(cmd, "bench") == 0) {
+    runBenchmarks();
+#endif
+  } else if (cmd[0] != '\0') {
+    Serial.printf("❓ Unknown command '%s' (try: stats, stats raw, mem, latency, latency reset, callbacks, trace, trace on, trace off, mirror on, mirror off)\n", cmd);
+  }
+}
+
+void serviceSerialCommands() {
+  static char line[32];
+  static uint8_t len = 0;
+  
+  while (Serial.available() > 0) {
+    char c = (char)Serial.read();
+    if (c == '\r' || c == '\n') {
+      line[len] = '\0';
+      handleSerialCommand(line);
+      len = 0;
+    } else if (len < sizeof(line) - 1) {
+      line[len++] = c;
+    }
+  }
+}
+
 // ===== MAIN SETUP AND LOOP =====
 
 void setup() {
+  paintStacks();
+  bootTrace.begin(BootTrace::buildId(__DATE__ " " __TIME__));
+  bootTrace.mark(BOOT_SETUP, 0, micros());
+  
   Serial.begin(115200);
   while (!Serial && millis() < 3000);
   
+#if CONTROLPAD_BENCH_MODE
+  Serial.println("\n⏱️ ControlPad benchmark build: USB host not started");
+  runBenchmarks();
+  return;
+#endif
+  
   Serial.println("\n🚀 Teensy4 USB Host ControlPad LED Controller 🚀");
   Serial.println("==================================================");
   Serial.println("🎯 DUAL INTERFACE POLLING - Complete Button Detection");
@@ -1801,21 +2591,30 @@ void setup() {
   Serial.println("✅ Simultaneous polling on both endpoints");
   Serial.println("Press keys 1-5 to trigger colored LED responses!");
   
-  // Initialize queue for ControlPad events
-  atomQueueCreate(&controlpad_queue, (uint8_t*)malloc(10 * sizeof(controlpad_event)), 10, sizeof(controlpad_event));
-  
-  Serial.println("📋 Queue created successfully");
+  // Event queue is a static ring - nothing to allocate
+  Serial.printf("📋 Event queue: %lu slots, %u bytes per event\n",
+                (unsigned long)ControlPadEventQueue::capacity(), (unsigned)sizeof(controlpad_event));
+  registerEventHandlers();
+  cpuAccount.begin(ARM_DWT_CYCCNT);
+  Serial.printf("📋 Trace ring: %d records, ~%lu cycles per trace point\n",
+                TRACE_RING_SIZE, (unsigned long)measureTraceCost());
   
   // Initialize USB Host
   Serial.println("🔌 Starting USB Host...");
   usbHost.begin();
+  bootTrace.mark(BOOT_USB_BEGIN, 0, micros());
   
-  delay(1000);  // Give devices time to enumerate
+  // No enumeration delay needed: the driver attaches and runs its init
+  // sequence from the USB host callbacks on its own schedule
   
   Serial.println("✅ USB Host initialized successfully");
   Serial.println("🔧 Dual interface driver factory registered");
   Serial.println("📊 Watch for BOTH keyboard AND control events...");
   Serial.println("🎯 Should detect ALL button presses now!");
+  
+  if (bootTrace.storedBoots() > 1) {
+    printBootHistory();
+  }
 }
 
 void loop() {
@@ -1823,28 +2622,71 @@ void loop() {
   static unsigned long lastTime = 0;
   static bool toggle = false;
   
-  // Process any pending controlpad events from the queue
-  controlpad_event event;
-  if (atomQueueGet(&controlpad_queue, 0, &event) == ATOM_OK) {
-    // Distinguish between keyboard events (8 bytes) and control events (64 bytes)
-    if (event.len == 8) {
-      // Standard HID keyboard event from Interface 0 - already processed in kbd_poll
-      if (event.data[2] != 0 && event.data[2] < 0x80) {
-        uint8_t key = event.data[2];
-        Serial.printf("⌨️ KEYBOARD Key Press: 0x%02X (%d) - Already processed in kbd_poll\n", key, key);
-        // Note: LED processing is handled immediately in kbd_poll for better response time
-      }
-    } else if (event.len == 64) {
-      // Control event from Interface 1 - reduce spam
-      static int controlEventCounter = 0;
-      if (++controlEventCounter % 20 == 1) {  // Show every 20th event
-        Serial.printf("🎮 CONTROL Event #%d: ", controlEventCounter);
-        for (int i = 0; i < min(8, (int)event.len); i++) {
-          Serial.printf("0x%02X ", event.data[i]);
-        }
-        Serial.println();
-      }
-    }
+#if CONTROLPAD_BENCH_MODE
+  serviceSerialCommands();
+  return;
+#endif
+  
+  serviceBootTrace();
+  serviceSerialCommands();
+  
+  // Heartbeat keeps gaps between trace records well under one cycle-counter wrap (~7s)
+  static uint32_t lastHeartbeatMs = 0;
+  if (millis() - lastHeartbeatMs >= 1000) {
+    lastHeartbeatMs = millis();
+    trace(TRACE_HEARTBEAT, lastHeartbeatMs);
   }
+  
+  // The poll callbacks stop on a failed transfer; resume them after a short back-off
+  static uint32_t lastPollRetryMs = 0;
+  if (controlPadDriver && (!controlPadDriver->kbd_polling || !controlPadDriver->ctrl_polling) &&
+      millis() - lastPollRetryMs >= 100) {
+    lastPollRetryMs = millis();
+    controlPadDriver->restartKeyboardPolling();
+    controlPadDriver->restartControlPolling();
+  }
+  
+  // Report overflow as soon as it happens instead of losing events silently
+  static uint32_t reportedDrops = 0;
+  uint32_t drops = controlpad_queue.droppedCount();
+  if (drops != reportedDrops) {
+    trace(TRACE_QUEUE_DROP, drops);
+    LOG_WARN(EVENT, "⚠️ Event queue full: %lu event(s) dropped (total %lu, high water %lu/%lu)\n",
+                  (unsigned long)(drops - reportedDrops), (unsigned long)drops,
+                  (unsigned long)controlpad_queue.highWater(), (unsigned long)ControlPadEventQueue::capacity());
+    reportedDrops = drops;
+  }
+  
+  // Handle everything that arrived since the last pass, within the time budget.
+  // A pass that finds the queue empty stays idle.
+  if (controlpad_queue.size()) {
+    CpuScope work(CPU_LOOP);
+    traceBegin(TRACE_DISPATCH, controlpad_queue.size());
+    uint32_t handled = dispatcher.drain(controlpad_queue, DISPATCH_BUDGET_US * (F_CPU_ACTUAL / 1000000), cycleCount);
+    traceEnd(TRACE_DISPATCH, handled);
+  }
+  
+  // LED frames the handlers queued go out here, one packet whenever its gap
+  // since the previous one has passed; nothing in this pass waits for them
+  if (controlPadDriver) controlPadDriver->serviceLedFrames();
+  
+  // Long-press, hold-repeat and tap timeouts; due gestures land in the queue.
+  // This runs after the drain so key edges that arrived since the last pass
+  // reach the recognizer first. Edges the budget left in the queue still
+  // count: time stops at the oldest of them.
+  if (gestures.busy()) {
+    CpuScope work(CPU_LOOP);
+    gestures.tick(gestureNow(), queueGesture);
+  }
+  
+  serviceTrace();
+  serviceMirror();
+  
+#if CONTROLPAD_CPU_ACCOUNTING
+  // Close the one-second CPU window
+  uint32_t m = cpuLock();
+  cpuAccount.roll(ARM_DWT_CYCCNT, F_CPU_ACTUAL);
+  cpuUnlock(m);
+#endif
 }
   
\ No newline at end of file
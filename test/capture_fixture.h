@@ -0,0 +1,52 @@
+#pragma once
+
+// ===== CAPTURE FIXTURES =====
+// Packets from the USB captures in this directory, for the native test
+// suites (pio test -e native). A capture is looked up next to this header
+// (__FILE__ is absolute when the build uses absolute paths), then under test/
+// of the directory the runner starts in, which is the project root.
+// Captures are read with tools/capture_reader.h, the parser behind the host
+// tools.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "../tools/capture_reader.h"
+
+struct CapturePacket {
+  bool in;              // Device to host
+  uint8_t endpoint;     // Including the direction bit
+  int line;             // Where it starts in the file
+  std::vector<uint8_t> data;
+};
+
+inline FILE* openCapture(const char* name) {
+  std::string dir = __FILE__;
+  size_t slash = dir.find_last_of("/\\");
+  dir = slash == std::string::npos ? "." : dir.substr(0, slash);
+  FILE* f = fopen((dir + "/" + name).c_str(), "r");
+  return f ? f : fopen((std::string("test/") + name).c_str(), "r");
+}
+
+// Packets with a payload on one interface, in capture order; false when the
+// file cannot be read
+inline bool loadCapture(const char* name, int interface_num, std::vector<CapturePacket>& out) {
+  FILE* f = openCapture(name);
+  if (!f) return false;
+
+  CaptureReader reader(f);
+  CaptureRecord r;
+  while (reader.next(r)) {
+    if (r.length == 0 || r.interface_num != interface_num) continue;
+    CapturePacket p;
+    p.in = r.in;
+    p.endpoint = r.endpoint;
+    p.line = r.line;
+    p.data.assign(r.payload, r.payload + r.length);
+    out.push_back(p);
+  }
+  fclose(f);
+  return true;
+}
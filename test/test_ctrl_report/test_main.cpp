@@ -0,0 +1,200 @@
+// Interface 1 report decoder (include/controlpad_ctrl_report.h) on the EP 0x83
+// traffic in the captures: every echo must classify as one and answer the
+// oldest command not yet echoed, and the 42 20 / 43 01 key notifications in
+// effect_modes.txt must fold into the pressed-key bitmap edge by edge.
+
+#include <deque>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+#include "../capture_fixture.h"
+#include "controlpad_ctrl_report.h"
+
+// Captures holding the echo of every command they send
+static const char* const ECHO_CAPTURES[] = {
+  "all red.txt",
+  "\xc3\xa0ll blue.txt",
+  "one button to red.txt",
+  "turn button 1-6 on purple.txt",
+  "all purple back all grey brightnes lloowerd.txt",
+  "bootup_sequencer_control_pad_editor.txt",
+  "connect device, switch from custom to static and back.txt",
+  "connecting_changing one button to red.txt",
+  "effect_modes.txt",
+};
+
+struct CtrlTally {
+  int echoes = 0, keys = 0, notifies = 0, other = 0;
+};
+
+// Runs one capture's interface 1 traffic through a decoder, matching echoes
+// to commands in order; key reports go to onKey
+template <typename OnKey>
+static CtrlTally replayCapture(const char* name, CtrlReportDecoder& decoder, OnKey onKey) {
+  std::vector<CapturePacket> packets;
+  char msg[128];
+  snprintf(msg, sizeof(msg), "cannot read %s", name);
+  TEST_ASSERT_TRUE_MESSAGE(loadCapture(name, 1, packets), msg);
+
+  CtrlTally t;
+  std::deque<const CapturePacket*> unanswered;
+  for (const CapturePacket& p : packets) {
+    if (!p.in) {
+      if (p.endpoint == 0x04 && p.data.size() == CTRL_REPORT_LEN) unanswered.push_back(&p);
+      continue;
+    }
+    if (p.endpoint != 0x83) continue;
+    CtrlReport r = decoder.decode(p.data.data(), (uint8_t)p.data.size());
+    if (r.kind == CTRL_REPORT_ECHO) {
+      snprintf(msg, sizeof(msg), "%s line %d: echo %02x %02x %02x with no command waiting", name, p.line, r.cmd,
+               r.sub, r.index);
+      TEST_ASSERT_FALSE_MESSAGE(unanswered.empty(), msg);
+      snprintf(msg, sizeof(msg), "%s line %d: %02x %02x %02x does not echo line %d", name, p.line, r.cmd, r.sub,
+               r.index, unanswered.front()->line);
+      TEST_ASSERT_TRUE_MESSAGE(CtrlReportDecoder::isEchoOf(p.data.data(), unanswered.front()->data.data()), msg);
+      unanswered.pop_front();
+      t.echoes++;
+    } else if (r.kind == CTRL_REPORT_KEY) {
+      onKey(p, r);
+      t.keys++;
+    } else if (r.kind == CTRL_REPORT_NOTIFY) {
+      t.notifies++;
+    } else {
+      t.other++;
+    }
+  }
+  snprintf(msg, sizeof(msg), "%s: %u commands never echoed", name, (unsigned)unanswered.size());
+  TEST_ASSERT_TRUE_MESSAGE(unanswered.empty(), msg);
+  return t;
+}
+
+// The 43 01 key-down report from effect_modes.txt, with another key index
+static void keyReport(uint8_t key, bool down, uint8_t out[CTRL_REPORT_LEN]) {
+  memset(out, 0, CTRL_REPORT_LEN);
+  out[0] = CTRL_KEY_NOTIFY_CMD;
+  out[1] = CTRL_KEY_NOTIFY_SUB;
+  out[4] = key;
+  out[5] = CTRL_KEY_FLAG_VALID | (down ? CTRL_KEY_FLAG_DOWN : 0);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_every_echo_answers_its_command() {
+  for (const char* name : ECHO_CAPTURES) {
+    CtrlReportDecoder decoder;
+    CtrlTally t = replayCapture(name, decoder, [](const CapturePacket&, const CtrlReport&) {});
+    char msg[96];
+    snprintf(msg, sizeof(msg), "%s: unclassified reports", name);
+    TEST_ASSERT_EQUAL_MESSAGE(0, t.other, msg);
+    TEST_ASSERT_GREATER_THAN(0, t.echoes);
+  }
+}
+
+// effect_modes.txt: key 0x09 goes down and up 14 times, each down announced
+// by 42 20; the bitmap holds exactly that key between the two edges
+void test_effect_modes_key_notifications() {
+  CtrlReportDecoder decoder;
+  bool down = false;
+  int downs = 0;
+  CtrlTally t = replayCapture("effect_modes.txt", decoder, [&](const CapturePacket& p, const CtrlReport& r) {
+    char msg[64];
+    snprintf(msg, sizeof(msg), "line %d: edge out of order", p.line);
+    TEST_ASSERT_EQUAL_HEX8(0x09, r.key);
+    TEST_ASSERT_TRUE_MESSAGE(r.down != down, msg);
+    down = r.down;
+    downs += down;
+    TEST_ASSERT_EQUAL_HEX32(1u << 0x09, r.changed);
+    TEST_ASSERT_EQUAL_HEX32(down ? 1u << 0x09 : 0, r.pressed);
+  });
+  TEST_ASSERT_EQUAL(28, t.keys);
+  TEST_ASSERT_EQUAL(14, downs);
+  TEST_ASSERT_EQUAL(14, t.notifies);
+  TEST_ASSERT_EQUAL(108, t.echoes);
+  TEST_ASSERT_EQUAL_HEX32(0, decoder.pressedKeys());
+}
+
+void test_pre_notify_carries_no_key_state() {
+  std::vector<CapturePacket> packets;
+  TEST_ASSERT_TRUE(loadCapture("effect_modes.txt", 1, packets));
+  CtrlReportDecoder decoder;
+  uint8_t down[CTRL_REPORT_LEN];
+  keyReport(0x09, true, down);
+  decoder.decode(down, CTRL_REPORT_LEN);
+  for (const CapturePacket& p : packets) {
+    if (!p.in || p.data[0] != CTRL_PRE_NOTIFY_CMD || p.data[1] != CTRL_PRE_NOTIFY_SUB) continue;
+    CtrlReport r = decoder.decode(p.data.data(), (uint8_t)p.data.size());
+    TEST_ASSERT_EQUAL(CTRL_REPORT_NOTIFY, r.kind);
+    TEST_ASSERT_EQUAL_HEX32(0, r.changed);
+    TEST_ASSERT_EQUAL_HEX32(1u << 0x09, r.pressed);
+    return;
+  }
+  TEST_FAIL_MESSAGE("no 42 20 report in effect_modes.txt");
+}
+
+// Several keys: the bitmap is the full pad state after every report, and
+// changed has only the key that moved
+void test_bitmap_tracks_several_keys() {
+  CtrlReportDecoder decoder;
+  uint8_t report[CTRL_REPORT_LEN];
+
+  keyReport(0, true, report);
+  CtrlReport r = decoder.decode(report, CTRL_REPORT_LEN);
+  TEST_ASSERT_EQUAL_HEX32(0x00000001, r.pressed);
+
+  keyReport(31, true, report);
+  r = decoder.decode(report, CTRL_REPORT_LEN);
+  TEST_ASSERT_EQUAL_HEX32(0x80000001, r.pressed);
+  TEST_ASSERT_EQUAL_HEX32(0x80000000, r.changed);
+
+  keyReport(31, true, report);   // Repeated down: no change
+  r = decoder.decode(report, CTRL_REPORT_LEN);
+  TEST_ASSERT_EQUAL(CTRL_REPORT_KEY, r.kind);
+  TEST_ASSERT_EQUAL_HEX32(0, r.changed);
+
+  keyReport(0, false, report);
+  r = decoder.decode(report, CTRL_REPORT_LEN);
+  TEST_ASSERT_EQUAL_HEX32(0x80000000, r.pressed);
+  TEST_ASSERT_EQUAL_HEX32(0x00000001, r.changed);
+  TEST_ASSERT_FALSE(r.down);
+
+  decoder.reset();
+  TEST_ASSERT_EQUAL_HEX32(0, decoder.pressedKeys());
+}
+
+// Reports the decoder must not take as key edges
+void test_malformed_key_reports() {
+  CtrlReportDecoder decoder;
+  uint8_t report[CTRL_REPORT_LEN];
+
+  keyReport(CTRL_KEY_MAX, true, report);   // Index past the bitmap
+  TEST_ASSERT_NOT_EQUAL(CTRL_REPORT_KEY, decoder.decode(report, CTRL_REPORT_LEN).kind);
+
+  keyReport(3, true, report);
+  report[5] &= ~CTRL_KEY_FLAG_VALID;       // No valid flag
+  TEST_ASSERT_NOT_EQUAL(CTRL_REPORT_KEY, decoder.decode(report, CTRL_REPORT_LEN).kind);
+
+  keyReport(3, true, report);
+  TEST_ASSERT_EQUAL(CTRL_REPORT_EMPTY, decoder.decode(report, 5).kind);   // Too short for byte 5
+
+  memset(report, 0, sizeof(report));
+  TEST_ASSERT_EQUAL(CTRL_REPORT_EMPTY, decoder.decode(report, CTRL_REPORT_LEN).kind);
+
+  report[0] = 0x99;
+  report[5] = 0x01;
+  TEST_ASSERT_EQUAL(CTRL_REPORT_UNKNOWN, decoder.decode(report, CTRL_REPORT_LEN).kind);
+
+  TEST_ASSERT_EQUAL_HEX32(0, decoder.pressedKeys());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_every_echo_answers_its_command);
+  RUN_TEST(test_effect_modes_key_notifications);
+  RUN_TEST(test_pre_notify_carries_no_key_state);
+  RUN_TEST(test_bitmap_tracks_several_keys);
+  RUN_TEST(test_malformed_key_reports);
+  return UNITY_END();
+}
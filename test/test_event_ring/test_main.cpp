@@ -0,0 +1,124 @@
+// Lock-free event ring (include/controlpad_event_ring.h): full/drop
+// accounting on one thread, then two producer threads against one consumer
+// thread, the way the two USB polling callbacks feed loop(). Every event
+// must arrive exactly once and in order per producer; a push refused
+// because the ring was full must show in droppedCount().
+
+#include <atomic>
+#include <stdint.h>
+#include <thread>
+#include <unity.h>
+
+#include "controlpad_event_ring.h"
+
+struct RingItem {
+  uint32_t producer;
+  uint32_t seq;
+};
+
+void setUp() {}
+void tearDown() {}
+
+void test_fill_drop_and_drain() {
+  EventRing<RingItem, 8> ring;
+  RingItem item;
+  TEST_ASSERT_FALSE(ring.pop(item));
+  TEST_ASSERT_FALSE(ring.peek(item));
+
+  for (uint32_t i = 0; i < 8; i++) TEST_ASSERT_TRUE(ring.push({0, i}));
+  TEST_ASSERT_FALSE(ring.push({0, 8}));
+  TEST_ASSERT_FALSE(ring.push({0, 9}));
+  TEST_ASSERT_EQUAL_UINT32(2, ring.droppedCount());
+  TEST_ASSERT_EQUAL_UINT32(8, ring.size());
+  TEST_ASSERT_EQUAL_UINT32(8, ring.highWater());
+
+  TEST_ASSERT_TRUE(ring.peek(item));
+  TEST_ASSERT_EQUAL_UINT32(0, item.seq);
+  for (uint32_t i = 0; i < 8; i++) {
+    TEST_ASSERT_TRUE(ring.pop(item));
+    TEST_ASSERT_EQUAL_UINT32(i, item.seq);
+  }
+  TEST_ASSERT_FALSE(ring.pop(item));
+  TEST_ASSERT_EQUAL_UINT32(0, ring.size());
+  TEST_ASSERT_EQUAL_UINT32(8, ring.highWater());   // Keeps the deepest fill
+}
+
+// Positions keep counting past the capacity; cells are reused in order
+void test_reuse_after_many_laps() {
+  EventRing<RingItem, 4> ring;
+  RingItem item;
+  for (uint32_t i = 0; i < 1000; i++) {
+    TEST_ASSERT_TRUE(ring.push({0, i}));
+    TEST_ASSERT_TRUE(ring.push({1, i}));
+    TEST_ASSERT_TRUE(ring.pop(item));
+    TEST_ASSERT_EQUAL_UINT32(0, item.producer);
+    TEST_ASSERT_EQUAL_UINT32(i, item.seq);
+    TEST_ASSERT_TRUE(ring.pop(item));
+    TEST_ASSERT_EQUAL_UINT32(1, item.producer);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, ring.droppedCount());
+  TEST_ASSERT_EQUAL_UINT32(2, ring.highWater());
+}
+
+#define RING_PRODUCERS 2
+#define RING_EVENTS_PER_PRODUCER 200000
+
+void test_two_producers_one_consumer() {
+  static EventRing<RingItem, 64> ring;
+  std::atomic<uint32_t> refused{0};
+  std::atomic<bool> go{false};
+
+  auto producer = [&](uint32_t id) {
+    while (!go.load()) std::this_thread::yield();
+    uint32_t misses = 0;
+    for (uint32_t seq = 0; seq < RING_EVENTS_PER_PRODUCER; seq++) {
+      while (!ring.push({id, seq})) {
+        misses++;   // Full: the callback would drop it; here we retry so every event gets through
+        std::this_thread::yield();
+      }
+    }
+    refused += misses;
+  };
+
+  uint32_t next[RING_PRODUCERS] = {};
+  uint32_t received = 0, outOfOrder = 0;
+  auto consumer = [&]() {
+    while (!go.load()) std::this_thread::yield();
+    RingItem item;
+    while (received < RING_PRODUCERS * RING_EVENTS_PER_PRODUCER) {
+      if (!ring.pop(item)) {
+        std::this_thread::yield();
+        continue;
+      }
+      if (item.producer >= RING_PRODUCERS || item.seq != next[item.producer]) {
+        outOfOrder++;
+      } else {
+        next[item.producer]++;
+      }
+      received++;
+    }
+  };
+
+  std::thread c(consumer);
+  std::thread p0(producer, 0);
+  std::thread p1(producer, 1);
+  go = true;
+  p0.join();
+  p1.join();
+  c.join();
+
+  TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);
+  TEST_ASSERT_EQUAL_UINT32(RING_EVENTS_PER_PRODUCER, next[0]);
+  TEST_ASSERT_EQUAL_UINT32(RING_EVENTS_PER_PRODUCER, next[1]);
+  TEST_ASSERT_EQUAL_UINT32(refused.load(), ring.droppedCount());
+  TEST_ASSERT_EQUAL_UINT32(0, ring.size());
+  TEST_ASSERT_TRUE(ring.highWater() >= 1 && ring.highWater() <= ring.capacity());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_fill_drop_and_drain);
+  RUN_TEST(test_reuse_after_many_laps);
+  RUN_TEST(test_two_producers_one_consumer);
+  return UNITY_END();
+}
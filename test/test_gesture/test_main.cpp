@@ -0,0 +1,164 @@
+// Gesture recognizer (include/controlpad_gesture.h) on scripted key edges,
+// clocked the way loop() clocks it: tick() once per millisecond, after the
+// edges of that millisecond. Each script lists the edges and the gestures
+// that must come out, with the time each one is stamped with.
+
+#include <stdint.h>
+#include <unity.h>
+#include <vector>
+
+#include "controlpad_gesture.h"
+
+struct Edge {
+  uint32_t ms;
+  uint8_t button;
+  bool down;
+};
+
+struct Expected {
+  uint8_t button;
+  uint8_t gesture;
+  uint32_t ms;          // Stamp
+  uint16_t repeat;
+};
+
+static GestureRecognizer gestures;
+static std::vector<controlpad_event> emitted;
+
+static void collect(const controlpad_event& e) { emitted.push_back(e); }
+
+// Edges in time order, ticks every ms from start_us until end_ms has passed
+static void play(const std::vector<Edge>& edges, uint32_t end_ms, uint32_t start_us = 0) {
+  size_t next = 0;
+  for (uint32_t ms = 0; ms <= end_ms; ms++) {
+    uint32_t now = start_us + ms * 1000;
+    for (; next < edges.size() && edges[next].ms == ms; next++) {
+      gestures.onKey(edges[next].button, edges[next].down, now, collect);
+    }
+    if (gestures.busy()) gestures.tick(now, collect);
+  }
+}
+
+static void expect(const std::vector<Expected>& want, uint32_t start_us = 0) {
+  TEST_ASSERT_EQUAL_MESSAGE(want.size(), emitted.size(), "number of gestures");
+  for (size_t i = 0; i < want.size(); i++) {
+    TEST_ASSERT_EQUAL(EVENT_GESTURE, emitted[i].type);
+    TEST_ASSERT_EQUAL(want[i].button, emitted[i].button);
+    TEST_ASSERT_EQUAL_MESSAGE(want[i].gesture, emitted[i].code, GestureRecognizer::name(want[i].gesture));
+    TEST_ASSERT_EQUAL_UINT32(start_us + want[i].ms * 1000, emitted[i].timestamp_us);
+    TEST_ASSERT_EQUAL_UINT16(want[i].repeat, emitted[i].report);
+  }
+}
+
+void setUp() {
+  gestures.reset();
+  gestures.setConfig(GestureConfig());
+  emitted.clear();
+}
+
+void tearDown() {}
+
+// Fires when the double-tap gap runs out, stamped at that moment
+void test_tap() {
+  play({{0, 3, true}, {100, 3, false}}, 1000);
+  expect({{3, GESTURE_TAP, 400, 0}});
+  TEST_ASSERT_FALSE(gestures.busy());
+}
+
+// Fires on the second press; its release is swallowed
+void test_double_tap() {
+  play({{0, 3, true}, {100, 3, false}, {250, 3, true}, {300, 3, false}}, 1500);
+  expect({{3, GESTURE_DOUBLE_TAP, 250, 0}});
+}
+
+// Second press just after the gap: a tap, then a new press
+void test_second_press_after_gap() {
+  play({{0, 3, true}, {100, 3, false}, {401, 3, true}, {450, 3, false}}, 1500);
+  expect({{3, GESTURE_TAP, 400, 0}, {3, GESTURE_TAP, 750, 0}});
+}
+
+void test_long_press_with_repeats() {
+  play({{0, 5, true}, {1250, 5, false}}, 2000);
+  expect({{5, GESTURE_LONG_PRESS, 600, 0},
+          {5, GESTURE_HOLD_REPEAT, 1000, 1},
+          {5, GESTURE_HOLD_REPEAT, 1100, 2},
+          {5, GESTURE_HOLD_REPEAT, 1200, 3}});
+  TEST_ASSERT_FALSE(gestures.busy());
+}
+
+// Longer than a tap, released before the long-press time
+void test_medium_press_yields_nothing() {
+  play({{0, 5, true}, {400, 5, false}}, 1500);
+  expect({});
+}
+
+void test_tap_on_release_without_double_tap() {
+  GestureConfig c;
+  c.double_tap_gap_us = 0;
+  gestures.setConfig(c);
+  play({{0, 3, true}, {100, 3, false}, {150, 3, true}, {200, 3, false}}, 1000);
+  expect({{3, GESTURE_TAP, 100, 0}, {3, GESTURE_TAP, 200, 0}});
+}
+
+void test_repeat_disabled() {
+  GestureConfig c;
+  c.repeat_interval_us = 0;
+  gestures.setConfig(c);
+  play({{0, 5, true}, {2000, 5, false}}, 2500);
+  expect({{5, GESTURE_LONG_PRESS, 600, 0}});
+}
+
+// Buttons run their own state machines
+void test_buttons_independent() {
+  play({{0, 1, true}, {50, 24, true}, {100, 1, false}, {900, 24, false}}, 1500);
+  expect({{1, GESTURE_TAP, 400, 0}, {24, GESTURE_LONG_PRESS, 650, 0}});
+}
+
+// A late tick does at most long-press + one repeat; missed repeats are dropped
+void test_late_tick_does_not_burst() {
+  gestures.onKey(7, true, 0, collect);
+  gestures.tick(2000000, collect);
+  expect({{7, GESTURE_LONG_PRESS, 600, 0}, {7, GESTURE_HOLD_REPEAT, 1000, 1}});
+  emitted.clear();
+  gestures.tick(2099000, collect);
+  expect({});
+  gestures.tick(2100000, collect);
+  expect({{7, GESTURE_HOLD_REPEAT, 2100, 2}});
+}
+
+// Deadlines are wrap-safe across the 32-bit micros() rollover
+void test_across_micros_wrap() {
+  uint32_t start = 0xFFFFFFFFu - 300000;
+  play({{0, 9, true}, {700, 9, false}}, 1000, start);
+  expect({{9, GESTURE_LONG_PRESS, 600, 0}}, start);
+}
+
+// The repeat count sticks at 65535 instead of wrapping to 0
+void test_repeat_count_saturates() {
+  gestures.onKey(2, true, 0, collect);
+  uint32_t now = 0;
+  for (uint32_t i = 0; i < 65600; i++) {   // First repeat comes on the 10th tick
+    now += 100000;
+    gestures.tick(now, collect);
+  }
+  TEST_ASSERT_EQUAL(GESTURE_HOLD_REPEAT, emitted.back().code);
+  TEST_ASSERT_EQUAL_UINT16(65535, emitted.back().report);
+  TEST_ASSERT_EQUAL_UINT16(65535, emitted[emitted.size() - 2].report);
+  for (size_t i = 1; i < emitted.size(); i++) TEST_ASSERT_TRUE(emitted[i].report != 0);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_tap);
+  RUN_TEST(test_double_tap);
+  RUN_TEST(test_second_press_after_gap);
+  RUN_TEST(test_long_press_with_repeats);
+  RUN_TEST(test_medium_press_yields_nothing);
+  RUN_TEST(test_tap_on_release_without_double_tap);
+  RUN_TEST(test_repeat_disabled);
+  RUN_TEST(test_buttons_independent);
+  RUN_TEST(test_late_tick_does_not_burst);
+  RUN_TEST(test_across_micros_wrap);
+  RUN_TEST(test_repeat_count_saturates);
+  return UNITY_END();
+}
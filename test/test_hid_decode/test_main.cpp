@@ -0,0 +1,217 @@
+// Keyboard report decoder (include/controlpad_hid.h) on report sequences
+// built from the keyboard data in the captures: the idle report the pad sends
+// on EP 0x81 after connecting, and the button -> usage annotations of
+// "breakdown of 5 commands to set 24 leds.txt", so every key pressed here is
+// one the pad really reports.
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+#include "../capture_fixture.h"
+#include "controlpad_hid.h"
+#include "controlpad_keymap.h"
+
+static uint8_t breakdown[CONTROLPAD_BUTTON_COUNT + 1];   // As annotated; 0 = none
+static uint8_t usageOf[CONTROLPAD_BUTTON_COUNT + 1];     // The same with button 21 filled in
+static uint8_t idleReport[HID_REPORT_LEN];
+static HidReportDecoder decoder;
+
+// "... button 18 0x0B": the usage the editor noted for each LED slot
+static bool loadBreakdownUsages() {
+  FILE* f = openCapture("breakdown of 5 commands to set 24 leds.txt");
+  if (!f) return false;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    const char* p = strstr(line, "button ");
+    int button;
+    unsigned usage;
+    if (p && sscanf(p, "button %d 0x%x", &button, &usage) == 2 && button >= 1 && button <= CONTROLPAD_BUTTON_COUNT) {
+      breakdown[button] = (uint8_t)usage;
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+// First 8-byte report on EP 0x81 of a connect capture
+static bool loadIdleReport() {
+  std::vector<CapturePacket> packets;
+  if (!loadCapture("bootup_sequencer_control_pad_editor.txt", 0, packets)) return false;
+  for (const CapturePacket& p : packets) {
+    if (p.in && p.endpoint == 0x81 && p.data.size() == HID_REPORT_LEN) {
+      memcpy(idleReport, p.data.data(), HID_REPORT_LEN);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Boot report holding the given buttons' usages, in order
+static void reportFor(const std::vector<int>& buttons, uint8_t out[HID_REPORT_LEN], uint8_t modifiers = 0) {
+  memcpy(out, idleReport, HID_REPORT_LEN);
+  out[0] = modifiers;
+  for (size_t i = 0; i < buttons.size() && i < HID_REPORT_LEN - 2; i++) out[2 + i] = usageOf[buttons[i]];
+}
+
+static uint8_t decode(const uint8_t* report, HidKeyEvent* events) {
+  return decoder.decode(report, HID_REPORT_LEN, 1000, events);
+}
+
+void setUp() { decoder.reset(); }
+void tearDown() {}
+
+void test_breakdown_usages_match_keymap() {
+  Keymap keymap;
+  for (int b = 1; b <= CONTROLPAD_BUTTON_COUNT; b++) {
+    char msg[32];
+    snprintf(msg, sizeof(msg), "button %d", b);
+    // Button 21 is listed as 0x00, see controlpad_keymap.h
+    TEST_ASSERT_EQUAL_HEX8_MESSAGE(b == 21 ? 0x00 : keymap.usage(b), breakdown[b], msg);
+  }
+}
+
+void test_idle_report_has_no_keys() {
+  HidKeyEvent events[HID_MAX_KEY_EVENTS];
+  TEST_ASSERT_EQUAL(0, decode(idleReport, events));
+  for (int u = 0; u < 256; u++) TEST_ASSERT_FALSE(decoder.isDown((uint8_t)u));
+}
+
+void test_press_and_release() {
+  Keymap keymap;
+  HidKeyEvent events[HID_MAX_KEY_EVENTS];
+  uint8_t report[HID_REPORT_LEN];
+
+  reportFor({7}, report);
+  TEST_ASSERT_EQUAL(1, decode(report, events));
+  TEST_ASSERT_EQUAL(7, keymap.button(events[0].usage));
+  TEST_ASSERT_TRUE(events[0].pressed);
+  TEST_ASSERT_EQUAL_UINT32(1000, events[0].timestamp_us);
+
+  TEST_ASSERT_EQUAL(0, decode(report, events));   // Same report again: no edge
+
+  TEST_ASSERT_EQUAL(1, decode(idleReport, events));
+  TEST_ASSERT_EQUAL(7, keymap.button(events[0].usage));
+  TEST_ASSERT_FALSE(events[0].pressed);
+}
+
+// Six keys in one report, then a slot change: only the keys that moved
+void test_simultaneous_presses_and_slot_change() {
+  HidKeyEvent events[HID_MAX_KEY_EVENTS];
+  uint8_t report[HID_REPORT_LEN];
+
+  reportFor({1, 6, 11, 16, 21, 24}, report);
+  TEST_ASSERT_EQUAL(6, decode(report, events));
+  for (int i = 0; i < 6; i++) {
+    TEST_ASSERT_TRUE(events[i].pressed);
+    if (i) TEST_ASSERT_TRUE(events[i - 1].usage < events[i].usage);   // Ascending usage order
+  }
+
+  reportFor({1, 6, 11, 16, 24, 2}, report);   // 21 up, 2 down, others move slots
+  TEST_ASSERT_EQUAL(2, decode(report, events));
+  TEST_ASSERT_EQUAL_HEX8(usageOf[21], events[0].usage);   // 0x0E before 0x1F
+  TEST_ASSERT_FALSE(events[0].pressed);
+  TEST_ASSERT_EQUAL_HEX8(usageOf[2], events[1].usage);
+  TEST_ASSERT_TRUE(events[1].pressed);
+}
+
+// A seventh key gives ErrorRollOver in every slot: no events, state kept
+void test_rollover_keeps_state() {
+  HidKeyEvent events[HID_MAX_KEY_EVENTS];
+  uint8_t report[HID_REPORT_LEN];
+
+  reportFor({1, 2, 3, 4, 5, 6}, report);
+  TEST_ASSERT_EQUAL(6, decode(report, events));
+
+  uint8_t rollover[HID_REPORT_LEN] = {0, 0, HID_USAGE_ROLLOVER, HID_USAGE_ROLLOVER, HID_USAGE_ROLLOVER,
+                                      HID_USAGE_ROLLOVER, HID_USAGE_ROLLOVER, HID_USAGE_ROLLOVER};
+  TEST_ASSERT_EQUAL(0, decode(rollover, events));
+  for (int b = 1; b <= 6; b++) TEST_ASSERT_TRUE(decoder.isDown(usageOf[b]));
+
+  reportFor({1, 2, 3, 4, 6}, report);   // Back under six: one release
+  TEST_ASSERT_EQUAL(1, decode(report, events));
+  TEST_ASSERT_EQUAL_HEX8(usageOf[5], events[0].usage);
+  TEST_ASSERT_FALSE(events[0].pressed);
+}
+
+// 8 modifier edges + 6 releases + 6 presses is the most one report can
+// produce; the decoder must fill exactly HID_MAX_KEY_EVENTS and no more
+void test_twenty_event_cap() {
+  HidKeyEvent events[HID_MAX_KEY_EVENTS + 1];
+  uint8_t report[HID_REPORT_LEN];
+
+  reportFor({1, 2, 3, 4, 5, 6}, report, 0xFF);
+  TEST_ASSERT_EQUAL(14, decode(report, events));
+
+  memset(&events[HID_MAX_KEY_EVENTS], 0xA5, sizeof(events[0]));
+  reportFor({7, 8, 9, 10, 11, 12}, report, 0x00);
+  TEST_ASSERT_EQUAL(HID_MAX_KEY_EVENTS, decode(report, events));
+
+  int presses = 0, releases = 0, modifiers = 0;
+  for (int i = 0; i < HID_MAX_KEY_EVENTS; i++) {
+    if (events[i].usage >= HID_USAGE_MOD_FIRST) {
+      modifiers++;
+      TEST_ASSERT_FALSE(events[i].pressed);
+    } else {
+      events[i].pressed ? presses++ : releases++;
+    }
+  }
+  TEST_ASSERT_EQUAL(8, modifiers);
+  TEST_ASSERT_EQUAL(6, releases);
+  TEST_ASSERT_EQUAL(6, presses);
+  TEST_ASSERT_EQUAL_HEX8(0xA5, events[HID_MAX_KEY_EVENTS].usage);   // Untouched past the cap
+}
+
+// 0x02 POSTFail and 0x03 ErrorUndefined are error reports like rollover,
+// and never keys of their own
+void test_error_usages_are_not_keys() {
+  HidKeyEvent events[HID_MAX_KEY_EVENTS];
+  uint8_t report[HID_REPORT_LEN];
+
+  reportFor({3}, report);
+  TEST_ASSERT_EQUAL(1, decode(report, events));
+
+  for (uint8_t error = 0x02; error <= 0x03; error++) {
+    uint8_t failed[HID_REPORT_LEN] = {0, 0, error, error, error, error, error, error};
+    TEST_ASSERT_EQUAL(0, decode(failed, events));
+    TEST_ASSERT_FALSE(decoder.isDown(error));
+    TEST_ASSERT_TRUE(decoder.isDown(usageOf[3]));
+  }
+
+  reportFor({3, 4}, report);
+  report[4] = 0x02;
+  report[5] = 0x03;
+  TEST_ASSERT_EQUAL(1, decode(report, events));
+  TEST_ASSERT_EQUAL_HEX8(usageOf[4], events[0].usage);
+  TEST_ASSERT_FALSE(decoder.isDown(0x02));
+  TEST_ASSERT_FALSE(decoder.isDown(0x03));
+}
+
+void test_short_report_ignored() {
+  HidKeyEvent events[HID_MAX_KEY_EVENTS];
+  uint8_t report[HID_REPORT_LEN];
+  reportFor({1}, report);
+  TEST_ASSERT_EQUAL(0, decoder.decode(report, HID_REPORT_LEN - 1, 0, events));
+  TEST_ASSERT_FALSE(decoder.isDown(usageOf[1]));
+}
+
+int main() {
+  UNITY_BEGIN();
+  if (!loadBreakdownUsages() || !loadIdleReport()) {
+    printf("captures not found\n");
+    return 1;
+  }
+  memcpy(usageOf, breakdown, sizeof(usageOf));
+  usageOf[21] = Keymap().usage(21);
+  RUN_TEST(test_breakdown_usages_match_keymap);
+  RUN_TEST(test_idle_report_has_no_keys);
+  RUN_TEST(test_press_and_release);
+  RUN_TEST(test_simultaneous_presses_and_slot_change);
+  RUN_TEST(test_rollover_keeps_state);
+  RUN_TEST(test_twenty_event_cap);
+  RUN_TEST(test_error_usages_are_not_keys);
+  RUN_TEST(test_short_report_ignored);
+  return UNITY_END();
+}
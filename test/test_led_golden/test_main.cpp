@@ -0,0 +1,149 @@
+// LED encoder/decoder (include/controlpad_led.h) against the official editor
+// captures: every LED packet the editor sent is decoded and re-encoded and
+// must come back byte for byte, every command is echoed on EP 0x83, and the
+// decoded frames show the colours each capture was recorded for. Same checks
+// as tools/golden_check.cpp, which also prints the frames.
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+#include "../capture_fixture.h"
+#include "controlpad_ctrl_report.h"
+#include "controlpad_led.h"
+
+// An echo with the "response" label missing: the device answers a command
+// with its first bytes and zeros, while a real part 1 always carries 01 at [4]
+static bool looksLikeEcho(const CapturePacket& p) {
+  if (ledCommandOf(p.data.data(), (uint8_t)p.data.size()) != LED_CMD_PART1) return false;
+  for (size_t i = 3; i < p.data.size(); i++) {
+    if (p.data[i]) return false;
+  }
+  return true;
+}
+
+struct GoldenResult {
+  std::vector<LedFrame> frames;   // One per part 2, decoded on top of the previous state
+  int packets = 0;                // LED packets re-encoded
+  int echoes = 0;                 // Device echoes matched to their command
+};
+
+static GoldenResult checkCapture(const char* name) {
+  std::vector<CapturePacket> packets;
+  char msg[96];
+  snprintf(msg, sizeof(msg), "cannot read %s", name);
+  TEST_ASSERT_TRUE_MESSAGE(loadCapture(name, 1, packets), msg);
+
+  GoldenResult r;
+  LedFrame state;
+  bool havePart1 = false;
+  const CapturePacket* lastOut = nullptr;
+
+  for (const CapturePacket& p : packets) {
+    uint8_t len = (uint8_t)p.data.size();
+    const uint8_t* d = p.data.data();
+
+    if (p.in) {
+      // USBPcap captures also hold the echo of every interface 1 command
+      if (p.endpoint == 0x83 && lastOut && len == LED_PACKET_LEN) {
+        snprintf(msg, sizeof(msg), "%s line %d does not echo line %d", name, p.line, lastOut->line);
+        TEST_ASSERT_TRUE_MESSAGE(CtrlReportDecoder::isEchoOf(d, lastOut->data.data()), msg);
+        r.echoes++;
+        lastOut = nullptr;
+      }
+      continue;
+    }
+    if (p.endpoint != 0x04) continue;
+    if (len != LED_PACKET_LEN || looksLikeEcho(p)) continue;
+    lastOut = &p;
+
+    uint8_t expect[LED_PACKET_LEN];
+    LedCommand cmd = ledCommandOf(d, len);
+    switch (cmd) {
+      case LED_CMD_MODE:     encodeLedMode(expect); break;
+      case LED_CMD_COMMIT:   encodeLedCommit(expect); break;
+      case LED_CMD_FINALIZE: encodeLedFinalize(expect); break;
+      case LED_CMD_PART1:
+      case LED_CMD_PART2: {
+        LedFrame decoded = state;
+        decodeLedData(d, len, decoded);
+        encodeLedData(decoded, cmd == LED_CMD_PART1 ? 0 : 1, expect);
+        state = decoded;
+        if (cmd == LED_CMD_PART1) {
+          havePart1 = true;
+        } else if (havePart1) {
+          r.frames.push_back(state);
+        }
+        break;
+      }
+      default:
+        continue;
+    }
+    r.packets++;
+    snprintf(msg, sizeof(msg), "%s line %d: %s re-encodes differently", name, p.line, ledCommandName(cmd));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(d, expect, LED_PACKET_LEN, msg);
+  }
+  TEST_ASSERT_TRUE_MESSAGE(r.packets > 0, "no LED packets");
+  return r;
+}
+
+static LedFrame frameWith(uint8_t r, uint8_t g, uint8_t b, int firstButtons, uint8_t brightness = 0xFF) {
+  LedFrame f;
+  for (int i = 1; i <= firstButtons; i++) f.set((uint8_t)i, r, g, b);
+  f.brightness = brightness;
+  return f;
+}
+
+static bool contains(const std::vector<LedFrame>& frames, const LedFrame& want) {
+  for (const LedFrame& f : frames) {
+    if (f == want) return true;
+  }
+  return false;
+}
+
+// Editor purple, as sent for "turn button 1-6 on purple"
+#define PURPLE 0xd7, 0x52, 0xff
+
+void setUp() {}
+void tearDown() {}
+
+void test_all_red() {
+  GoldenResult r = checkCapture("all red.txt");
+  TEST_ASSERT_FALSE(r.frames.empty());
+  for (const LedFrame& f : r.frames) TEST_ASSERT_TRUE_MESSAGE(f == frameWith(0xff, 0, 0, LED_COUNT), "frame is not all red");
+}
+
+void test_all_blue() {
+  GoldenResult r = checkCapture("\xc3\xa0ll blue.txt");
+  TEST_ASSERT_FALSE(r.frames.empty());
+  for (const LedFrame& f : r.frames) TEST_ASSERT_TRUE_MESSAGE(f == frameWith(0, 0, 0xff, LED_COUNT), "frame is not all blue");
+}
+
+// One frame per click: nothing lit, then buttons 1..k purple
+void test_buttons_1_to_6_purple() {
+  GoldenResult r = checkCapture("turn button 1-6 on purple.txt");
+  TEST_ASSERT_EQUAL(7, r.frames.size());
+  for (size_t k = 0; k < r.frames.size(); k++) {
+    char msg[48];
+    snprintf(msg, sizeof(msg), "frame %u should light buttons 1-%u", (unsigned)k, (unsigned)k);
+    TEST_ASSERT_TRUE_MESSAGE(r.frames[k] == frameWith(PURPLE, (int)k), msg);
+  }
+  TEST_ASSERT_GREATER_THAN(0, r.echoes);
+}
+
+void test_custom_value_brightness() {
+  GoldenResult r = checkCapture("setting a custom value.txt");
+  TEST_ASSERT_TRUE_MESSAGE(contains(r.frames, frameWith(PURPLE, 6)), "no frame with buttons 1-6 purple");
+  TEST_ASSERT_TRUE_MESSAGE(r.frames.back() == frameWith(PURPLE, 6, 0x22),
+                           "last frame should be buttons 1-6 purple at brightness 0x22");
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_all_red);
+  RUN_TEST(test_all_blue);
+  RUN_TEST(test_buttons_1_to_6_purple);
+  RUN_TEST(test_custom_value_brightness);
+  return UNITY_END();
+}
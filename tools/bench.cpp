@@ -0,0 +1,155 @@
+// Host microbenchmarks for the driver's hot paths (include/controlpad_bench.h):
+// LED encode/decode, report decoding, effect rendering and the event queue.
+//
+//   g++ -std=c++17 -O2 -Iinclude tools/bench.cpp -o bench
+//   ./bench                                       # table, ns per operation
+//   ./bench --filter encode                       # cases whose name contains "encode"
+//   ./bench --save tools/bench_baseline.txt       # record a baseline
+//   ./bench --compare tools/bench_baseline.txt    # flag cases slower than baseline
+//
+// Each case is calibrated to run at least --min-time seconds (default 0.2),
+// then timed --repetitions times (default 5); the table shows the fastest
+// repetition, which is the one least disturbed by the rest of the machine.
+// --compare exits 1 when a case is more than --threshold percent (default 15)
+// slower than its baseline entry. Baselines are machine specific: record one
+// on the machine that runs the comparison, with the same compiler flags. On
+// a shared or single-core box expect run-to-run noise near the threshold.
+//
+// The firmware's benchmark build prints the same table with cycles filled in.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "controlpad_bench.h"
+
+struct Result {
+  std::string name;
+  double ns;
+  uint32_t iterations;
+};
+
+static double timeRun(const BenchCase& c, uint32_t iterations) {
+  auto start = std::chrono::steady_clock::now();
+  c.run(iterations, c.arg);
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+static Result measure(const BenchCase& c, double minTime, int repetitions) {
+  // Grow the iteration count until one run takes minTime
+  uint32_t iterations = 1;
+  for (;;) {
+    double ns = timeRun(c, iterations);
+    if (ns >= minTime * 1e9 || iterations >= (1u << 30)) break;
+    double scale = ns > 0 ? minTime * 1e9 / ns * 1.2 : 10;
+    iterations = (uint32_t)std::min<double>(std::max<double>(iterations * std::min(scale, 10.0), iterations + 1),
+                                            1u << 30);
+  }
+  std::vector<double> perOp;
+  for (int r = 0; r < repetitions; r++) perOp.push_back(timeRun(c, iterations) / iterations);
+  std::sort(perOp.begin(), perOp.end());
+  return {c.name, perOp[0], iterations};
+}
+
+// "name ns" per line; '#' starts a comment
+static bool loadBaseline(const char* path, std::map<std::string, double>& out) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    char name[128];
+    double ns;
+    if (line[0] != '#' && sscanf(line, "%127s %lf", name, &ns) == 2) out[name] = ns;
+  }
+  fclose(f);
+  return true;
+}
+
+static bool saveBaseline(const char* path, const std::vector<Result>& results) {
+  FILE* f = fopen(path, "w");
+  if (!f) return false;
+  fprintf(f, "# ns/op (fastest of the repetitions) from tools/bench.cpp; compare only on the machine that wrote them\n");
+  for (const Result& r : results) fprintf(f, "%s %.2f\n", r.name.c_str(), r.ns);
+  fclose(f);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const char* filter = nullptr;
+  const char* savePath = nullptr;
+  const char* comparePath = nullptr;
+  double minTime = 0.2;
+  double threshold = 15;
+  int repetitions = 5;
+  for (int i = 1; i < argc; i++) {
+    bool more = i + 1 < argc;
+    if (strcmp(argv[i], "--filter") == 0 && more) {
+      filter = argv[++i];
+    } else if (strcmp(argv[i], "--min-time") == 0 && more) {
+      minTime = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--repetitions") == 0 && more) {
+      repetitions = std::max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--save") == 0 && more) {
+      savePath = argv[++i];
+    } else if (strcmp(argv[i], "--compare") == 0 && more) {
+      comparePath = argv[++i];
+    } else if (strcmp(argv[i], "--threshold") == 0 && more) {
+      threshold = atof(argv[++i]);
+    } else {
+      fprintf(stderr,
+              "usage: %s [--filter text] [--min-time s] [--repetitions n]\n"
+              "          [--save baseline.txt] [--compare baseline.txt] [--threshold pct]\n",
+              argv[0]);
+      return strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0 ? 0 : 1;
+    }
+  }
+
+  std::map<std::string, double> baseline;
+  if (comparePath && !loadBaseline(comparePath, baseline)) {
+    perror(comparePath);
+    return 1;
+  }
+
+  BenchCase cases[BENCH_MAX_CASES];
+  uint8_t count = benchCases(cases);
+  char row[160];
+  benchFormatHeader(row, sizeof(row));
+  printf("%s%s\n", row, comparePath ? "   vs baseline" : "");
+
+  std::vector<Result> results;
+  int regressions = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    if (filter && !strstr(cases[i].name, filter)) continue;
+    Result r = measure(cases[i], minTime, repetitions);
+    results.push_back(r);
+    benchFormatRow(row, sizeof(row), r.name.c_str(), r.ns, 0, r.iterations);
+    printf("%s", row);
+    auto base = baseline.find(r.name);
+    if (base != baseline.end() && base->second > 0) {
+      double change = (r.ns / base->second - 1) * 100;
+      bool slower = change > threshold;
+      regressions += slower;
+      printf("   %+6.1f%%%s", change, slower ? "  REGRESSION" : "");
+    } else if (comparePath) {
+      printf("   (new)");
+    }
+    printf("\n");
+  }
+
+  if (savePath) {
+    if (!saveBaseline(savePath, results)) {
+      perror(savePath);
+      return 1;
+    }
+    printf("baseline written to %s\n", savePath);
+  }
+  if (comparePath) {
+    printf("%d regression%s over %.0f%%\n", regressions, regressions == 1 ? "" : "s", threshold);
+  }
+  return regressions ? 1 : 0;
+}
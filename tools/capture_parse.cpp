@@ -0,0 +1,116 @@
+// Turns the capture text files under test/ into one record per USB packet
+// (see capture_reader.h), or measures how fast that goes.
+//
+//   g++ -std=c++17 -O2 -Iinclude tools/capture_parse.cpp -o capture_parse
+//   ./capture_parse "test/effect_modes.txt"            # one line per packet
+//   ./capture_parse --data "test/effect_modes.txt"     # only packets with a payload
+//   ./capture_parse --bench test/*.txt                 # throughput
+//
+// Output columns, tab separated:
+//   frame  time_us  dir  ep  iface  type  stage  status  len  payload-hex
+// time_us is '-' when the capture has no timestamps; dir is OUT/IN followed
+// by '+' for an IRP completion; iface is -1 for EP0.
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "capture_reader.h"
+
+static const char* transferName(uint8_t t) {
+  switch (t) {
+    case CAPTURE_ISOCHRONOUS: return "iso";
+    case CAPTURE_INTERRUPT:   return "intr";
+    case CAPTURE_CONTROL:     return "ctrl";
+    case CAPTURE_BULK:        return "bulk";
+    default:                  return "?";
+  }
+}
+
+static void printRecord(const CaptureRecord& r) {
+  printf("%" PRIu32 "\t", r.frame);
+  if (r.has_time) {
+    printf("%" PRIu64 "\t", r.time_us);
+  } else {
+    printf("-\t");
+  }
+  printf("%s%s\t0x%02X\t%d\t%s\t%u\t0x%08" PRIX32 "\t%u\t", r.in ? "IN" : "OUT", r.completion ? "+" : "",
+         r.endpoint, r.interface_num, transferName(r.transfer), r.stage, r.status, r.length);
+  for (uint16_t i = 0; i < r.length; i++) printf("%02x", r.payload[i]);
+  printf("%s\n", r.truncated ? "..." : "");
+}
+
+// Parse every file `rounds` times; reports throughput over the whole set
+static int bench(const std::vector<const char*>& paths, int rounds) {
+  uint64_t bytes = 0, records = 0, payload = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < rounds; round++) {
+    for (const char* path : paths) {
+      FILE* f = fopen(path, "r");
+      if (!f) {
+        perror(path);
+        return 1;
+      }
+      CaptureReader reader(f);
+      CaptureRecord r;
+      while (reader.next(r)) {
+        records++;
+        payload += r.length;
+      }
+      bytes += reader.bytesRead();
+      fclose(f);
+    }
+  }
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("%d file(s) x %d rounds: %.1f MB text, %" PRIu64 " records, %" PRIu64 " payload bytes\n",
+         (int)paths.size(), rounds, bytes / 1e6, records, payload);
+  printf("%.3f s, %.1f MB/s, %.2f M records/s, reader state %zu bytes\n", s, bytes / 1e6 / s, records / 1e6 / s,
+         sizeof(CaptureReader));
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  bool benchMode = false;
+  bool dataOnly = false;
+  int rounds = 20;
+  std::vector<const char*> paths;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--bench") == 0) {
+      benchMode = true;
+    } else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+      rounds = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--data") == 0) {
+      dataOnly = true;
+    } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      fprintf(stderr, "usage: %s [--data] capture.txt ...\n       %s --bench [--rounds N] capture.txt ...\n",
+              argv[0], argv[0]);
+      return 0;
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.empty()) {
+    fprintf(stderr, "no capture files given\n");
+    return 1;
+  }
+  if (benchMode) return bench(paths, rounds < 1 ? 1 : rounds);
+
+  for (const char* path : paths) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+      perror(path);
+      return 1;
+    }
+    if (paths.size() > 1) printf("# %s\n", path);
+    CaptureReader reader(f);
+    CaptureRecord r;
+    while (reader.next(r)) {
+      if (dataOnly && r.length == 0) continue;
+      printRecord(r);
+    }
+    fclose(f);
+  }
+  return 0;
+}
@@ -0,0 +1,403 @@
+#pragma once
+
+// Streaming reader for the USB captures under test/. One pass, constant
+// memory: records come out one at a time and the payload points into the
+// reader's buffer until the next call.
+//
+// Formats, which may be mixed within a file:
+//   - Wireshark "Print" output: "No. Time ..." summary lines give the frame
+//     number and timestamp and the hex dump below the details is the USBPcap
+//     packet. Prints made without "bytes" have no dump; the record is then
+//     built from the detail lines (endpoint, IRP information, status, ...)
+//     with the payload from "HID Data:" / "Leftover Capture Data:" /
+//     "Data Fragment:". Payloads Wireshark only shows dissected (descriptors,
+//     setup packets) come out empty, with data_length still set.
+//   - Bare hex dumps ("Copy as hex dump"): the same packets, no timestamps.
+//   - Hand-written notes with one 64-byte interface 1 packet per line as 128
+//     hex digits; a line mentioning "response" is a device echo. Lines with
+//     a "Label:" before the digits are Wireshark details repeating a payload
+//     ("HID Data: ...") and are skipped.
+//
+// The USBPcap pseudo-header (27 bytes, 28 for control transfers with the
+// stage byte; its length is the first field) is decoded and stripped.
+//
+// Host only: uses stdio.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CAPTURE_MAX_RAW  4096   // Largest USBPcap packet kept; longer ones are truncated
+#define CAPTURE_LINE_MAX (CAPTURE_MAX_RAW * 2 + 64)
+
+// USBPcap pseudo-header layout
+#define USBPCAP_HEADER_MIN      27
+#define USBPCAP_STATUS_OFFSET   10   // USBD_STATUS, 4 bytes LE
+#define USBPCAP_INFO_OFFSET     16   // Bit 0: IRP completion (PDO -> FDO)
+#define USBPCAP_ENDPOINT_OFFSET 21   // Bit 7: IN endpoint
+#define USBPCAP_TRANSFER_OFFSET 22
+#define USBPCAP_LENGTH_OFFSET   23   // Data length, 4 bytes LE
+#define USBPCAP_STAGE_OFFSET    27   // Control transfers only
+
+enum CaptureTransfer : uint8_t {
+  CAPTURE_ISOCHRONOUS = 0,
+  CAPTURE_INTERRUPT = 1,
+  CAPTURE_CONTROL = 2,
+  CAPTURE_BULK = 3
+};
+
+struct CaptureRecord {
+  uint32_t frame;          // Wireshark frame number; 0 when the dump has none
+  bool has_time;
+  uint64_t time_us;        // Capture timestamp
+  bool in;                 // Data direction device to host (endpoint bit 7)
+  bool completion;         // IRP completion rather than submission
+  uint8_t endpoint;        // Including the direction bit
+  int8_t interface_num;    // ControlPad interface owning the endpoint, -1 for EP0/unknown
+  uint8_t transfer;        // CaptureTransfer
+  uint8_t stage;           // Control transfer stage, 0 otherwise
+  uint32_t status;         // USBD_STATUS
+  bool annotated;          // From a hand-written note line
+  bool from_details;       // Built from Wireshark detail lines, no hex dump
+  uint32_t data_length;    // Payload length the capture declares
+  bool truncated;
+  int line;                // First line of the packet in the file
+  const uint8_t* payload;  // Valid until the next call to next()
+  uint16_t length;
+};
+
+// EP 0x81: interface 0 keyboard reports; EP 0x83 / 0x04: interface 1 control
+inline int8_t controlPadInterface(uint8_t endpoint) {
+  switch (endpoint) {
+    case 0x81: return 0;
+    case 0x83:
+    case 0x04: return 1;
+    default:   return -1;
+  }
+}
+
+class CaptureReader {
+public:
+  explicit CaptureReader(FILE* in) : f(in) {}
+
+  // Next packet; false at end of input
+  bool next(CaptureRecord& rec) {
+    for (;;) {
+      if (!havePending && !readLine()) {
+        if (rawLen) return flushDump(rec);
+        return flushDetails(rec);
+      }
+      havePending = false;
+
+      if (isDumpRow()) {
+        addDumpRow();
+        continue;
+      }
+      // Any other line ends a dump in progress; keep the line for next time
+      if (rawLen) {
+        havePending = true;
+        if (flushDump(rec)) return true;
+        continue;
+      }
+
+      if (strncmp(line, "No.", 3) == 0) {
+        // A packet printed without bytes ends where the next one starts
+        if (flushDetails(rec)) {
+          havePending = true;
+          return true;
+        }
+        expectSummary = true;
+        continue;
+      }
+      if (expectSummary) {
+        expectSummary = false;
+        if (parseSummary()) continue;
+      }
+      unsigned long n;
+      if (line[0] == 'F' && sscanf(line, "Frame %lu:", &n) == 1) {
+        frame = (uint32_t)n;
+        continue;
+      }
+      if (parseDetail()) continue;
+      if (parseAnnotated(rec)) return true;
+    }
+  }
+
+  int lineNumber() const { return lineNo_; }
+  uint64_t bytesRead() const { return bytes; }
+
+private:
+  static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+
+  bool readLine() {
+    if (!fgets(line, sizeof(line), f)) return false;
+    lineNo_++;
+    size_t n = strlen(line);
+    bytes += n;
+    // Over-long lines (long "Leftover Capture Data") only matter for their start
+    if (n == sizeof(line) - 1 && line[n - 1] != '\n') {
+      int c;
+      while ((c = fgetc(f)) != EOF) {
+        bytes++;
+        if (c == '\n') break;
+      }
+    }
+    return true;
+  }
+
+  // "0010  00 01 ..." - four hex digits and two spaces
+  bool isDumpRow() const {
+    for (int i = 0; i < 4; i++) {
+      if (hexValue(line[i]) < 0) return false;
+    }
+    return line[4] == ' ' && line[5] == ' ' && hexValue(line[6]) >= 0;
+  }
+
+  void addDumpRow() {
+    if (line[0] == '0' && line[1] == '0' && line[2] == '0' && line[3] == '0') {
+      rawLen = 0;
+      rawTruncated = false;
+      rawLine = lineNo_;
+    }
+    for (const char* p = line + 6; hexValue(p[0]) >= 0 && hexValue(p[1]) >= 0; p += 3) {
+      if (rawLen < CAPTURE_MAX_RAW) {
+        raw[rawLen++] = (uint8_t)(hexValue(p[0]) << 4 | hexValue(p[1]));
+      } else {
+        rawTruncated = true;
+      }
+      if (p[2] != ' ' || p[3] == ' ') break;   // Two spaces: ASCII column follows
+    }
+  }
+
+  static uint32_t le32(const uint8_t* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+  }
+
+  bool flushDump(CaptureRecord& rec) {
+    size_t n = rawLen;
+    rawLen = 0;
+    if (n < USBPCAP_HEADER_MIN) return false;
+    uint16_t hdr = (uint16_t)(raw[0] | raw[1] << 8);
+    if (hdr < USBPCAP_HEADER_MIN || hdr > n) return false;
+
+    rec.frame = frame;
+    rec.has_time = haveTime;
+    rec.time_us = time;
+    rec.endpoint = raw[USBPCAP_ENDPOINT_OFFSET];
+    rec.in = rec.endpoint & 0x80;
+    rec.completion = raw[USBPCAP_INFO_OFFSET] & 1;
+    rec.interface_num = controlPadInterface(rec.endpoint);
+    rec.transfer = raw[USBPCAP_TRANSFER_OFFSET];
+    rec.stage = hdr > USBPCAP_STAGE_OFFSET && rec.transfer == CAPTURE_CONTROL ? raw[USBPCAP_STAGE_OFFSET] : 0;
+    rec.status = le32(raw + USBPCAP_STATUS_OFFSET);
+    rec.annotated = false;
+    rec.from_details = false;
+    rec.data_length = le32(raw + USBPCAP_LENGTH_OFFSET);
+    rec.truncated = rawTruncated;
+    rec.line = rawLine;
+    rec.payload = raw + hdr;
+    rec.length = (uint16_t)(n - hdr);
+
+    // Metadata belongs to this packet only
+    frame = 0;
+    haveTime = false;
+    details = Details();
+    return true;
+  }
+
+  // ----- Packets printed without a hex dump -----
+
+  struct Details {
+    bool valid = false;      // Saw "USBPcap pseudoheader length"
+    int line = 0;
+    uint8_t info = 0;
+    uint8_t endpoint = 0;
+    uint8_t transfer = 0;
+    uint8_t stage = 0;
+    uint32_t status = 0;
+    uint32_t data_length = 0;
+    size_t length = 0;       // Payload bytes from a hex detail line
+    bool truncated = false;
+  };
+
+  // Value in the last "(0x..)" / "(..)" on the line
+  bool parenValue(unsigned long& v) const {
+    const char* p = strrchr(line, '(');
+    if (!p) return false;
+    char* end;
+    v = strtoul(p + 1, &end, 0);
+    return end != p + 1 && *end == ')';
+  }
+
+  bool parseHexDetail(const char* label) {
+    size_t n = strlen(label);
+    if (strncmp(line, label, n) != 0) return false;
+    details.length = 0;
+    for (const char* p = line + n; hexValue(p[0]) >= 0 && hexValue(p[1]) >= 0; p += 2) {
+      if (details.length == CAPTURE_MAX_RAW) {
+        details.truncated = true;
+        break;
+      }
+      detailPayload[details.length++] = (uint8_t)(hexValue(p[0]) << 4 | hexValue(p[1]));
+    }
+    return true;
+  }
+
+  // Number after a "<label>" prefix; base 0 takes the 0x of hex fields
+  bool fieldValue(const char* label, unsigned long& v, int base = 10) const {
+    size_t n = strlen(label);
+    if (strncmp(line, label, n) != 0) return false;
+    char* end;
+    v = strtoul(line + n, &end, base);
+    return end != line + n;
+  }
+
+  bool parseDetail() {
+    // Every field used here is indented or starts with one of H, L
+    if (line[0] != ' ' && line[0] != 'H' && line[0] != 'L') return false;
+    unsigned long v;
+    if (fieldValue("    USBPcap pseudoheader length: ", v)) {
+      details = Details();
+      details.valid = true;
+      details.line = lineNo_;
+      return true;
+    }
+    if (!details.valid) return false;
+    if (strncmp(line, "    IRP USBD_STATUS:", 20) == 0 && parenValue(v)) {
+      details.status = (uint32_t)v;
+    } else if (fieldValue("    IRP information: ", v, 0)) {
+      details.info = (uint8_t)v;
+    } else if (fieldValue("    Endpoint: ", v, 0)) {
+      details.endpoint = (uint8_t)v;
+    } else if (strncmp(line, "    URB transfer type:", 22) == 0 && parenValue(v)) {
+      details.transfer = (uint8_t)v;
+    } else if (strncmp(line, "    Control transfer stage:", 27) == 0 && parenValue(v)) {
+      details.stage = (uint8_t)v;
+    } else if (fieldValue("    Packet Data Length: ", v)) {
+      details.data_length = (uint32_t)v;
+    } else if (parseHexDetail("HID Data: ") || parseHexDetail("Leftover Capture Data: ") ||
+               parseHexDetail("    Data Fragment: ")) {
+      // Payload captured
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  bool flushDetails(CaptureRecord& rec) {
+    if (!details.valid) return false;
+    rec.frame = frame;
+    rec.has_time = haveTime;
+    rec.time_us = time;
+    rec.endpoint = details.endpoint;
+    rec.in = rec.endpoint & 0x80;
+    rec.completion = details.info & 1;
+    rec.interface_num = controlPadInterface(rec.endpoint);
+    rec.transfer = details.transfer;
+    rec.stage = details.stage;
+    rec.status = details.status;
+    rec.annotated = false;
+    rec.from_details = true;
+    rec.data_length = details.data_length;
+    rec.truncated = details.truncated;
+    rec.line = details.line;
+    rec.payload = detailPayload;
+    rec.length = (uint16_t)details.length;
+
+    frame = 0;
+    haveTime = false;
+    details = Details();
+    return true;
+  }
+
+  // "   4866 9.416759   1.25.4 ..." below a "No. Time" header
+  bool parseSummary() {
+    const char* p = line;
+    while (*p == ' ') p++;
+    char* end;
+    unsigned long n = strtoul(p, &end, 10);
+    if (end == p || *end != ' ') return false;
+    p = end;
+    while (*p == ' ') p++;
+
+    uint64_t sec = 0, frac = 0;
+    int digits = 0;
+    if (*p < '0' || *p > '9') return false;
+    while (*p >= '0' && *p <= '9') sec = sec * 10 + (uint64_t)(*p++ - '0');
+    if (*p == '.') {
+      p++;
+      for (; *p >= '0' && *p <= '9'; p++) {
+        if (digits < 6) {
+          frac = frac * 10 + (uint64_t)(*p - '0');
+          digits++;
+        }
+      }
+    }
+    for (; digits < 6; digits++) frac *= 10;
+
+    frame = (uint32_t)n;
+    time = sec * 1000000 + frac;
+    haveTime = true;
+    return true;
+  }
+
+  bool parseAnnotated(CaptureRecord& rec) {
+    const char* s = line;
+    while (*s) {
+      const char* e = s;
+      while (hexValue(*e) >= 0) e++;
+      if (e - s == 128) {
+        // "HID Data: 5681..." repeats the dump that follows
+        for (const char* c = line; c < s; c++) {
+          if (*c == ':') return false;
+        }
+        for (size_t i = 0; i < 64; i++) raw[i] = (uint8_t)(hexValue(s[2 * i]) << 4 | hexValue(s[2 * i + 1]));
+        rec.frame = 0;
+        rec.has_time = false;
+        rec.time_us = 0;
+        rec.in = strstr(line, "response") != nullptr;
+        rec.completion = rec.in;
+        rec.endpoint = rec.in ? 0x83 : 0x04;
+        rec.interface_num = 1;
+        rec.transfer = CAPTURE_INTERRUPT;
+        rec.stage = 0;
+        rec.status = 0;
+        rec.annotated = true;
+        rec.from_details = false;
+        rec.data_length = 64;
+        rec.truncated = false;
+        rec.line = lineNo_;
+        rec.payload = raw;
+        rec.length = 64;
+        return true;
+      }
+      s = *e ? e + 1 : e;
+    }
+    return false;
+  }
+
+  FILE* f;
+  char line[CAPTURE_LINE_MAX];
+  bool havePending = false;
+  int lineNo_ = 0;
+  uint64_t bytes = 0;
+
+  uint8_t raw[CAPTURE_MAX_RAW];
+  size_t rawLen = 0;
+  bool rawTruncated = false;
+  int rawLine = 0;
+
+  Details details;
+  uint8_t detailPayload[CAPTURE_MAX_RAW];
+
+  bool expectSummary = false;
+  uint32_t frame = 0;
+  bool haveTime = false;
+  uint64_t time = 0;
+};
@@ -0,0 +1,303 @@
+// Timing of the official editor's interface 1 traffic, from the captures in
+// test/ that carry timestamps (Wireshark prints; hex-only dumps have none).
+//
+//   g++ -std=c++17 -O2 -Iinclude tools/capture_timing.cpp -o capture_timing
+//   ./capture_timing test/bootup_sequencer_control_pad_editor.txt test/effect_modes.txt
+//   ./capture_timing --burst-gap 50 --tsv test/effect_modes.txt
+//
+// For every EP 0x04 command type it reports, in microseconds:
+//   gap     time since the previous command of any type: the pacing the editor
+//           uses in front of this command
+//   echo    command submit to its EP 0x83 echo: device turnaround
+// followed by refresh periods (41 80 commit to commit, 56 83 00 to 56 83 00)
+// and the bursts: runs of commands separated by less than --burst-gap ms,
+// with their size, length, internal gaps, the idle time between them and the
+// command sequences that make them up.
+//
+// A last table boils this down to pacer settings.
+//
+// Percentiles are nearest-rank over all files given. --tsv prints the same
+// tables tab separated for scripts.
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "capture_reader.h"
+#include "controlpad_ctrl_report.h"
+#include "controlpad_led.h"
+
+static bool tsv = false;
+
+struct Samples {
+  std::vector<uint64_t> v;
+
+  void add(uint64_t x) { v.push_back(x); }
+
+  uint64_t pct(int p) {
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    size_t rank = (v.size() * p + 99) / 100;
+    return v[rank ? rank - 1 : 0];
+  }
+};
+
+// "56 83 00 part1", "52 80", ...: LED commands by part, the rest by two bytes
+static std::string commandKey(const uint8_t* p) {
+  char b[32];
+  LedCommand c = ledCommandOf(p, CTRL_REPORT_LEN);
+  if (c == LED_CMD_PART1 || c == LED_CMD_PART2) {
+    snprintf(b, sizeof(b), "%02x %02x %02x %s", p[0], p[1], p[2], ledCommandName(c));
+  } else if (c != LED_CMD_OTHER) {
+    snprintf(b, sizeof(b), "%02x %02x %s", p[0], p[1], ledCommandName(c));
+  } else {
+    snprintf(b, sizeof(b), "%02x %02x", p[0], p[1]);
+  }
+  return b;
+}
+
+// Short form for burst signatures
+static std::string shortKey(const uint8_t* p) {
+  char b[8];
+  snprintf(b, sizeof(b), "%02x%02x", p[0], p[1]);
+  return b;
+}
+
+struct CommandStats {
+  uint32_t count = 0;
+  Samples gap;
+  Samples echo;
+};
+
+struct Pending {
+  uint8_t head[3];
+  std::string key;
+  uint64_t t;
+};
+
+struct Burst {
+  uint32_t commands = 0;
+  uint64_t start = 0, end = 0;
+  std::string signature;
+};
+
+struct Analysis {
+  std::map<std::string, CommandStats> commands;
+  Samples commitPeriod, burstCommitPeriod, framePeriod;
+  Samples allEchoes;
+  Samples burstSize, burstLength, burstInnerGap, burstIdle;
+  std::map<std::string, uint32_t> signatures;
+  uint32_t unmatchedEchoes = 0, files = 0, timedFiles = 0;
+  uint64_t burstGapUs = 100000;
+};
+
+static void closeBurst(Analysis& a, const Burst& b) {
+  if (!b.commands) return;
+  a.burstSize.add(b.commands);
+  a.burstLength.add(b.end - b.start);
+  a.signatures[b.signature]++;
+}
+
+static bool analyze(const char* path, Analysis& a) {
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  a.files++;
+  CaptureReader reader(f);
+  CaptureRecord r;
+  bool timed = false, haveLast = false, haveCommit = false, haveFrame = false;
+  uint64_t last = 0, lastCommit = 0, lastFrame = 0;
+  std::vector<Pending> pending;
+  Burst burst;
+
+  while (reader.next(r)) {
+    if (!r.has_time || r.length != CTRL_REPORT_LEN || r.interface_num != 1) continue;
+    timed = true;
+    uint64_t t = r.time_us;
+
+    if (r.in) {
+      if (r.endpoint != 0x83) continue;
+      // Unsolicited reports (42 20, 43 01) match nothing and are skipped;
+      // an echo whose command is not first in line retires the ones before it
+      for (size_t i = 0; i < pending.size(); i++) {
+        if (CtrlReportDecoder::isEchoOf(r.payload, pending[i].head)) {
+          a.commands[pending[i].key].echo.add(t - pending[i].t);
+          a.allEchoes.add(t - pending[i].t);
+          a.unmatchedEchoes += i;
+          pending.erase(pending.begin(), pending.begin() + i + 1);
+          break;
+        }
+      }
+      continue;
+    }
+    if (r.endpoint != 0x04) continue;
+
+    std::string key = commandKey(r.payload);
+    CommandStats& cs = a.commands[key];
+    cs.count++;
+    if (haveLast) cs.gap.add(t - last);
+
+    if (!haveLast || t - last >= a.burstGapUs) {
+      closeBurst(a, burst);
+      if (haveLast) a.burstIdle.add(t - last);
+      burst = Burst();
+      burst.start = t;
+    } else {
+      a.burstInnerGap.add(t - last);
+    }
+    burst.commands++;
+    burst.end = t;
+    if (burst.commands <= 8) {
+      if (!burst.signature.empty()) burst.signature += ' ';
+      burst.signature += burst.commands == 8 ? "..." : shortKey(r.payload);
+    }
+
+    LedCommand c = ledCommandOf(r.payload, CTRL_REPORT_LEN);
+    if (c == LED_CMD_COMMIT) {
+      if (haveCommit) {
+        a.commitPeriod.add(t - lastCommit);
+        if (t - lastCommit < a.burstGapUs) a.burstCommitPeriod.add(t - lastCommit);
+      }
+      lastCommit = t;
+      haveCommit = true;
+    } else if (c == LED_CMD_PART1) {
+      if (haveFrame) a.framePeriod.add(t - lastFrame);
+      lastFrame = t;
+      haveFrame = true;
+    }
+
+    Pending p;
+    memcpy(p.head, r.payload, 3);
+    p.key = key;
+    p.t = t;
+    pending.push_back(p);
+    last = t;
+    haveLast = true;
+  }
+  closeBurst(a, burst);
+  fclose(f);
+  if (timed) a.timedFiles++;
+  return true;
+}
+
+// ----- Output -----
+
+static void header(const char* title, const char* columns) {
+  if (tsv) {
+    printf("# %s\n%s\n", title, columns);
+  } else {
+    printf("\n%s\n", title);
+  }
+}
+
+static void distribution(const char* name, uint32_t count, Samples& s) {
+  if (tsv) {
+    printf("%s\t%u\t%zu\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\n", name, count, s.v.size(),
+           s.pct(0), s.pct(10), s.pct(50), s.pct(90), s.pct(100));
+  } else if (s.v.empty()) {
+    printf("  %-22s %6u %6s\n", name, count, "-");
+  } else {
+    printf("  %-22s %6u %6zu %9" PRIu64 " %9" PRIu64 " %9" PRIu64 " %9" PRIu64 " %9" PRIu64 "\n", name, count,
+           s.v.size(), s.pct(0), s.pct(10), s.pct(50), s.pct(90), s.pct(100));
+  }
+}
+
+static void columns() {
+  if (!tsv) printf("  %-22s %6s %6s %9s %9s %9s %9s %9s\n", "", "count", "n", "min", "p10", "p50", "p90", "max");
+}
+
+static const char* TSV_COLUMNS = "name\tcount\tn\tmin\tp10\tp50\tp90\tmax";
+
+// The numbers a pacer needs, picked from the tables above
+static void settings(Analysis& a) {
+  header("Pacer settings", "setting\tus\tfrom");
+  struct Row {
+    const char* name;
+    uint64_t us;
+    const char* from;
+  } rows[] = {
+    {"min command gap", a.burstInnerGap.pct(0), "fastest the editor ever sends"},
+    {"typical command gap", a.burstInnerGap.pct(50), "p50 gap inside a burst"},
+    {"echo timeout", a.allEchoes.pct(100), "slowest echo seen"},
+    {"echo wait", a.allEchoes.pct(90), "p90 command to echo"},
+    {"frame period", a.burstCommitPeriod.pct(50), "p50 commit to commit inside a burst"},
+    {"idle before new burst", a.burstIdle.pct(0), "shortest pause between bursts"},
+  };
+  for (const Row& r : rows) {
+    printf(tsv ? "%s\t%" PRIu64 "\t%s\n" : "  %-22s %9" PRIu64 "  %s\n", r.name, r.us, r.from);
+  }
+}
+
+static void report(Analysis& a) {
+  if (!a.timedFiles) {
+    printf("no timestamped interface 1 traffic in %u file(s)\n", a.files);
+    return;
+  }
+  if (!tsv) printf("%u file(s), %u with timestamps; all times in us\n", a.files, a.timedFiles);
+
+  header("Gap before each command (pacing)", TSV_COLUMNS);
+  columns();
+  for (auto& [key, cs] : a.commands) distribution(key.c_str(), cs.count, cs.gap);
+
+  header("Command to echo (device turnaround)", TSV_COLUMNS);
+  columns();
+  for (auto& [key, cs] : a.commands) distribution(key.c_str(), cs.count, cs.echo);
+  if (a.unmatchedEchoes && !tsv) printf("  %u command(s) without an echo\n", a.unmatchedEchoes);
+
+  header("Refresh periods", TSV_COLUMNS);
+  columns();
+  distribution("commit to commit", (uint32_t)a.commitPeriod.v.size(), a.commitPeriod);
+  distribution("  inside bursts", (uint32_t)a.burstCommitPeriod.v.size(), a.burstCommitPeriod);
+  distribution("part1 to part1", (uint32_t)a.framePeriod.v.size(), a.framePeriod);
+
+  char title[96];
+  snprintf(title, sizeof(title), "Bursts (commands less than %" PRIu64 " ms apart)", a.burstGapUs / 1000);
+  header(title, TSV_COLUMNS);
+  columns();
+  distribution("commands per burst", (uint32_t)a.burstSize.v.size(), a.burstSize);
+  distribution("burst length", (uint32_t)a.burstLength.v.size(), a.burstLength);
+  distribution("gap inside a burst", (uint32_t)a.burstInnerGap.v.size(), a.burstInnerGap);
+  distribution("idle between bursts", (uint32_t)a.burstIdle.v.size(), a.burstIdle);
+
+  std::vector<std::pair<uint32_t, std::string>> sigs;
+  for (auto& [sig, n] : a.signatures) sigs.push_back({n, sig});
+  std::sort(sigs.begin(), sigs.end(), [](const auto& x, const auto& y) { return x.first > y.first; });
+  header("Most common bursts", "count\tcommands");
+  for (size_t i = 0; i < sigs.size() && i < 10; i++) {
+    printf(tsv ? "%u\t%s\n" : "  %6u  %s\n", sigs[i].first, sigs[i].second.c_str());
+  }
+  settings(a);
+}
+
+int main(int argc, char** argv) {
+  Analysis a;
+  std::vector<const char*> paths;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--tsv") == 0) {
+      tsv = true;
+    } else if (strcmp(argv[i], "--burst-gap") == 0 && i + 1 < argc) {
+      a.burstGapUs = (uint64_t)strtoul(argv[++i], nullptr, 10) * 1000;
+    } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      fprintf(stderr, "usage: %s [--tsv] [--burst-gap ms] capture.txt ...\n", argv[0]);
+      return 0;
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.empty()) {
+    fprintf(stderr, "no capture files given\n");
+    return 1;
+  }
+  for (const char* path : paths) {
+    if (!analyze(path, a)) return 1;
+  }
+  report(a);
+  return 0;
+}
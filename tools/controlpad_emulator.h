@@ -0,0 +1,270 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "controlpad_ctrl_report.h"
+#include "controlpad_hid.h"
+#include "controlpad_keymap.h"
+#include "controlpad_led.h"
+
+// ===== VIRTUAL CONTROLPAD =====
+// Software model of the pad as seen from the USB host, built from the
+// captures in test/. It takes what the driver would put on the wire and
+// produces what the device would send back:
+//
+//   EP 0x04 OUT  64-byte commands -> mode, brightness and LED state
+//   EP 0x83 IN   an echo of every command (first four bytes, rest zero;
+//                52 28 answers with the effect index in byte 4), plus
+//                42 20 / 43 01 key notifications
+//   EP 0x81 IN   8-byte boot keyboard reports for button presses
+//
+// LED data packets (56 83 00/01) only stage colours; 41 80 makes the staged
+// frame the one on the pad, as the editor's five-command sequence implies.
+// The 43 01 key index is the device's own numbering, which the captures do
+// not map to buttons, so notifications are raised by index, not by button.
+//
+// IN reports wait in small queues until polled; when a queue is full the
+// report is dropped and counted, like a device that nobody is polling.
+
+#define VPAD_EP_KBD_IN    0x81
+#define VPAD_EP_CTRL_IN   0x83
+#define VPAD_EP_CTRL_OUT  0x04
+#define VPAD_QUEUE_LEN    32
+
+// Configuration descriptor the pad returns (bootup_sequencer_control_pad_editor.txt
+// and the other connect captures): interface 0 keyboard on EP 0x81, interface 1
+// EP 0x83 / EP 0x04, interface 2 EP 0x82
+static const uint8_t VPAD_CONFIG_DESCRIPTOR[] = {
+  0x09, 0x02, 0x5b, 0x00, 0x03, 0x01, 0x00, 0xa0, 0x32,
+  0x09, 0x04, 0x00, 0x00, 0x01, 0x03, 0x01, 0x01, 0x00,
+  0x09, 0x21, 0x11, 0x01, 0x00, 0x01, 0x22, 0x40, 0x00,
+  0x07, 0x05, 0x81, 0x03, 0x08, 0x00, 0x01,
+  0x09, 0x04, 0x01, 0x00, 0x02, 0x03, 0x00, 0x00, 0x02,
+  0x09, 0x21, 0x11, 0x01, 0x00, 0x01, 0x22, 0x22, 0x00,
+  0x07, 0x05, 0x83, 0x03, 0x40, 0x00, 0x01,
+  0x07, 0x05, 0x04, 0x03, 0x40, 0x00, 0x01,
+  0x09, 0x04, 0x02, 0x00, 0x01, 0x03, 0x00, 0x00, 0x00,
+  0x09, 0x21, 0x11, 0x01, 0x00, 0x01, 0x22, 0xcb, 0x00,
+  0x07, 0x05, 0x82, 0x03, 0x40, 0x00, 0x01,
+};
+
+#define VPAD_MODE_UNKNOWN 0x00   // Nothing sent since power-up
+#define VPAD_MODE_STATIC  0x01   // 56 81 byte 8, "5681 modes static custom.txt"
+#define VPAD_MODE_CUSTOM  0x02
+
+template <uint8_t LEN>
+struct VpadReportQueue {
+  uint8_t data[VPAD_QUEUE_LEN][LEN];
+  uint8_t head = 0;
+  uint8_t count = 0;
+  uint32_t dropped = 0;
+
+  uint8_t* push() {
+    if (count == VPAD_QUEUE_LEN) {
+      dropped++;
+      return nullptr;
+    }
+    uint8_t* slot = data[(head + count++) % VPAD_QUEUE_LEN];
+    memset(slot, 0, LEN);
+    return slot;
+  }
+
+  bool pop(uint8_t* out) {
+    if (!count) return false;
+    memcpy(out, data[head], LEN);
+    head = (head + 1) % VPAD_QUEUE_LEN;
+    count--;
+    return true;
+  }
+};
+
+class VirtualControlPad {
+public:
+  VirtualControlPad() { reset(); }
+
+  // Power-up state: LEDs dark, no mode selected, nothing queued
+  void reset() {
+    mode = VPAD_MODE_UNKNOWN;
+    effect = 0;
+    staged.clear();
+    shown.clear();
+    memset(held, 0, sizeof(held));
+    modifiers = 0;
+    kbdQueue = VpadReportQueue<HID_REPORT_LEN>();
+    ctrlQueue = VpadReportQueue<CTRL_REPORT_LEN>();
+    commands = commits = finalizes = unknown = 0;
+  }
+
+  // ----- Host to device -----
+
+  // One OUT transfer; false when the device would stall it
+  bool out(uint8_t endpoint, const uint8_t* p, uint16_t len) {
+    if (endpoint != VPAD_EP_CTRL_OUT || len != CTRL_REPORT_LEN) return false;
+    commands++;
+
+    switch (ledCommandOf(p, (uint8_t)len)) {
+      case LED_CMD_MODE:
+        mode = p[8];
+        break;
+      case LED_CMD_PART1:
+      case LED_CMD_PART2:
+        decodeLedData(p, (uint8_t)len, staged);
+        break;
+      case LED_CMD_COMMIT:
+        shown = staged;
+        commits++;
+        break;
+      case LED_CMD_FINALIZE:
+        finalizes++;
+        break;
+      default:
+        if (!knownCommand(p)) unknown++;
+        break;
+    }
+
+    uint8_t* echo = ctrlQueue.push();
+    if (echo) {
+      memcpy(echo, p, 4);
+      if (p[0] == 0x52 && p[1] == 0x28) echo[4] = effect;
+    }
+    return true;
+  }
+
+  // One IN poll; false is a NAK (nothing to send)
+  bool in(uint8_t endpoint, uint8_t* buf) {
+    if (endpoint == VPAD_EP_KBD_IN) return kbdQueue.pop(buf);
+    if (endpoint == VPAD_EP_CTRL_IN) return ctrlQueue.pop(buf);
+    return false;
+  }
+
+  // ----- Physical input -----
+
+  // Button 1-24 down/up on the keyboard interface; a seventh key held at once
+  // gives an ErrorRollOver report like any boot keyboard
+  bool press(uint8_t button) { return setKey(button, true); }
+  bool release(uint8_t button) { return setKey(button, false); }
+
+  // Key notification on EP 0x83, as in effect_modes.txt
+  void notifyKey(uint8_t index, bool down) {
+    if (down) {
+      uint8_t* pre = ctrlQueue.push();
+      if (pre) {
+        pre[0] = CTRL_PRE_NOTIFY_CMD;
+        pre[1] = CTRL_PRE_NOTIFY_SUB;
+        pre[7] = 0x01;
+      }
+    }
+    uint8_t* r = ctrlQueue.push();
+    if (r) {
+      r[0] = CTRL_KEY_NOTIFY_CMD;
+      r[1] = CTRL_KEY_NOTIFY_SUB;
+      r[4] = index;
+      r[5] = CTRL_KEY_FLAG_VALID | (down ? CTRL_KEY_FLAG_DOWN : 0);
+    }
+  }
+
+  void setEffect(uint8_t index) { effect = index; }
+
+  // ----- State -----
+
+  uint8_t currentMode() const { return mode; }
+  const LedFrame& leds() const { return shown; }
+  const LedFrame& stagedLeds() const { return staged; }
+  uint32_t commandCount() const { return commands; }
+  uint32_t commitCount() const { return commits; }
+  uint32_t finalizeCount() const { return finalizes; }
+  uint32_t unknownCount() const { return unknown; }
+  uint32_t droppedReports() const { return kbdQueue.dropped + ctrlQueue.dropped; }
+  bool hasInput() const { return kbdQueue.count || ctrlQueue.count; }   // IN reports not polled yet
+
+  static const char* modeName(uint8_t m) {
+    switch (m) {
+      case VPAD_MODE_STATIC: return "static";
+      case VPAD_MODE_CUSTOM: return "custom";
+      case VPAD_MODE_UNKNOWN: return "none";
+      default: return "other";
+    }
+  }
+
+  // The LEDs as a 5x5 grid of 24-bit ANSI colour blocks, scaled by
+  // brightness; the 25th position has no LED
+  void render(FILE* f) const {
+    fprintf(f, "mode %s, brightness %02X\n", modeName(mode), shown.brightness);
+    for (uint8_t row = 0; row < LED_GRID_COLUMNS; row++) {
+      for (uint8_t col = 0; col < LED_GRID_COLUMNS; col++) {
+        uint8_t button = row * LED_GRID_COLUMNS + col + 1;
+        if (button > LED_COUNT) {
+          fputs("      ", f);
+          continue;
+        }
+        const uint8_t* c = shown.rgb[button - 1];
+        fprintf(f, "\x1b[48;2;%d;%d;%dm %2d \x1b[0m ", c[0] * shown.brightness / 255,
+                c[1] * shown.brightness / 255, c[2] * shown.brightness / 255, button);
+      }
+      fputc('\n', f);
+    }
+  }
+
+private:
+  // Commands from the captures that do not change the modelled state
+  static bool knownCommand(const uint8_t* p) {
+    switch (p[0]) {
+      case 0x41: case 0x42: case 0x43: case 0x51: case 0x52: case 0x55: case 0x56:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  bool setKey(uint8_t button, bool down) {
+    if (button < 1 || button > CONTROLPAD_BUTTON_COUNT) return false;
+    uint8_t usage = DEFAULT_KEYMAP.button_to_usage[button];
+    if (usage >= HID_USAGE_MOD_FIRST) {
+      uint8_t bit = 1u << (usage - HID_USAGE_MOD_FIRST);
+      modifiers = down ? (modifiers | bit) : (modifiers & ~bit);
+    } else {
+      bool found = false;
+      for (uint8_t i = 0; i < CONTROLPAD_BUTTON_COUNT && !found; i++) {
+        if (held[i] == usage) {
+          found = true;
+          if (!down) held[i] = 0;
+        }
+      }
+      for (uint8_t i = 0; i < CONTROLPAD_BUTTON_COUNT && down && !found; i++) {
+        if (!held[i]) {
+          held[i] = usage;
+          found = true;
+        }
+      }
+    }
+    queueKeyboardReport();
+    return true;
+  }
+
+  void queueKeyboardReport() {
+    uint8_t* r = kbdQueue.push();
+    if (!r) return;
+    r[0] = modifiers;
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < CONTROLPAD_BUTTON_COUNT; i++) {
+      if (!held[i]) continue;
+      if (n == HID_REPORT_LEN - 2) {
+        memset(r + 2, HID_USAGE_ROLLOVER, HID_REPORT_LEN - 2);
+        return;
+      }
+      r[2 + n++] = held[i];
+    }
+  }
+
+  uint8_t mode;
+  uint8_t effect;
+  LedFrame staged;          // Colours from the last data packets
+  LedFrame shown;           // Colours as of the last commit
+  uint8_t held[CONTROLPAD_BUTTON_COUNT];   // Usages down, in press order (0 = free)
+  uint8_t modifiers;
+  VpadReportQueue<HID_REPORT_LEN> kbdQueue;
+  VpadReportQueue<CTRL_REPORT_LEN> ctrlQueue;
+  uint32_t commands, commits, finalizes, unknown;
+};
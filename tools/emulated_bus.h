@@ -0,0 +1,181 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <functional>
+
+#include <Arduino.h>
+#include <teensy4_usbhost.h>
+
+#include "controlpad_emulator.h"
+#include "controlpad_mirror.h"
+#include "controlpad_usb_desc.h"
+
+// ===== EMULATED USB BUS =====
+// What the USB host library does for the driver, against a
+// VirtualControlPad, for the tools that build src/main.cpp over the shims in
+// tools/host/ (pad_emulator, soak). One IN transfer per endpoint waits for
+// the pad's next report (NAKs retry each frame), OUT transfers go to the pad
+// in submission order, one per frame, and every completion calls the
+// driver's callback from the simulated clock. Install runUntil() as
+// hostTimeHook.
+//
+// Frames in which nothing can happen - no OUT queued and no IN report
+// waiting on the pad - are skipped rather than stepped, so hours of idle
+// simulated time cost nothing. Input the tool gives the pad goes out from
+// the next frame on.
+
+#define EMU_FRAME_US      1000     // USB full-speed frame; every endpoint has bInterval 1
+#define EMU_OUT_QUEUE     16       // Transfers the host controller takes ahead
+#define EMU_STALL         -2       // Completion status of a refused OUT, see usbErrorName()
+
+class EmulatedBus : public HostUsbBus {
+public:
+  explicit EmulatedBus(VirtualControlPad& pad) : pad(pad) {}
+
+  int interruptMessage(USB_Driver*, uint8_t ep, uint16_t len, void* data, const USBCallback* cb) override {
+    if (ep & 0x80) {
+      InTransfer* t = inTransfer(ep);
+      if (!t || t->cb) return -1;   // Already one in flight
+      *t = {(uint8_t*)data, len, cb};
+      return 0;
+    }
+    bool accepted = outCount < EMU_OUT_QUEUE && len <= CTRL_REPORT_LEN && !(refuseOut && refuseOut(ep));
+    if (onOutSubmit) onOutSubmit((const uint8_t*)data, len, accepted);
+    if (!accepted) return -1;
+    OutTransfer& t = outQueue[(outHead + outCount++) % EMU_OUT_QUEUE];
+    t.ep = ep;
+    t.len = len;
+    t.cb = cb;
+    memset(t.data, 0, sizeof(t.data));
+    memcpy(t.data, data, len);
+    submitted++;
+    if (record) {
+      MirrorRecord r = {micros(), 0, (uint8_t)len, {}};
+      memcpy(r.data, t.data, len);
+      char line[MIRROR_LINE_MAX];
+      mirrorFormatLine(line, sizeof(line), r);
+      fputs(line, record);
+    }
+    return 0;
+  }
+
+  // hostTimeHook: run every frame that starts before until_us
+  void runUntil(uint64_t until_us) {
+    // The tool may have set the clock itself, e.g. to start near a wrap
+    if (nextFrameUs < hostNowUs) nextFrameUs = (hostNowUs + EMU_FRAME_US - 1) / EMU_FRAME_US * EMU_FRAME_US;
+    while (nextFrameUs < until_us) {
+      if (!busy()) {
+        nextFrameUs += (until_us - nextFrameUs + EMU_FRAME_US - 1) / EMU_FRAME_US * EMU_FRAME_US;
+        return;
+      }
+      hostNowUs = nextFrameUs;
+      nextFrameUs += EMU_FRAME_US;
+      frame();
+    }
+  }
+
+  bool busy() const { return outCount || pad.hasInput(); }
+  uint64_t nextFrame() const { return nextFrameUs; }
+
+  // First three bytes of each command the pad accepted, for echo matching
+  bool popSent(uint8_t cmd[3]) {
+    if (!sentCount) return false;
+    memcpy(cmd, sent[sentHead], 3);
+    sentHead = (sentHead + 1) % SENT_MAX;
+    sentCount--;
+    return true;
+  }
+
+  FILE* record = nullptr;   // Mirror lines of everything submitted
+  uint32_t submitted = 0, stalled = 0, lostTrack = 0;
+
+  // For tools that keep their own books; all optional
+  std::function<bool(uint8_t ep)> refuseOut;   // true turns an OUT submission away
+  std::function<void(const uint8_t* data, uint16_t len, bool accepted)> onOutSubmit;
+  std::function<void(const uint8_t* data, uint16_t len, int status)> onOutDone;   // After the driver's callback
+  std::function<void(uint8_t ep, const uint8_t* report, uint16_t len)> onIn;       // Before the driver's callback
+
+private:
+  struct InTransfer {
+    uint8_t* data;
+    uint16_t len;
+    const USBCallback* cb;   // Null when nothing is in flight
+  };
+
+  struct OutTransfer {
+    uint8_t ep;
+    uint16_t len;
+    const USBCallback* cb;
+    uint8_t data[CTRL_REPORT_LEN];
+  };
+
+  static const uint8_t SENT_MAX = 64;
+
+  InTransfer* inTransfer(uint8_t ep) {
+    if (ep == VPAD_EP_KBD_IN) return &kbdIn;
+    if (ep == VPAD_EP_CTRL_IN) return &ctrlIn;
+    return nullptr;
+  }
+
+  void frame() {
+    if (outCount) {
+      OutTransfer t = outQueue[outHead];
+      outHead = (outHead + 1) % EMU_OUT_QUEUE;
+      outCount--;
+      bool accepted = pad.out(t.ep, t.data, t.len);
+      if (accepted) {
+        if (sentCount < SENT_MAX) {
+          memcpy(sent[(sentHead + sentCount++) % SENT_MAX], t.data, 3);
+        } else {
+          lostTrack++;
+        }
+      } else {
+        stalled++;
+      }
+      int status = accepted ? t.len : EMU_STALL;
+      if (t.cb) (*t.cb)(status);
+      if (onOutDone) onOutDone(t.data, t.len, status);
+    }
+    poll(VPAD_EP_KBD_IN, kbdIn);
+    poll(VPAD_EP_CTRL_IN, ctrlIn);
+  }
+
+  void poll(uint8_t ep, InTransfer& t) {
+    if (!t.cb) return;
+    uint8_t report[CTRL_REPORT_LEN];
+    if (!pad.in(ep, report)) return;   // NAK
+    uint16_t len = ep == VPAD_EP_KBD_IN ? HID_REPORT_LEN : CTRL_REPORT_LEN;
+    if (len > t.len) len = t.len;
+    memcpy(t.data, report, len);
+    if (onIn) onIn(ep, report, len);
+    const USBCallback* cb = t.cb;
+    t.cb = nullptr;   // The callback resubmits
+    (*cb)(len);
+  }
+
+  VirtualControlPad& pad;
+  InTransfer kbdIn = {};
+  InTransfer ctrlIn = {};
+  OutTransfer outQueue[EMU_OUT_QUEUE];
+  uint8_t outHead = 0;
+  uint8_t outCount = 0;
+  uint8_t sent[SENT_MAX][3];   // Accepted, not echoed yet, oldest first
+  uint8_t sentHead = 0;
+  uint8_t sentCount = 0;
+  uint64_t nextFrameUs = 0;
+};
+
+// What the USB host library does on connect: offer every interface of the
+// pad's configuration to the driver class
+template <class Driver>
+void attachEmulatedPad() {
+  const uint8_t* cfg = VPAD_CONFIG_DESCRIPTOR;
+  size_t len = sizeof(VPAD_CONFIG_DESCRIPTOR);
+  for (size_t at = cfg[0]; at + 2 <= len && cfg[at] >= 2; at += cfg[at]) {
+    if (cfg[at + 1] != USB_DESC_TYPE_INTERFACE) continue;
+    const usb_interface_descriptor* iface = (const usb_interface_descriptor*)(cfg + at);
+    if (Driver::offer_interface(iface, len - at)) Driver::attach_interface(iface, len - at, nullptr);
+  }
+}
@@ -0,0 +1,47 @@
+// libFuzzer target for the interface 1 report decoder
+// (include/controlpad_ctrl_report.h) as ctrl_poll() drives it. The input is a
+// run of reports, each a length byte (capped at 64 like ctrl_poll) followed by
+// that many report bytes, so key state carries across reports.
+//
+//   clang++ -std=c++17 -O1 -g -fsanitize=fuzzer,address,undefined -Iinclude tools/fuzz_ctrl_report.cpp -o fuzz_ctrl_report
+//   ./fuzz_ctrl_report fuzz/ctrl                  # seeds from tools/fuzz_seeds.cpp
+//
+// After every report: the returned bitmap is the decoder's, only key reports
+// change it, and a key report flips at most its own bit.
+
+#include <cstdlib>
+
+#include "controlpad_ctrl_report.h"
+#include "fuzz_main.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  CtrlReportDecoder decoder;
+  size_t at = 0;
+  while (at < size) {
+    uint8_t len = data[at++];
+    if (len > CTRL_REPORT_LEN) len = CTRL_REPORT_LEN;
+    if (len > size - at) len = (uint8_t)(size - at);
+    const uint8_t* report = data + at;
+    at += len;
+
+    uint32_t before = decoder.pressedKeys();
+    CtrlReport r = decoder.decode(report, len);
+    if (r.pressed != decoder.pressedKeys()) abort();
+    if (r.changed != (before ^ r.pressed)) abort();
+
+    switch (r.kind) {
+      case CTRL_REPORT_EMPTY:
+        if (len >= 6 && report[0] != 0x00) abort();
+        break;
+      case CTRL_REPORT_KEY:
+        if (r.key >= CTRL_KEY_MAX || (r.changed & ~(1u << r.key))) abort();
+        if (((r.pressed >> r.key) & 1) != r.down) abort();
+        break;
+      default:
+        if (r.changed) abort();
+        break;
+    }
+    if (r.kind != CTRL_REPORT_EMPTY && (r.cmd != report[0] || r.sub != report[1] || r.index != report[2])) abort();
+  }
+  return 0;
+}
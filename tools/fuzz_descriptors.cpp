@@ -0,0 +1,39 @@
+// libFuzzer target for the descriptor walk in offer_interface() and
+// findEndpoints() (include/controlpad_usb_desc.h). The input is the byte
+// buffer teensy4_usbhost hands the driver: an interface descriptor followed by
+// whatever the device put after it.
+//
+//   clang++ -std=c++17 -O1 -g -fsanitize=fuzzer,address,undefined -Iinclude tools/fuzz_descriptors.cpp -o fuzz_descriptors
+//   ./fuzz_descriptors fuzz/desc                  # seeds from tools/fuzz_seeds.cpp
+//
+// Beyond not reading out of bounds, every endpoint must come from a
+// descriptor inside the buffer, so there can be no more of them than
+// size / 7, and the walk must end.
+
+#include <cstdlib>
+
+#include "controlpad_usb_desc.h"
+#include "fuzz_main.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  UsbDescriptorWalker walker(data, size);
+  UsbEndpointInfo ep;
+  size_t endpoints = 0;
+  uint8_t in = 0, out = 0;
+  while (walker.nextEndpoint(ep)) {
+    if (++endpoints > size / USB_DESC_ENDPOINT_LEN) abort();
+    // What findEndpoints() keeps
+    if (ep.isInterrupt()) {
+      if (ep.isIn()) {
+        in = ep.address;
+      } else {
+        out = ep.address;
+      }
+    }
+  }
+  if ((in && !(in & USB_EP_DIR_IN)) || (out & USB_EP_DIR_IN)) abort();
+
+  // A malformed walk must stay finished
+  if (walker.malformed() && (walker.next() || walker.nextEndpoint(ep))) abort();
+  return 0;
+}
@@ -0,0 +1,51 @@
+// libFuzzer target for the keyboard report decoder (include/controlpad_hid.h)
+// as kbd_poll() drives it. The input is a run of reports, each a length byte
+// (taken mod 9, since kbd_poll passes min(result, 8)) followed by that many
+// report bytes, so one input exercises the decoder's state across reports.
+//
+//   clang++ -std=c++17 -O1 -g -fsanitize=fuzzer,address,undefined -Iinclude tools/fuzz_hid_report.cpp -o fuzz_hid_report
+//   ./fuzz_hid_report fuzz/hid                    # seeds from tools/fuzz_seeds.cpp
+//
+// After every report: no more than HID_MAX_KEY_EVENTS events, each one a
+// real edge, and the decoder's key state equal to the report's.
+
+#include <cstdlib>
+
+#include "controlpad_hid.h"
+#include "fuzz_main.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  HidReportDecoder decoder;
+  HidKeyEvent events[HID_MAX_KEY_EVENTS];
+  bool before[256];
+  size_t at = 0;
+  while (at < size) {
+    uint8_t len = data[at++] % (HID_REPORT_LEN + 1);
+    if (len > size - at) len = (uint8_t)(size - at);
+    const uint8_t* report = data + at;
+    at += len;
+
+    for (int u = 0; u < 256; u++) before[u] = decoder.isDown((uint8_t)u);
+    uint8_t count = decoder.decode(report, len, (uint32_t)at, events);
+    if (count > HID_MAX_KEY_EVENTS) abort();
+
+    for (uint8_t i = 0; i < count; i++) {
+      const HidKeyEvent& e = events[i];
+      if (before[e.usage] == e.pressed || decoder.isDown(e.usage) != e.pressed) abort();
+      if (i && events[i - 1].usage >= e.usage) abort();  // Ascending, no duplicates
+    }
+
+    bool ignored = len < HID_REPORT_LEN || HidReportDecoder::isErrorUsage(report[2]);
+    if (ignored) {
+      if (count) abort();
+      continue;
+    }
+    bool down[256] = {false};
+    for (uint8_t m = 0; m < 8; m++) down[HID_USAGE_MOD_FIRST + m] = report[0] & (1u << m);
+    for (uint8_t k = 2; k < HID_REPORT_LEN; k++) down[report[k]] |= report[k] > HID_USAGE_ERROR_LAST;
+    for (int u = 0; u < 256; u++) {
+      if (decoder.isDown((uint8_t)u) != down[u]) abort();
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,126 @@
+// Stand-in for libFuzzer's main() so the fuzz targets also build with g++,
+// which has no -fsanitize=fuzzer. Included by every fuzz target; it only adds
+// a main() when FUZZ_STANDALONE is defined:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined -DFUZZ_STANDALONE -Iinclude tools/fuzz_hid_report.cpp -o fuzz_hid_report
+//   ./fuzz_hid_report fuzz/hid                    # replay a corpus directory
+//   ./fuzz_hid_report -runs=1000000 fuzz/hid      # plus random mutations of it
+//
+// Replaying runs every file once. -runs=N then feeds N inputs made by
+// flipping, inserting and deleting bytes of corpus files, seeded by -seed=N;
+// nowhere near as good as libFuzzer's coverage guidance, but enough to
+// smoke-test a target under the sanitizers.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+#ifdef FUZZ_STANDALONE
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+static bool fuzzReadFile(const std::string& path, std::vector<uint8_t>& out) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  uint8_t buf[4096];
+  size_t n;
+  out.clear();
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+static void fuzzCollect(const std::string& path, std::vector<std::vector<uint8_t>>& corpus) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    perror(path.c_str());
+    exit(1);
+  }
+  if (!S_ISDIR(st.st_mode)) {
+    corpus.emplace_back();
+    if (!fuzzReadFile(path, corpus.back())) corpus.pop_back();
+    return;
+  }
+  DIR* dir = opendir(path.c_str());
+  while (dirent* e = dir ? readdir(dir) : nullptr) {
+    if (e->d_name[0] != '.') fuzzCollect(path + "/" + e->d_name, corpus);
+  }
+  if (dir) closedir(dir);
+}
+
+static void fuzzMutate(std::vector<uint8_t>& d, std::mt19937& rng) {
+  static const uint8_t interesting[] = {0x00, 0x01, 0x02, 0x07, 0x09, 0x40, 0x7F, 0x80, 0xC0, 0xFF};
+  uint32_t edits = 1 + rng() % 8;
+  for (uint32_t i = 0; i < edits; i++) {
+    size_t at = d.empty() ? 0 : rng() % d.size();
+    switch (rng() % 5) {
+      case 0: if (!d.empty()) d[at] ^= (uint8_t)(1u << (rng() % 8)); break;
+      case 1: if (!d.empty()) d[at] = (uint8_t)rng(); break;
+      case 2: if (!d.empty()) d[at] = interesting[rng() % sizeof(interesting)]; break;
+      case 3: d.insert(d.begin() + at, (uint8_t)rng()); break;
+      case 4: if (!d.empty()) d.erase(d.begin() + at); break;
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  unsigned long runs = 0;
+  unsigned long seed = 1;
+  std::vector<std::vector<uint8_t>> corpus;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "-runs=", 6) == 0) {
+      runs = strtoul(argv[i] + 6, nullptr, 10);
+    } else if (strncmp(argv[i], "-seed=", 6) == 0) {
+      seed = strtoul(argv[i] + 6, nullptr, 10);
+    } else if (argv[i][0] == '-') {
+      fprintf(stderr, "usage: %s [-runs=N] [-seed=N] corpus_dir_or_file ...\n", argv[0]);
+      return strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "-help=1") == 0 ? 0 : 1;
+    } else {
+      fuzzCollect(argv[i], corpus);
+    }
+  }
+
+  // Copy every input into a buffer of exactly its size, as libFuzzer does,
+  // so ASan catches a read one past the end; the empty input has no buffer
+  auto run = [](const std::vector<uint8_t>& d) {
+    uint8_t* copy = nullptr;
+    if (!d.empty()) {
+      copy = (uint8_t*)malloc(d.size());
+      memcpy(copy, d.data(), d.size());
+    }
+    LLVMFuzzerTestOneInput(copy, d.size());
+    free(copy);
+  };
+
+  run({});
+  for (const auto& d : corpus) run(d);
+  printf("replayed %zu input(s)\n", corpus.size());
+
+  std::mt19937 rng((uint32_t)seed);
+  std::vector<uint8_t> d;
+  for (unsigned long i = 0; i < runs; i++) {
+    if (corpus.empty() || rng() % 16 == 0) {
+      d.assign(rng() % 128, 0);
+      for (uint8_t& b : d) b = (uint8_t)rng();
+    } else {
+      d = corpus[rng() % corpus.size()];
+    }
+    fuzzMutate(d, rng);
+    run(d);
+  }
+  if (runs) printf("ran %lu mutated input(s), seed %lu\n", runs, seed);
+  return 0;
+}
+
+#endif  // FUZZ_STANDALONE
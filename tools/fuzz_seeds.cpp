@@ -0,0 +1,137 @@
+// Writes seed corpora for the fuzz targets from the captures in test/, in the
+// input format each target expects:
+//
+//   g++ -std=c++17 -O2 -Iinclude tools/fuzz_seeds.cpp -o fuzz_seeds
+//   ./fuzz_seeds fuzz test/*.txt
+//
+//   fuzz/desc   every interface of every configuration descriptor the pad
+//               returned, from the interface descriptor to the end of the
+//               configuration (fuzz_descriptors)
+//   fuzz/hid    the EP 0x81 keyboard reports of each capture, plus a press
+//               and release of every button in the default keymap
+//               (fuzz_hid_report)
+//   fuzz/ctrl   the EP 0x83 reports of each capture, 32 to a file
+//               (fuzz_ctrl_report)
+//
+// Identical seeds are written once. The output directories are created if
+// needed; existing files in them are overwritten, others left alone.
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "capture_reader.h"
+#include "controlpad_ctrl_report.h"
+#include "controlpad_hid.h"
+#include "controlpad_keymap.h"
+#include "controlpad_usb_desc.h"
+
+#define SEED_CTRL_REPORTS 32
+#define USB_DESC_TYPE_CONFIGURATION 0x02
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Corpus {
+  std::string dir;
+  std::set<Bytes> seeds;
+
+  explicit Corpus(const std::string& path) : dir(path) {}
+
+  void add(const Bytes& b) {
+    if (!b.empty()) seeds.insert(b);
+  }
+
+  bool write() const {
+    mkdir(dir.c_str(), 0755);
+    int n = 0;
+    for (const Bytes& b : seeds) {
+      char name[32];
+      snprintf(name, sizeof(name), "/seed_%03d", n++);
+      std::string path = dir + name;
+      FILE* f = fopen(path.c_str(), "wb");
+      if (!f || fwrite(b.data(), 1, b.size(), f) != b.size()) {
+        perror(path.c_str());
+        if (f) fclose(f);
+        return false;
+      }
+      fclose(f);
+    }
+    printf("%s: %d seed(s)\n", dir.c_str(), n);
+    return true;
+  }
+};
+
+// Length-prefixed report, the framing of fuzz_hid_report and fuzz_ctrl_report
+static void appendReport(Bytes& out, const uint8_t* p, uint8_t len) {
+  out.push_back(len);
+  out.insert(out.end(), p, p + len);
+}
+
+// One seed per interface: from its descriptor to the end of the configuration
+static void addConfiguration(Corpus& desc, const uint8_t* p, size_t len) {
+  size_t at = 0;
+  while (at + USB_DESC_HEADER_LEN <= len && p[at] >= USB_DESC_HEADER_LEN) {
+    if (p[at + 1] == USB_DESC_TYPE_INTERFACE) desc.add(Bytes(p + at, p + len));
+    at += p[at];
+  }
+}
+
+static bool readCapture(const char* path, Corpus& desc, Corpus& hid, Corpus& ctrl) {
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  CaptureReader reader(f);
+  CaptureRecord r;
+  Bytes keys, reports;
+  int count = 0;
+  while (reader.next(r)) {
+    if (!r.in || r.length == 0) continue;
+    if (r.transfer == CAPTURE_CONTROL && r.length > 1 && r.payload[1] == USB_DESC_TYPE_CONFIGURATION) {
+      addConfiguration(desc, r.payload, r.length);
+    } else if (r.endpoint == 0x81) {
+      appendReport(keys, r.payload, (uint8_t)(r.length < HID_REPORT_LEN ? r.length : HID_REPORT_LEN));
+    } else if (r.endpoint == 0x83) {
+      appendReport(reports, r.payload, (uint8_t)(r.length < CTRL_REPORT_LEN ? r.length : CTRL_REPORT_LEN));
+      if (++count % SEED_CTRL_REPORTS == 0) {
+        ctrl.add(reports);
+        reports.clear();
+      }
+    }
+  }
+  hid.add(keys);
+  ctrl.add(reports);
+  fclose(f);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s outdir capture.txt ...\n", argv[0]);
+    return 1;
+  }
+  std::string out = argv[1];
+  mkdir(out.c_str(), 0755);
+  Corpus desc(out + "/desc"), hid(out + "/hid"), ctrl(out + "/ctrl");
+
+  for (int i = 2; i < argc; i++) {
+    if (!readCapture(argv[i], desc, hid, ctrl)) return 1;
+  }
+
+  // The captures hold hardly any keyboard reports: add every button
+  Bytes buttons;
+  for (int b = 1; b <= CONTROLPAD_BUTTON_COUNT; b++) {
+    uint8_t report[HID_REPORT_LEN] = {0, 0, DEFAULT_KEYMAP.button_to_usage[b]};
+    appendReport(buttons, report, HID_REPORT_LEN);
+    report[2] = 0;
+    appendReport(buttons, report, HID_REPORT_LEN);
+  }
+  hid.add(buttons);
+
+  return desc.write() && hid.write() && ctrl.write() ? 0 : 1;
+}
@@ -0,0 +1,233 @@
+// Checks the LED encoder/decoder (include/controlpad_led.h) against the
+// official editor captures in test/. Every LED packet the editor sent is
+// decoded and re-encoded and must come back byte for byte; decoded frames
+// must show the colours the capture was recorded for.
+//
+//   g++ -std=c++17 -O2 -Iinclude tools/golden_check.cpp -o golden_check
+//   ./golden_check               # from the repo root; uses test/*.txt
+//   ./golden_check -v            # also print every decoded frame
+//
+// Exit status is 0 when every check passes.
+//
+// Captures are read with tools/capture_reader.h, so the Wireshark dumps and
+// the hand-annotated notes both work.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "capture_reader.h"
+#include "controlpad_ctrl_report.h"
+#include "controlpad_led.h"
+
+struct Packet {
+  bool in;            // Device to host
+  uint8_t endpoint;
+  int line;           // Where it starts in the file
+  std::vector<uint8_t> data;
+};
+
+// Interface 1 traffic with a payload: OUT commands and their IN echoes
+static bool readCapture(const char* path, std::vector<Packet>& out) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+
+  CaptureReader reader(f);
+  CaptureRecord r;
+  while (reader.next(r)) {
+    if (r.length == 0 || r.interface_num != 1) continue;
+    Packet p;
+    p.in = r.in;
+    p.endpoint = r.endpoint;
+    p.line = r.line;
+    p.data.assign(r.payload, r.payload + r.length);
+    out.push_back(p);
+  }
+  fclose(f);
+  return true;
+}
+
+// ----- Checks -----
+
+static int failures = 0;
+static bool verbose = false;
+
+#define CHECK(cond, ...) \
+  do { \
+    if (!(cond)) { \
+      failures++; \
+      printf("  FAIL: "); \
+      printf(__VA_ARGS__); \
+      printf("\n"); \
+    } \
+  } while (0)
+
+static void printFrame(const LedFrame& f) {
+  printf("    brightness %02X:", f.brightness);
+  for (int b = 1; b <= LED_COUNT; b++) {
+    printf(" %d=%02x%02x%02x", b, f.rgb[b - 1][0], f.rgb[b - 1][1], f.rgb[b - 1][2]);
+  }
+  printf("\n");
+}
+
+static std::string hex(const uint8_t* p, size_t n) {
+  std::string s;
+  char b[4];
+  for (size_t i = 0; i < n; i++) {
+    snprintf(b, sizeof(b), "%02x", p[i]);
+    s += b;
+  }
+  return s;
+}
+
+// An echo with the "response" label missing: the device answers a command
+// with its first bytes and zeros, while a real part 1 always carries 01 at [4]
+static bool looksLikeEcho(const Packet& p) {
+  if (ledCommandOf(p.data.data(), (uint8_t)p.data.size()) != LED_CMD_PART1) return false;
+  for (size_t i = 3; i < p.data.size(); i++) {
+    if (p.data[i]) return false;
+  }
+  return true;
+}
+
+struct FileResult {
+  std::vector<LedFrame> frames;   // One per part 2, decoded on top of the previous state
+  int packets = 0;                // LED packets re-encoded
+  int echoes = 0;                 // Device echoes matched to their command
+};
+
+static FileResult checkPackets(const std::vector<Packet>& packets) {
+  FileResult r;
+  LedFrame state;
+  bool havePart1 = false;
+  const Packet* lastOut = nullptr;
+
+  for (const Packet& p : packets) {
+    uint8_t len = (uint8_t)p.data.size();
+    const uint8_t* d = p.data.data();
+
+    if (p.in) {
+      // USBPcap captures also hold the echo of every interface 1 command
+      if (p.endpoint == 0x83 && lastOut && len == LED_PACKET_LEN) {
+        CHECK(CtrlReportDecoder::isEchoOf(d, lastOut->data.data()),
+              "line %d: response %02x %02x %02x does not echo line %d", p.line, d[0], d[1], d[2], lastOut->line);
+        r.echoes++;
+        lastOut = nullptr;
+      }
+      continue;
+    }
+    if (p.endpoint != 0x04) continue;
+    if (len != LED_PACKET_LEN || looksLikeEcho(p)) continue;
+    lastOut = &p;
+
+    uint8_t expect[LED_PACKET_LEN];
+    LedCommand cmd = ledCommandOf(d, len);
+    switch (cmd) {
+      case LED_CMD_MODE:     encodeLedMode(expect); break;
+      case LED_CMD_COMMIT:   encodeLedCommit(expect); break;
+      case LED_CMD_FINALIZE: encodeLedFinalize(expect); break;
+      case LED_CMD_PART1:
+      case LED_CMD_PART2: {
+        LedFrame decoded = state;
+        decodeLedData(d, len, decoded);
+        encodeLedData(decoded, cmd == LED_CMD_PART1 ? 0 : 1, expect);
+        state = decoded;
+        if (cmd == LED_CMD_PART1) {
+          havePart1 = true;
+        } else if (havePart1) {
+          r.frames.push_back(state);
+          if (verbose) printFrame(state);
+        }
+        break;
+      }
+      default:
+        continue;
+    }
+    r.packets++;
+    CHECK(memcmp(expect, d, LED_PACKET_LEN) == 0, "line %d: %s re-encodes differently\n    capture %s\n    encoder %s",
+          p.line, ledCommandName(cmd), hex(d, LED_PACKET_LEN).c_str(), hex(expect, LED_PACKET_LEN).c_str());
+  }
+  return r;
+}
+
+static LedFrame frameWith(uint8_t r, uint8_t g, uint8_t b, int firstButtons, uint8_t brightness = 0xFF) {
+  LedFrame f;
+  for (int i = 1; i <= firstButtons; i++) f.set((uint8_t)i, r, g, b);
+  f.brightness = brightness;
+  return f;
+}
+
+static bool contains(const std::vector<LedFrame>& frames, const LedFrame& want) {
+  for (const LedFrame& f : frames) {
+    if (f == want) return true;
+  }
+  return false;
+}
+
+// Editor purple, as sent for "turn button 1-6 on purple"
+#define PURPLE 0xd7, 0x52, 0xff
+
+static void checkExpectations(const std::string& name, const FileResult& r) {
+  if (name == "all red.txt") {
+    CHECK(!r.frames.empty(), "no frames");
+    for (const LedFrame& f : r.frames) CHECK(f == frameWith(0xff, 0, 0, LED_COUNT), "frame is not all red");
+  } else if (name == "\xc3\xa0ll blue.txt") {
+    CHECK(!r.frames.empty(), "no frames");
+    for (const LedFrame& f : r.frames) CHECK(f == frameWith(0, 0, 0xff, LED_COUNT), "frame is not all blue");
+  } else if (name == "turn button 1-6 on purple.txt") {
+    // One frame per click: nothing lit, then buttons 1..k purple
+    CHECK(r.frames.size() == 7, "expected 7 frames, got %zu", r.frames.size());
+    for (size_t k = 0; k < r.frames.size(); k++) {
+      CHECK(r.frames[k] == frameWith(PURPLE, (int)k), "frame %zu should light buttons 1-%zu", k, k);
+    }
+  } else if (name == "setting a custom value.txt") {
+    CHECK(contains(r.frames, frameWith(PURPLE, 6)), "no frame with buttons 1-6 purple");
+    CHECK(!r.frames.empty() && r.frames.back() == frameWith(PURPLE, 6, 0x22),
+          "last frame should be buttons 1-6 purple at brightness 0x22");
+  }
+}
+
+static const char* DEFAULT_CAPTURES[] = {
+  "test/all red.txt",
+  "test/\xc3\xa0ll blue.txt",
+  "test/turn button 1-6 on purple.txt",
+  "test/setting a custom value.txt",
+};
+
+int main(int argc, char** argv) {
+  std::vector<const char*> paths;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-v") == 0) {
+      verbose = true;
+    } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      fprintf(stderr, "usage: %s [-v] [capture.txt ...]\n", argv[0]);
+      return 0;
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.empty()) paths.assign(std::begin(DEFAULT_CAPTURES), std::end(DEFAULT_CAPTURES));
+
+  for (const char* path : paths) {
+    std::vector<Packet> packets;
+    if (!readCapture(path, packets)) {
+      perror(path);
+      failures++;
+      continue;
+    }
+    std::string name = path;
+    size_t slash = name.find_last_of('/');
+    if (slash != std::string::npos) name = name.substr(slash + 1);
+
+    printf("%s\n", path);
+    int before = failures;
+    FileResult r = checkPackets(packets);
+    checkExpectations(name, r);
+    printf("  %s: %d LED packets re-encoded, %zu frames, %d echoes\n", failures == before ? "ok" : "FAILED",
+           r.packets, r.frames.size(), r.echoes);
+  }
+
+  printf("%s (%d failure%s)\n", failures ? "FAIL" : "PASS", failures, failures == 1 ? "" : "s");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+// ===== HOST ARDUINO SHIM =====
+// The part of the Teensy 4 Arduino core that src/main.cpp calls, for
+// building the firmware into a host tool (tools/pad_emulator.cpp, tools/soak.cpp):
+//
+//   g++ -std=c++17 -O2 -Iinclude -Itools/host tools/pad_emulator.cpp
+//
+// Time is simulated. micros(), millis() and ARM_DWT_CYCCNT are cut from one
+// 64-bit microsecond count that only moves in delay() / delayMicroseconds()
+// or when the tool calls hostAdvance(); code in between takes no time. While
+// time moves, hostTimeHook delivers whatever falls due - USB completions from
+// tools/host/teensy4_usbhost.h - the way interrupts land inside a delay() on
+// the Teensy.
+//
+// Serial writes go to Serial.out (nothing when null) and reads come from
+// text queued with Serial.feed(). The shim is header-only and defines the
+// linker-script symbols main.cpp reads, so exactly one translation unit may
+// include it.
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+#define DMAMEM
+#define FASTRUN
+#define FLASHMEM
+#define PROGMEM
+#define F(x) x
+
+using std::max;
+using std::min;
+
+#define constrain(x, lo, hi) ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
+
+// ----- Time -----
+
+inline uint64_t hostNowUs = 0;                             // Simulated time
+inline void (*hostTimeHook)(uint64_t until_us) = nullptr;  // Runs what falls due up to until_us
+
+// Let time pass; the hook may step hostNowUs forward on the way
+inline void hostAdvance(uint64_t us) {
+  uint64_t until = hostNowUs + us;
+  if (hostTimeHook) hostTimeHook(until);
+  hostNowUs = until;
+}
+
+inline uint32_t micros() { return (uint32_t)hostNowUs; }
+inline uint32_t millis() { return (uint32_t)(hostNowUs / 1000); }
+inline void delay(uint32_t ms) { hostAdvance((uint64_t)ms * 1000); }
+inline void delayMicroseconds(uint32_t us) { hostAdvance(us); }
+inline void yield() {}
+
+#define F_CPU 600000000
+inline uint32_t F_CPU_ACTUAL = F_CPU;
+#define ARM_DWT_CYCCNT ((uint32_t)(hostNowUs * (F_CPU_ACTUAL / 1000000)))
+
+inline void arm_dcache_flush(void*, uint32_t) {}
+
+// ----- Serial -----
+
+class HostSerial {
+public:
+  FILE* out = nullptr;   // Where the firmware's output goes; null drops it
+
+  void begin(unsigned long) {}
+  explicit operator bool() const { return true; }   // USB serial is always "connected"
+
+  // Queue text for the firmware to read
+  void feed(const char* text) { input += text; }
+  int available() const { return (int)(input.size() - pos); }
+  int read() {
+    if (pos >= input.size()) return -1;
+    int c = (uint8_t)input[pos++];
+    if (pos == input.size()) {
+      input.clear();
+      pos = 0;
+    }
+    return c;
+  }
+
+  // No format attribute: the firmware's format strings are written for a
+  // 32-bit size_t, which the host does not have
+  int printf(const char* fmt, ...) {
+    if (!out) return 0;
+    va_list args;
+    va_start(args, fmt);
+    int n = vfprintf(out, fmt, args);
+    va_end(args);
+    return n;
+  }
+
+  size_t print(const char* s) {
+    if (!out) return 0;
+    fputs(s, out);
+    return strlen(s);
+  }
+  size_t print(char c) {
+    if (!out) return 0;
+    fputc(c, out);
+    return 1;
+  }
+  size_t print(long v) { return (size_t)printf("%ld", v); }
+  size_t print(unsigned long v) { return (size_t)printf("%lu", v); }
+  size_t print(int v) { return print((long)v); }
+  size_t print(unsigned v) { return print((unsigned long)v); }
+  template <typename T>
+  size_t println(T v) {
+    size_t n = print(v);
+    return n + println();
+  }
+  size_t println() { return print("\n"); }
+  size_t write(uint8_t c) { return print((char)c); }
+  void flush() {
+    if (out) fflush(out);
+  }
+
+private:
+  std::string input;
+  size_t pos = 0;
+};
+
+inline HostSerial Serial;
+
+// ----- Linker-script symbols -----
+// main.cpp's memory report reads section boundaries from the Teensy linker
+// script. The stack pair brackets a real buffer, since paintStacks() writes
+// the pattern into everything between them; the rest only need an address,
+// so the "mem" command's figures mean nothing on the host. _etext and _edata
+// are left to the host linker, which defines them itself.
+
+extern "C" {
+__attribute__((used)) unsigned char hostStackRegion[4096];
+unsigned long _stext, _sdata, _sbss;
+unsigned long _heap_start, _heap_end, _itcm_block_count;
+char* __brkval = nullptr;
+}
+
+__asm__(".globl _ebss\n\t.set _ebss, hostStackRegion\n\t"
+        ".globl _estack\n\t.set _estack, hostStackRegion + 4096");
@@ -0,0 +1,11 @@
+#pragma once
+
+// ===== HOST MALLOC.H SHIM =====
+// newlib's mallinfo(), which main.cpp's memory report calls. The host heap is
+// not the firmware's, so every figure reads 0.
+
+struct mallinfo {
+  int arena, ordblks, smblks, hblks, hblkhd, usmblks, fsmblks, uordblks, fordblks, keepcost;
+};
+
+inline struct mallinfo mallinfo() { return {}; }
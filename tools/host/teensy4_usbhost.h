@@ -0,0 +1,62 @@
+#pragma once
+
+// ===== HOST USB HOST SHIM =====
+// The part of the teensy4_usbhost library USBControlPad uses. Interrupt
+// transfers go to whatever HostUsbBus the tool installs in hostUsbBus, which
+// completes them by calling the driver's USBCallback from the simulated
+// clock (hostTimeHook in tools/host/Arduino.h), as the library does from its
+// interrupt. Enumeration is left to the tool: it offers each interface of a
+// configuration descriptor to the driver class's offer_interface() /
+// attach_interface(), which is what the library's factory glue does.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+
+struct usb_interface_descriptor {
+  uint8_t bLength;
+  uint8_t bDescriptorType;
+  uint8_t bInterfaceNumber;
+  uint8_t bAlternateSetting;
+  uint8_t bNumEndpoints;
+  uint8_t bInterfaceClass;
+  uint8_t bInterfaceSubClass;
+  uint8_t bInterfaceProtocol;
+  uint8_t iInterface;
+};
+
+class USB_Device;
+class USB_Driver;
+
+typedef std::function<void(int)> USBCallback;   // Bytes transferred, negative on error
+
+class HostUsbBus {
+public:
+  virtual ~HostUsbBus() {}
+  // 0 when the transfer is queued; cb runs when it completes
+  virtual int interruptMessage(USB_Driver* driver, uint8_t ep, uint16_t len, void* data, const USBCallback* cb) = 0;
+};
+
+inline HostUsbBus* hostUsbBus = nullptr;
+
+class USB_Driver {
+public:
+  virtual ~USB_Driver() {}
+  virtual void detach() {}
+
+protected:
+  int InterruptMessage(uint8_t ep, uint16_t len, void* data, const USBCallback* cb) {
+    return hostUsbBus ? hostUsbBus->interruptMessage(this, ep, len, data, cb) : -1;
+  }
+};
+
+template <class T>
+class USB_Driver_FactoryGlue : public USB_Driver {
+public:
+  explicit USB_Driver_FactoryGlue(USB_Device*) {}
+};
+
+class TeensyUSBHost2 {
+public:
+  void begin() {}
+};
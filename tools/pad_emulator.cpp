@@ -0,0 +1,502 @@
+// Runs the firmware against a virtual ControlPad
+// (tools/controlpad_emulator.h), so the init sequence, LED encoding and
+// report decoding can be exercised without the hardware.
+//
+//   g++ -std=c++17 -O2 -Iinclude -Itools/host tools/pad_emulator.cpp -o pad_emulator
+//   ./pad_emulator                       # built-in script
+//   ./pad_emulator script.txt            # script file, '-' for stdin
+//   ./pad_emulator --serial script.txt   # firmware Serial output on stderr
+//   ./pad_emulator --replay "test/turn button 1-6 on purple.txt"
+//   ./pad_emulator --record ours.txt script.txt   # OUT stream for tools/stream_diff
+//
+// The host side is src/main.cpp itself: setup(), loop() and USBControlPad,
+// built over the shims in tools/host/ (Arduino core, USB host library). The
+// USB host library is replaced by EmulatedBus (tools/emulated_bus.h), which
+// completes the driver's interrupt transfers against the virtual pad one 1 ms
+// frame at a time on the simulated clock, so paceDelay(), waitForInit() and
+// the init sequence's completion chaining run exactly as on the Teensy. The emulator
+// only enumerates the pad, drives loop(), and watches the events the driver
+// dispatches through a subscriber of its own. Exit status is 0 when every
+// expectation holds and every command was echoed.
+//
+// Script, one command per line ('#' starts a comment):
+//   init                         attach the pad and run the driver's init
+//   custom | static              switchToCustomMode() / switchToStaticMode()
+//   led <button> <rrggbb>        sendRealLEDCommand()
+//   fill <rrggbb>                setAllLEDs()
+//   press <button> | release <button>   the firmware answers a press with
+//                                its LED feedback frame
+//   notify <index> down|up       key notification on EP 0x83
+//   effect <n>                   pad-side effect index (answer to 52 28)
+//   read-effect                  send 52 28 and read the answer
+//   poll                         run loop() until the pad and the event
+//                                queue are quiet
+//   wait <ms>                    run loop() for that long
+//   serial <text>                type a line at the Serial console, print
+//                                the reply
+//   show                         draw the LED grid
+//   expect led <button> <rrggbb>
+//   expect brightness <hex>
+//   expect mode static|custom
+//   expect button <button> down|up
+//   expect ctrlkey <index> down|up
+//   expect effect <n>
+//   expect gesture <button> tap|double-tap|long-press|hold-repeat|none
+//
+// The full init sequence is a build option, as on the Teensy: add
+// -DCONTROLPAD_FAST_BOOT=0.
+//
+// --replay feeds every EP 0x04 OUT packet of a capture into the model and
+// compares the model's echoes with the ones the real pad sent.
+//
+// --record writes every command the driver submits as a mirror line
+// (include/controlpad_mirror.h), stamped with the simulated micros().
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "capture_reader.h"
+#include "controlpad_emulator.h"
+#include "emulated_bus.h"
+
+#include "../src/main.cpp"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) \
+  do { \
+    if (!(cond)) { \
+      failures++; \
+      printf("  FAIL: "); \
+      printf(__VA_ARGS__); \
+      printf("\n"); \
+    } \
+  } while (0)
+
+// ----- USB bus -----
+
+#define EMU_LOOP_PASS_US  100      // Simulated time one loop() pass takes
+#define EMU_SETTLE_MS     2000     // "poll" gives up after this long
+#define EMU_INIT_MS       2000     // Attach to init done
+
+static EmulatedBus* bus = nullptr;
+
+static void busTimeHook(uint64_t until_us) { bus->runUntil(until_us); }
+
+// ----- Watching the firmware -----
+
+// What the firmware's dispatcher delivered, from a subscriber next to the
+// firmware's own handlers
+struct Watch {
+  uint32_t buttons = 0;          // Bit n = button n down, from EVENT_KEY
+  uint32_t ctrlKeys = 0;         // Bit n = 43 01 key n down, from EVENT_CTRL_KEY
+  uint8_t gesture[CONTROLPAD_BUTTON_COUNT + 1] = {};   // Last gesture per button, 0 = none
+  int effect = -1;               // Byte 4 of the last 52 28 echo
+  uint32_t echoes = 0, badEchoes = 0, unexpectedEchoes = 0, lostReports = 0, keyEvents = 0;
+  CtrlReportDecoder ctrl;
+};
+
+static Watch watch;
+
+static void watchHandler(const controlpad_event& event, void*) {
+  if (event.type == EVENT_KEY) {
+    uint32_t bit = 1u << event.button;
+    watch.buttons = event.edge == EVENT_EDGE_PRESS ? (watch.buttons | bit) : (watch.buttons & ~bit);
+    watch.keyEvents++;
+  } else if (event.type == EVENT_CTRL_KEY) {
+    uint32_t bit = 1u << event.code;
+    watch.ctrlKeys = event.edge == EVENT_EDGE_PRESS ? (watch.ctrlKeys | bit) : (watch.ctrlKeys & ~bit);
+  } else if (event.type == EVENT_GESTURE) {
+    if (event.button <= CONTROLPAD_BUTTON_COUNT) watch.gesture[event.button] = event.code;
+  } else if (event.type == EVENT_CTRL_REPORT) {
+    uint8_t report[REPORT_SLAB_BYTES];
+    uint8_t len = 0;
+    if (!controlReportSlab.get(event.report, report, &len)) {
+      watch.lostReports++;
+      return;
+    }
+    if (watch.ctrl.decode(report, len).kind != CTRL_REPORT_ECHO) return;
+    uint8_t cmd[3];
+    if (!bus->popSent(cmd)) {
+      watch.unexpectedEchoes++;
+    } else if (!CtrlReportDecoder::isEchoOf(report, cmd)) {
+      watch.badEchoes++;
+    } else {
+      watch.echoes++;
+      if (cmd[0] == 0x52 && cmd[1] == 0x28) watch.effect = report[4];
+    }
+  }
+}
+
+// ----- Running the firmware -----
+
+static void runFor(uint64_t us) {
+  uint64_t end = hostNowUs + us;
+  while (hostNowUs < end) {
+    loop();
+    hostAdvance(min<uint64_t>(EMU_LOOP_PASS_US, end - hostNowUs));
+  }
+}
+
+// Until the pad has nothing left to send and the firmware has handled it all,
+// including LED frames still going out through the pacer
+static bool settle() {
+  for (uint32_t ms = 0; ms < EMU_SETTLE_MS; ms++) {
+    runFor(EMU_FRAME_US);
+    bool framesPending = controlPadDriver && controlPadDriver->ledFramesPending();
+    if (!bus->busy() && !controlpad_queue.size() && !framesPending) {
+      runFor(EMU_FRAME_US);
+      return true;
+    }
+  }
+  return false;
+}
+
+static void runInit() {
+  if (controlPadDriver) {
+    printf("init: already attached\n");
+    return;
+  }
+  uint32_t start = micros();
+  uint32_t before = bus->submitted;
+  attachEmulatedPad<USBControlPad>();
+  CHECK(controlPadDriver, "driver did not attach");
+  for (uint32_t ms = 0; ms < EMU_INIT_MS && !bootTrace.current().find(BOOT_INIT_DONE); ms++) runFor(EMU_FRAME_US);
+  CHECK(bootTrace.current().find(BOOT_INIT_DONE), "init did not finish in %d ms", EMU_INIT_MS);
+  printf("init (%s): %u commands in %lu us\n", CONTROLPAD_FAST_BOOT ? "fast" : "full", bus->submitted - before,
+         (unsigned long)(micros() - start));
+}
+
+static void readEffect() {
+  uint8_t cmd[CTRL_REPORT_LEN] = {0x52, 0x28};
+  watch.effect = -1;
+  CHECK(controlPadDriver && controlPadDriver->sendControlData(cmd, sizeof(cmd)) == 0, "52 28 not sent");
+  settle();
+}
+
+static void serialCommand(const std::string& text) {
+  FILE* out = Serial.out;
+  Serial.out = stdout;
+  Serial.feed((text + "\n").c_str());
+  runFor(10 * EMU_FRAME_US);   // Long dumps go out over several passes
+  Serial.out = out;
+}
+
+// ----- Script -----
+
+static const char* BUILTIN_SCRIPT =
+  "init\n"
+  "expect mode custom\n"
+  "led 1 ff0000\n"
+  "led 20 00ff00\n"
+  "led 24 0000ff\n"
+  "expect led 1 ff0000\n"
+  "expect led 20 00ff00\n"
+  "expect led 24 0000ff\n"
+  "press 1\n"
+  "press 24\n"
+  "poll\n"
+  "expect button 1 down\n"
+  "expect button 24 down\n"
+  "expect led 24 4080c0\n"    // Press feedback: DEMO_BUTTON_COLORS
+  "expect brightness ff\n"
+  "release 1\n"
+  "poll\n"
+  "expect button 1 up\n"
+  "expect button 24 down\n"
+  "wait 400\n"                 // Past the double-tap gap
+  "expect gesture 1 tap\n"
+  "wait 300\n"                 // 24 held past the long-press time
+  "expect gesture 24 long-press\n"
+  "release 24\n"
+  "poll\n"
+  "press 5\n"
+  "release 5\n"
+  "wait 100\n"
+  "press 5\n"
+  "release 5\n"
+  "poll\n"
+  "expect gesture 5 double-tap\n"
+  "notify 9 down\n"
+  "poll\n"
+  "expect ctrlkey 9 down\n"
+  "notify 9 up\n"
+  "poll\n"
+  "expect ctrlkey 9 up\n"
+  "effect 2\n"
+  "expect effect 2\n"
+  "static\n"
+  "expect mode static\n"
+  "custom\n"
+  "fill d752ff\n"
+  "show\n";
+
+static bool parseColor(const char* s, uint8_t rgb[3]) {
+  if (!s || strlen(s) != 6) return false;
+  unsigned long v = strtoul(s, nullptr, 16);
+  rgb[0] = (uint8_t)(v >> 16);
+  rgb[1] = (uint8_t)(v >> 8);
+  rgb[2] = (uint8_t)v;
+  return true;
+}
+
+static bool parseState(const char* s, bool& down) {
+  if (!s) return false;
+  if (strcmp(s, "down") == 0) {
+    down = true;
+  } else if (strcmp(s, "up") == 0) {
+    down = false;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static bool parseGesture(const char* s, uint8_t& gesture) {
+  static const char* const NAMES[] = {"none", "tap", "double-tap", "long-press", "hold-repeat"};
+  for (uint8_t i = 0; i < sizeof(NAMES) / sizeof(NAMES[0]); i++) {
+    if (strcmp(s, NAMES[i]) == 0) {
+      gesture = i;   // Index matches GestureType
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool needDriver(int lineNo) {
+  CHECK(controlPadDriver, "line %d: no driver, run init first", lineNo);
+  return controlPadDriver != nullptr;
+}
+
+static void runLine(VirtualControlPad& pad, char* line, int lineNo) {
+  char* hash = strchr(line, '#');
+  if (hash) *hash = 0;
+  if (strncmp(line, "serial ", 7) == 0) {
+    std::string text = line + 7;
+    while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) text.pop_back();
+    serialCommand(text);
+    return;
+  }
+  const char* argv[6] = {};
+  int argc = 0;
+  for (char* tok = strtok(line, " \t\r\n"); tok && argc < 6; tok = strtok(nullptr, " \t\r\n")) argv[argc++] = tok;
+  if (!argc) return;
+
+  const char* cmd = argv[0];
+  uint8_t rgb[3];
+  uint8_t gesture;
+  bool down;
+  if (strcmp(cmd, "init") == 0) {
+    runInit();
+  } else if (strcmp(cmd, "custom") == 0 || strcmp(cmd, "static") == 0) {
+    if (!needDriver(lineNo)) return;
+    if (cmd[0] == 'c') {
+      controlPadDriver->switchToCustomMode();
+    } else {
+      controlPadDriver->switchToStaticMode();
+    }
+  } else if (strcmp(cmd, "led") == 0 && argc == 3 && parseColor(argv[2], rgb)) {
+    if (needDriver(lineNo)) controlPadDriver->sendRealLEDCommand((uint8_t)atoi(argv[1]), rgb[0], rgb[1], rgb[2]);
+  } else if (strcmp(cmd, "fill") == 0 && argc == 2 && parseColor(argv[1], rgb)) {
+    if (needDriver(lineNo)) controlPadDriver->setAllLEDs(rgb[0], rgb[1], rgb[2]);
+  } else if ((strcmp(cmd, "press") == 0 || strcmp(cmd, "release") == 0) && argc == 2) {
+    CHECK(cmd[0] == 'p' ? pad.press((uint8_t)atoi(argv[1])) : pad.release((uint8_t)atoi(argv[1])),
+          "line %d: no button %s", lineNo, argv[1]);
+    runFor(EMU_FRAME_US);
+  } else if (strcmp(cmd, "notify") == 0 && argc == 3 && parseState(argv[2], down)) {
+    pad.notifyKey((uint8_t)atoi(argv[1]), down);
+  } else if (strcmp(cmd, "effect") == 0 && argc == 2) {
+    pad.setEffect((uint8_t)atoi(argv[1]));
+  } else if (strcmp(cmd, "read-effect") == 0) {
+    readEffect();
+    printf("effect %d\n", watch.effect);
+  } else if (strcmp(cmd, "poll") == 0) {
+    CHECK(settle(), "line %d: still busy after %d ms", lineNo, EMU_SETTLE_MS);
+  } else if (strcmp(cmd, "wait") == 0 && argc == 2) {
+    runFor((uint64_t)strtoul(argv[1], nullptr, 10) * 1000);
+  } else if (strcmp(cmd, "show") == 0) {
+    settle();
+    pad.render(stdout);
+  } else if (strcmp(cmd, "expect") == 0 && argc >= 3) {
+    settle();
+    const char* what = argv[1];
+    if (strcmp(what, "led") == 0 && argc == 4 && parseColor(argv[3], rgb)) {
+      int b = atoi(argv[2]);
+      CHECK(b >= 1 && b <= LED_COUNT && memcmp(pad.leds().rgb[b - 1], rgb, 3) == 0, "line %d: LED %d is not %s",
+            lineNo, b, argv[3]);
+    } else if (strcmp(what, "brightness") == 0) {
+      CHECK(pad.leds().brightness == strtoul(argv[2], nullptr, 16), "line %d: brightness is %02X, not %s", lineNo,
+            pad.leds().brightness, argv[2]);
+    } else if (strcmp(what, "mode") == 0) {
+      CHECK(strcmp(VirtualControlPad::modeName(pad.currentMode()), argv[2]) == 0, "line %d: mode is %s, not %s",
+            lineNo, VirtualControlPad::modeName(pad.currentMode()), argv[2]);
+    } else if (strcmp(what, "button") == 0 && argc == 4 && parseState(argv[3], down)) {
+      int b = atoi(argv[2]);
+      CHECK(b >= 1 && b <= CONTROLPAD_BUTTON_COUNT && ((watch.buttons >> b) & 1) == down,
+            "line %d: firmware sees button %s %s", lineNo, argv[2], down ? "up" : "down");
+    } else if (strcmp(what, "ctrlkey") == 0 && argc == 4 && parseState(argv[3], down)) {
+      int index = atoi(argv[2]);
+      CHECK(index < CTRL_KEY_MAX && ((watch.ctrlKeys >> index) & 1) == down, "line %d: firmware sees key %s %s",
+            lineNo, argv[2], down ? "up" : "down");
+    } else if (strcmp(what, "effect") == 0) {
+      readEffect();
+      CHECK(watch.effect == atoi(argv[2]), "line %d: effect reads back as %d", lineNo, watch.effect);
+    } else if (strcmp(what, "gesture") == 0 && argc == 4 && parseGesture(argv[3], gesture)) {
+      int b = atoi(argv[2]);
+      bool valid = b >= 1 && b <= CONTROLPAD_BUTTON_COUNT;
+      CHECK(valid && watch.gesture[b] == gesture, "line %d: last gesture of button %s is %s", lineNo, argv[2],
+            valid && watch.gesture[b] ? GestureRecognizer::name(watch.gesture[b]) : "none");
+    } else {
+      CHECK(false, "line %d: bad expectation", lineNo);
+    }
+  } else {
+    CHECK(false, "line %d: bad command '%s'", lineNo, cmd);
+  }
+}
+
+static int runScript(FILE* f, const char* text, FILE* record, FILE* serial) {
+  VirtualControlPad pad;
+  EmulatedBus usb(pad);
+  usb.record = record;
+  bus = &usb;
+  hostUsbBus = &usb;
+  hostTimeHook = busTimeHook;
+  Serial.out = serial;
+
+  setup();
+  CHECK(dispatcher.subscribe(DISPATCH_TYPE(EVENT_KEY) | DISPATCH_TYPE(EVENT_CTRL_KEY) |
+                             DISPATCH_TYPE(EVENT_CTRL_REPORT) | DISPATCH_TYPE(EVENT_GESTURE),
+                             DISPATCH_ALL_BUTTONS, watchHandler, nullptr, "emulator"),
+        "no dispatcher slot for the emulator");
+
+  char line[256];
+  int lineNo = 0;
+  const char* p = text;
+  for (;;) {
+    if (f) {
+      if (!fgets(line, sizeof(line), f)) break;
+    } else {
+      if (!*p) break;
+      const char* nl = strchr(p, '\n');
+      size_t n = nl ? (size_t)(nl - p) : strlen(p);
+      if (n >= sizeof(line)) n = sizeof(line) - 1;
+      memcpy(line, p, n);
+      line[n] = 0;
+      p += n + (nl ? 1 : 0);
+    }
+    runLine(pad, line, ++lineNo);
+  }
+  settle();
+
+  CHECK(watch.badEchoes == 0 && watch.unexpectedEchoes == 0 && usb.lostTrack == 0,
+        "%u echoes did not match their command, %u unexpected", watch.badEchoes, watch.unexpectedEchoes);
+  CHECK(watch.lostReports == 0, "%u control reports overwritten before dispatch", watch.lostReports);
+  CHECK(watch.echoes == usb.submitted, "%u of %u commands echoed", watch.echoes, usb.submitted);
+  CHECK(usb.stalled == 0 && driverStats.ctrl_out.failed.get() == 0, "%u commands stalled", usb.stalled);
+  CHECK(driverStats.ctrl_out.rejected.get() == 0, "%lu commands refused at submit",
+        (unsigned long)driverStats.ctrl_out.rejected.get());
+  CHECK(controlpad_queue.droppedCount() == 0, "%lu events dropped", (unsigned long)controlpad_queue.droppedCount());
+  CHECK(pad.droppedReports() == 0, "%u IN reports dropped", pad.droppedReports());
+  CHECK(pad.unknownCount() == 0, "%u commands the pad does not know", pad.unknownCount());
+  printf("%u commands, %u echoed, %u commits, %u key events\n", usb.submitted, watch.echoes, pad.commitCount(),
+         watch.keyEvents);
+
+  hostTimeHook = nullptr;
+  hostUsbBus = nullptr;
+  bus = nullptr;
+  return failures;
+}
+
+// ----- Replay -----
+
+static bool sameReport(const uint8_t* a, const uint8_t* b) { return memcmp(a, b, CTRL_REPORT_LEN) == 0; }
+
+static int replay(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return 1;
+  }
+  VirtualControlPad pad;
+  CaptureReader reader(f);
+  CaptureRecord r;
+  uint32_t outs = 0, exact = 0, header = 0, differ = 0;
+  uint8_t echo[CTRL_REPORT_LEN];
+  bool haveEcho = false;
+  while (reader.next(r)) {
+    if (r.length != CTRL_REPORT_LEN || r.interface_num != 1) continue;
+    if (!r.in && r.endpoint == VPAD_EP_CTRL_OUT) {
+      outs++;
+      pad.out(VPAD_EP_CTRL_OUT, r.payload, r.length);
+      haveEcho = pad.in(VPAD_EP_CTRL_IN, echo);
+    } else if (r.in && r.endpoint == VPAD_EP_CTRL_IN && haveEcho && CtrlReportDecoder::isEchoOf(r.payload, echo)) {
+      // Unsolicited 42 20 / 43 01 reports fall through untouched
+      haveEcho = false;
+      if (sameReport(r.payload, echo)) {
+        exact++;
+      } else if (memcmp(r.payload, echo, 4) == 0) {
+        header++;
+      } else {
+        differ++;
+        printf("  line %d: pad %02x %02x %02x %02x, model %02x %02x %02x %02x\n", r.line, r.payload[0],
+               r.payload[1], r.payload[2], r.payload[3], echo[0], echo[1], echo[2], echo[3]);
+      }
+    }
+  }
+  fclose(f);
+  printf("%s\n  %u commands; echoes: %u exact, %u header only (read answers not modelled), %u differ\n", path, outs,
+         exact, header, differ);
+  printf("  model ends in mode %s after %u commits\n", VirtualControlPad::modeName(pad.currentMode()),
+         pad.commitCount());
+  if (outs) pad.render(stdout);
+  return differ ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+    fprintf(stderr, "usage: %s [--serial] [--record out.txt] [script.txt | -]\n       %s --replay capture.txt ...\n",
+            argv[0], argv[0]);
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "--replay") == 0) {
+    int status = 0;
+    for (int i = 2; i < argc; i++) status |= replay(argv[i]);
+    return status;
+  }
+
+  FILE* record = nullptr;
+  FILE* serial = nullptr;
+  int arg = 1;
+  for (;;) {
+    if (argc > arg && strcmp(argv[arg], "--serial") == 0) {
+      serial = stderr;
+      arg++;
+    } else if (argc > arg + 1 && strcmp(argv[arg], "--record") == 0) {
+      record = fopen(argv[arg + 1], "w");
+      if (!record) {
+        perror(argv[arg + 1]);
+        return 1;
+      }
+      arg += 2;
+    } else {
+      break;
+    }
+  }
+
+  if (argc > arg) {
+    FILE* f = strcmp(argv[arg], "-") == 0 ? stdin : fopen(argv[arg], "r");
+    if (!f) {
+      perror(argv[arg]);
+      return 1;
+    }
+    runScript(f, nullptr, record, serial);
+    if (f != stdin) fclose(f);
+  } else {
+    runScript(nullptr, BUILTIN_SCRIPT, record, serial);
+  }
+  if (record) fclose(record);
+  printf("%s (%d failure%s)\n", failures ? "FAIL" : "PASS", failures, failures == 1 ? "" : "s");
+  return failures ? 1 : 0;
+}
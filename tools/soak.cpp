@@ -0,0 +1,710 @@
+// Soak test of the firmware's key-press-to-LED-frame path on a simulated
+// clock: hours of typing, chords, holds and idle stretches in a few seconds
+// of host time.
+//
+//   g++ -std=c++17 -O2 -Iinclude -Itools/host tools/soak.cpp -o soak
+//   ./soak --hours 24 --seed 7
+//
+// Like pad_emulator, the soak is src/main.cpp itself built over the shims in
+// tools/host/: setup() and loop() run against a VirtualControlPad on
+// EmulatedBus (tools/emulated_bus.h), so the event queue
+// (CONTROLPAD_QUEUE_DEPTH), the dispatcher and its DISPATCH_BUDGET_US, the
+// handlers, the gesture recognizer, the LED frame pacer and all the
+// accounting are the firmware's own. The soak presses and releases keys on
+// the pad and runs loop() whenever the firmware has something to do: a USB
+// frame with traffic, an LED packet falling due, a gesture deadline (every
+// ms while one is pending), the end of the one-second CPU window. Code takes
+// no simulated time, as in the emulator; only delay() moves the clock inside
+// loop(). Idle time is skipped instead of stepped.
+//
+// micros() and the DWT cycle counter are cut from the shim's 64-bit clock.
+// By default it starts 30 s before micros() wraps (--start-us), and the cycle
+// counter wraps every 7.16 s at 600 MHz, so both rollovers happen early and
+// often. Invariants, each checked against the 64-bit clock with what the bus
+// and the pad saw and a subscriber next to the firmware's handlers:
+//
+//   latency   every press lit (commit completed) within --max-latency-ms
+//   gap       while presses wait, lit frames no further apart than --max-gap-ms
+//   starve    no press dropped by a full queue, abandoned or left unlit, and
+//             each lit button showing its colour on the pad (a press whose
+//             frame the pacer replaced is lit by the newer frame)
+//   wrap      32-bit intervals (latency, frame interval, CPU window) equal
+//             the true ones across the rollovers
+//   gesture   one double-tap per tap pair, one long-press per hold (edges
+//             that wait in the queue must not skew either), hold-repeat
+//             counts without gaps (and stuck at 65535 rather than wrapping;
+//             --max-hold-s 7000 gets there)
+//   overflow  every 32-bit counter equals its 64-bit shadow; the summary
+//             projects how long each takes to wrap at the simulated rate
+//   budget    drain() never stops on its budget: the handlers, LED feedback
+//             included, must each return without blocking
+//
+// The first few violations of each kind are printed with the simulated time.
+// Exit status: 0 all invariants held, 1 a violation, 2 bad arguments.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "controlpad_emulator.h"
+#include "emulated_bus.h"
+
+#include "../src/main.cpp"
+
+#define SIM_LOOP_PASS_US   100       // Shortest gap between two loop() passes
+#define SIM_TICK_US        1000      // loop() step while a gesture deadline is pending
+#define SIM_CPU_WINDOW_US  1000000   // cpuAccount's window, F_CPU_ACTUAL cycles
+#define SIM_INIT_MS        2000      // Attach to init done
+#define SIM_SETTLE_US      400000    // Quiet time after a phase, past the double-tap gap
+
+#define SIM_VIOLATION_KINDS  7
+#define SIM_VIOLATIONS_SHOWN 5
+
+static const char* const VIOLATION_NAMES[SIM_VIOLATION_KINDS] = {
+  "latency", "gap", "starve", "wrap", "gesture", "overflow", "budget"};
+enum Violation : uint8_t { V_LATENCY, V_GAP, V_STARVE, V_WRAP, V_GESTURE, V_OVERFLOW, V_BUDGET };
+
+struct Options {
+  double hours = 8;
+  uint32_t seed = 1;
+  uint64_t start_us = (1ull << 32) - 30000000;  // 30 s before micros() wraps
+  uint32_t max_latency_ms = 250;
+  uint32_t max_gap_ms = 60;
+  uint32_t max_idle_s = 90;
+  uint32_t max_hold_s = 6;
+  uint32_t refuse = 0;        // Refuse one LED submit in N, 0 = never
+};
+
+enum SimEventKind : uint8_t { SIM_WORKLOAD, SIM_KEY };
+
+// Something that happens outside the firmware: the next workload phase, a
+// key edge on the pad
+struct SimEvent {
+  uint64_t at_us;
+  uint64_t seq;         // Keeps events due at the same time in order
+  uint8_t kind;
+  uint8_t button;
+  bool pressed;
+
+  bool operator>(const SimEvent& o) const { return at_us != o.at_us ? at_us > o.at_us : seq > o.seq; }
+};
+
+// A 32-bit counter next to the 64-bit count it should equal
+struct CounterCheck {
+  const char* name;
+  uint32_t value;
+  uint64_t shadow;
+};
+
+static EmulatedBus* bus = nullptr;
+
+static void busTimeHook(uint64_t until_us) { bus->runUntil(until_us); }
+
+static inline uint64_t cycles64() { return hostNowUs * (F_CPU_ACTUAL / 1000000); }
+
+class Soak {
+public:
+  explicit Soak(const Options& o) : opt(o), rng(o.seed), usb(pad) {}
+
+  bool run() {
+    hostNowUs = opt.start_us;
+    bus = &usb;
+    hostUsbBus = &usb;
+    hostTimeHook = busTimeHook;
+    usb.onIn = [this](uint8_t ep, const uint8_t*, uint16_t) {
+      if (ep == VPAD_EP_KBD_IN) onKeyReport();
+    };
+    usb.onOutSubmit = [this](const uint8_t* data, uint16_t len, bool accepted) { onOutSubmit(data, len, accepted); };
+    usb.onOutDone = [this](const uint8_t* data, uint16_t, int status) { onOutDone(data, status); };
+
+    setup();
+    cpu_window_us = hostNowUs;   // cpuAccount.begin() in setup()
+    dispatcher.subscribe(DISPATCH_ALL_TYPES, DISPATCH_ALL_BUTTONS, watchHandler, this, "soak");
+    if (!init()) return false;
+
+    // Refusals only hit LED frames: the init sequence is not under test
+    usb.refuseOut = [this](uint8_t) { return opt.refuse && rng() % opt.refuse == 0; };
+    started = true;
+    schedule(hostNowUs, SIM_WORKLOAD);
+
+    uint64_t end_us = opt.start_us + (uint64_t)(opt.hours * 3600e6);
+    // Progress about 20 times per run, on whole hours
+    uint64_t report_us = 3600000000ull * (opt.hours >= 40 ? (uint64_t)(opt.hours / 20) : 1);
+    uint64_t next_report = opt.start_us + report_us;
+    while (hostNowUs < end_us) {
+      pass();
+
+      // Sleep until loop() has something to do again
+      uint64_t next = events.empty() ? end_us : events.top().at_us;
+      if (controlpad_queue.size()) next = hostNowUs;   // Left behind by the budget
+      if (gestures.busy()) next = std::min(next, hostNowUs + SIM_TICK_US);
+      if (controlPadDriver && controlPadDriver->ledFramesPending()) {
+        int32_t wait_us = (int32_t)(controlPadDriver->ledFrameDueUs() - micros());
+        next = std::min(next, hostNowUs + (uint64_t)std::max(wait_us, (int32_t)0));
+      }
+      if (usb.busy()) next = std::min(next, usb.nextFrame() + SIM_LOOP_PASS_US);
+      next = std::min(next, cpu_window_us + SIM_CPU_WINDOW_US);
+      advanceTo(std::min(std::max(next, hostNowUs + SIM_LOOP_PASS_US), end_us));
+
+      if (hostNowUs >= next_report) {
+        printProgress();
+        next_report += report_us;
+      }
+    }
+    finish();
+    return total_violations == 0;
+  }
+
+private:
+  struct Edge {
+    uint8_t button;
+    bool down;
+  };
+
+  struct Pending {
+    uint16_t id;
+    uint8_t button;
+    uint64_t press_us;   // When the report reached kbd_poll
+  };
+
+  // ----- Time -----
+
+  void schedule(uint64_t at_us, uint8_t kind, uint8_t button = 0, bool pressed = false) {
+    events.push({at_us, seq++, kind, button, pressed});
+  }
+
+  // Let time pass, the bus delivering whatever falls due on the way
+  void advanceTo(uint64_t t_us) {
+    while (!events.empty() && events.top().at_us <= t_us) {
+      SimEvent e = events.top();
+      events.pop();
+      if (e.at_us > hostNowUs) hostAdvance(e.at_us - hostNowUs);
+      deliver(e);
+    }
+    if (t_us > hostNowUs) hostAdvance(t_us - hostNowUs);
+  }
+
+  // Attach the pad and run loop() until the driver's init sequence is done
+  bool init() {
+    attachEmulatedPad<USBControlPad>();
+    for (uint32_t us = 0; us < SIM_INIT_MS * 1000 && !bootTrace.current().find(BOOT_INIT_DONE); us += SIM_LOOP_PASS_US) {
+      pass();
+      hostAdvance(SIM_LOOP_PASS_US);
+    }
+    if (!controlPadDriver || !bootTrace.current().find(BOOT_INIT_DONE)) {
+      printf("The driver did not attach and finish init within %d ms\n", SIM_INIT_MS);
+      return false;
+    }
+    return true;
+  }
+
+  // ----- loop() -----
+
+  void pass() {
+    uint32_t stops = dispatcher.statistics().budget_stops;
+    uint32_t windows = cpuAccount.windowCount();
+    loop();
+    if (dispatcher.statistics().budget_stops != stops) {
+      violation(V_BUDGET, "drain stopped on the budget, %u event(s) left", controlpad_queue.size());
+    }
+    if (controlpad_queue.droppedCount() != drops) {
+      violation(V_STARVE, "queue full, %lu event(s) dropped", (unsigned long)(controlpad_queue.droppedCount() - drops));
+      drops = controlpad_queue.droppedCount();
+    }
+    if (interval_due) checkFrameInterval();
+    checkCpuWindow(windows);
+  }
+
+  static void watchHandler(const controlpad_event& e, void* ctx) { static_cast<Soak*>(ctx)->watch(e); }
+
+  // Every event the dispatcher delivers, next to the firmware's handlers
+  void watch(const controlpad_event& e) {
+    dispatched++;
+    uint32_t delay_us = micros() - e.timestamp_us;
+    if (delay_us > opt.max_latency_ms * 1000) {
+      violation(V_LATENCY, "event type %u button %u waited %lu us in the queue", e.type, e.button, (unsigned long)delay_us);
+    }
+    if (e.type == EVENT_KEY && e.edge == EVENT_EDGE_PRESS) {
+      onPress(e);
+    } else if (e.type == EVENT_GESTURE) {
+      onGesture(e);
+    }
+  }
+
+  // A press reached the handlers: the report it came in gets its press ID
+  void onPress(const controlpad_event& e) {
+    auto d = std::find_if(delivered.begin(), delivered.end(), [&](const Pending& p) { return p.button == e.button; });
+    if (d == delivered.end()) {
+      violation(V_STARVE, "press %u of button %u that the pad never sent", e.report, e.button);
+      return;
+    }
+    Pending p = *d;
+    delivered.erase(d);
+    p.id = e.report;
+    if (p.id <= last_press_id) press_id_wraps++;
+    last_press_id = p.id;
+    presses++;
+    if (waiting.empty()) gap_start_us = p.press_us;
+    waiting.push_back(p);
+  }
+
+  void onGesture(const controlpad_event& g) {
+    if (g.code == GESTURE_DOUBLE_TAP) {
+      double_taps++;
+    } else if (g.code == GESTURE_LONG_PRESS) {
+      long_presses++;
+      last_repeat[g.button] = 0;
+    } else if (g.code == GESTURE_HOLD_REPEAT) {
+      hold_repeats++;
+      uint16_t last = last_repeat[g.button];
+      if (g.report < last) {
+        violation(V_OVERFLOW, "button %u hold-repeat count wrapped", g.button);
+      } else if (g.report != last + 1 && !(g.report == UINT16_MAX && last == UINT16_MAX)) {
+        violation(V_GESTURE, "button %u hold-repeat %u after %u", g.button, g.report, last);
+      }
+      last_repeat[g.button] = g.report;
+      if (g.report > max_repeat) max_repeat = g.report;
+    }
+  }
+
+  // ----- USB -----
+
+  // A keyboard report went to kbd_poll: the oldest edge the pad queued
+  void onKeyReport() {
+    kbd_reports++;
+    if (edges.empty()) return;
+    Edge e = edges.front();
+    edges.pop_front();
+    if (e.down) delivered.push_back({LATENCY_NO_ID, e.button, hostNowUs});
+  }
+
+  static bool isPart1(const uint8_t* d) { return d[0] == 0x56 && d[1] == 0x83 && d[2] == 0x00; }
+  static bool isCommit(const uint8_t* d) { return d[0] == 0x41 && d[1] == 0x80; }
+
+  void onOutSubmit(const uint8_t* data, uint16_t len, bool accepted) {
+    if (accepted) {
+      out_submitted++;
+    } else {
+      out_rejected++;
+    }
+    if (len < 3) return;
+    if (isPart1(data)) {
+      frames_rendered++;
+      frame_open = accepted;
+    } else if (isCommit(data) && frame_open) {
+      frame_open = false;
+      if (!accepted) return;
+      frames_sent++;
+      if (have_commit) {
+        expected_interval_us = hostNowUs - last_commit_us;
+        interval_due = true;
+        if (expected_interval_us > longest_interval_us) longest_interval_us = expected_interval_us;
+      }
+      have_commit = true;
+      last_commit_us = hostNowUs;
+    }
+  }
+
+  void onOutDone(const uint8_t* data, int status) {
+    if (status < 0) return;
+    out_completed++;
+    if (started && isCommit(data)) checkLit(controlPadDriver->commitPressId());
+  }
+
+  // ----- Workload -----
+
+  void deliver(const SimEvent& e) {
+    if (e.kind == SIM_WORKLOAD) {
+      nextPhase();
+      return;
+    }
+    if (e.pressed ? pad.press(e.button) : pad.release(e.button)) edges.push_back({e.button, e.pressed});
+  }
+
+  // Key edges reach the pad on a frame boundary, so the next poll takes them
+  void key(uint64_t at_us, uint8_t button, bool pressed) {
+    at_us += EMU_FRAME_US - at_us % EMU_FRAME_US;
+    schedule(at_us, SIM_KEY, button, pressed);
+  }
+
+  uint32_t uniform(uint32_t lo, uint32_t hi) { return lo + rng() % (hi - lo + 1); }
+  uint8_t randomButton() { return (uint8_t)uniform(1, CONTROLPAD_BUTTON_COUNT); }
+
+  // Queue the key edges of one phase and the start of the next
+  void nextPhase() {
+    const uint64_t ms = 1000;
+    uint64_t t = hostNowUs;
+    uint32_t pick = rng() % 100;
+    if (pick < 35) {
+      // Typing: short taps, never two keys down at once, and no key again
+      // within three taps (that could be a double-tap)
+      uint32_t count = uniform(5, 40);
+      uint8_t recent[3] = {0, 0, 0};
+      for (uint32_t i = 0; i < count; i++) {
+        uint8_t b;
+        do {
+          b = randomButton();
+        } while (std::find(recent, recent + 3, b) != recent + 3);
+        recent[i % 3] = b;
+        uint64_t hold = uniform(30, 120) * ms;
+        key(t, b, true);
+        key(t + hold, b, false);
+        t += uniform(130, 450) * ms;
+      }
+      t += SIM_SETTLE_US;
+    } else if (pick < 50) {
+      // Chord: two to four buttons within a few ms
+      uint8_t count = (uint8_t)uniform(2, 4);
+      uint8_t chord[4];
+      for (uint8_t i = 0; i < count; i++) {
+        uint8_t b;
+        do {
+          b = randomButton();
+        } while (std::find(chord, chord + i, b) != chord + i);
+        chord[i] = b;
+        key(t + uniform(0, 8) * ms, b, true);
+      }
+      uint64_t hold = uniform(100, 300) * ms;
+      for (uint8_t i = 0; i < count; i++) key(t + hold + uniform(10, 20) * ms, chord[i], false);
+      t += hold + 20 * ms + SIM_SETTLE_US;
+    } else if (pick < 65) {
+      // Hold: long-press and hold-repeat
+      uint8_t b = randomButton();
+      GestureConfig gc = gestures.getConfig();
+      uint64_t hold = uniform(800, opt.max_hold_s * 1000 > 800 ? opt.max_hold_s * 1000 : 800) * ms;
+      key(t, b, true);
+      key(t + hold, b, false);
+      // The press and release both land on a poll boundary; keep away from the threshold
+      if (hold >= (uint64_t)gc.long_press_us + 2 * EMU_FRAME_US) expected_long_presses++;
+      t += hold + SIM_SETTLE_US;
+    } else if (pick < 75) {
+      // Double taps on one button
+      uint8_t b = randomButton();
+      for (int i = 0; i < 2; i++) {
+        key(t, b, true);
+        key(t + 60 * ms, b, false);
+        t += uniform(100, 220) * ms;
+      }
+      expected_double_taps++;
+      t += SIM_SETTLE_US;
+    } else if (pick < 80) {
+      // Near misses: an edge just inside a gesture threshold, with another
+      // key's press and LED frame going on around it. Either a hold released
+      // just short of a long-press or a double-tap whose second press comes
+      // just inside the gap.
+      GestureConfig gc = gestures.getConfig();
+      uint8_t b = randomButton();
+      uint8_t other;
+      do {
+        other = randomButton();
+      } while (other == b);
+      uint64_t edge;
+      key(t, b, true);
+      if (rng() % 2) {
+        edge = t + gc.long_press_us - uniform(5, 15) * ms;
+        key(edge, b, false);
+      } else {
+        key(t + 60 * ms, b, false);
+        edge = t + 60 * ms + gc.double_tap_gap_us - uniform(5, 15) * ms;
+        key(edge, b, true);
+        key(edge + 60 * ms, b, false);
+        expected_double_taps++;
+      }
+      key(edge - 20 * ms, other, true);
+      key(edge + 40 * ms, other, false);
+      t = edge + SIM_SETTLE_US;
+    } else {
+      // Idle; now and then long enough to see a screensaver-sized gap
+      uint32_t s = rng() % 20 == 0 ? uniform(opt.max_idle_s, opt.max_idle_s * 10) : uniform(1, opt.max_idle_s);
+      t += (uint64_t)s * 1000 * ms;
+    }
+    schedule(t, SIM_WORKLOAD);
+  }
+
+  // ----- Invariants -----
+
+  void violation(uint8_t kind, const char* fmt, ...) __attribute__((format(printf, 3, 4))) {
+    total_violations++;
+    if (++violations[kind] > SIM_VIOLATIONS_SHOWN) return;
+    uint64_t ms = (hostNowUs - opt.start_us) / 1000;
+    printf("[%3lu:%02lu:%02lu.%03lu] %-8s ", (unsigned long)(ms / 3600000), (unsigned long)(ms / 60000 % 60),
+           (unsigned long)(ms / 1000 % 60), (unsigned long)(ms % 1000), VIOLATION_NAMES[kind]);
+    va_list args;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+    printf("\n");
+  }
+
+  // A commit completed: its press must be the oldest one waiting, apart from
+  // presses whose frames the pacer replaced, which it lights as well
+  void checkLit(uint16_t id) {
+    while (!waiting.empty() && waiting.front().id != id) {
+      if (driverStats.frames_coalesced.get() != coalesced_claimed) {
+        coalesced_claimed++;
+        litPress(waiting.front());
+      } else {
+        violation(V_STARVE, "press %u never lit", waiting.front().id);
+        unlit++;
+      }
+      waiting.pop_front();
+    }
+    if (waiting.empty()) {
+      violation(V_STARVE, "commit for press %u with no press waiting", id);
+      return;
+    }
+    Pending p = waiting.front();
+    waiting.pop_front();
+    lit++;
+    uint64_t true_us = litPress(p);
+    if (pressLatency.last_us != (uint32_t)true_us || true_us > UINT32_MAX) {
+      violation(V_WRAP, "press %u: tracker says %lu us, clock says %llu us", id,
+                (unsigned long)pressLatency.last_us, (unsigned long long)true_us);
+    }
+    const uint8_t* want = DEMO_BUTTON_COLORS[p.button - 1];
+    const uint8_t* shown = pad.leds().rgb[p.button - 1];
+    if (memcmp(want, shown, 3) != 0) {
+      violation(V_STARVE, "press %u lit, but button %u shows %02x%02x%02x on the pad", id, p.button, shown[0],
+                shown[1], shown[2]);
+    }
+
+    uint64_t gap_us = hostNowUs - gap_start_us;
+    if (gap_us > max_gap_us) max_gap_us = gap_us;
+    if (gap_us > (uint64_t)opt.max_gap_ms * 1000) {
+      violation(V_GAP, "%llu ms without a lit frame while %zu press(es) waited", (unsigned long long)(gap_us / 1000),
+                waiting.size() + 1);
+    }
+    gap_start_us = hostNowUs;
+  }
+
+  uint64_t litPress(const Pending& p) {
+    uint64_t true_us = hostNowUs - p.press_us;
+    if (true_us > max_latency_us) max_latency_us = true_us;
+    if (true_us > opt.max_latency_ms * 1000) {
+      violation(V_LATENCY, "press %u lit after %llu ms", p.id, (unsigned long long)(true_us / 1000));
+    }
+    return true_us;
+  }
+
+  // FrameAccounting's interval against the clock, once loop() has returned
+  void checkFrameInterval() {
+    interval_due = false;
+    if (expected_interval_us > UINT32_MAX) {
+      intervals_out_of_range++;
+    } else if (driverStats.frame_interval_us.get() != expected_interval_us) {
+      violation(V_WRAP, "frame interval %lu us, clock says %llu us", (unsigned long)driverStats.frame_interval_us.get(),
+                (unsigned long long)expected_interval_us);
+    }
+  }
+
+  // The window must close on the first pass a second after it opened, with
+  // every cycle of it in some category
+  void checkCpuWindow(uint32_t windows_before) {
+    uint64_t window_us = hostNowUs - cpu_window_us;
+    bool rolled = cpuAccount.windowCount() != windows_before;
+    if (rolled != (window_us >= SIM_CPU_WINDOW_US)) {
+      violation(V_WRAP, "CPU window %s after %llu us", rolled ? "closed" : "still open", (unsigned long long)window_us);
+    }
+    if (!rolled) return;
+    cpu_windows++;
+    cpu_window_us = hostNowUs;
+    uint64_t window = window_us * (F_CPU_ACTUAL / 1000000);
+    uint64_t sum = 0;
+    for (uint8_t c = 0; c < CPU_CATEGORY_COUNT; c++) sum += cpuAccount.cycles(c);
+    if (window > UINT32_MAX || cpuAccount.totalCycles() != window || sum != window) {
+      violation(V_WRAP, "CPU window of %lu cycles (categories %llu), clock says %llu",
+                (unsigned long)cpuAccount.totalCycles(), (unsigned long long)sum, (unsigned long long)window);
+    }
+  }
+
+  std::vector<CounterCheck> counters() const {
+    const DispatchStats& ds = dispatcher.statistics();
+    // Every rendered frame was sent, suppressed or is still open
+    uint64_t suppressed = frames_rendered - frames_sent - (frame_open ? 1 : 0);
+    return {
+      {"frames_rendered", driverStats.frames_rendered.get(), frames_rendered},
+      {"frames_sent", driverStats.frames_sent.get(), frames_sent},
+      {"frames_suppressed", driverStats.frames_suppressed.get(), suppressed},
+      {"ctrl_out.submitted", driverStats.ctrl_out.submitted.get(), out_submitted},
+      {"ctrl_out.rejected", driverStats.ctrl_out.rejected.get(), out_rejected},
+      {"ctrl_out.completed", driverStats.ctrl_out.completed.get(), out_completed},
+      {"kbd_in.completed", driverStats.kbd_in.completed.get(), kbd_reports},
+      {"press_to_light.count", pressLatency.press_to_light.count, lit},
+      {"latency histogram", pressLatency.histogram.count(), lit},
+      {"dispatch events", ds.events, dispatched},
+      {"event delay count", eventDelayStats.count, dispatched},
+      {"cpu windows", cpuAccount.windowCount(), cpu_windows},
+    };
+  }
+
+  void printProgress() const {
+    uint64_t hours = (hostNowUs - opt.start_us) / 3600000000ull;
+    printf("%4lluh  presses %llu  frames %llu  p99 %lu us  worst %llu ms  worst gap %llu ms  peak busy %lu.%lu%%  violations %llu\n",
+           (unsigned long long)hours, (unsigned long long)presses, (unsigned long long)frames_sent,
+           (unsigned long)pressLatency.p99(), (unsigned long long)(max_latency_us / 1000),
+           (unsigned long long)(max_gap_us / 1000), (unsigned long)(cpuAccount.peakBusyPermille() / 10),
+           (unsigned long)(cpuAccount.peakBusyPermille() % 10), (unsigned long long)total_violations);
+  }
+
+  void finish() {
+    for (const Pending& p : waiting) {
+      if (hostNowUs - p.press_us > (uint64_t)opt.max_latency_ms * 1000) {
+        violation(V_STARVE, "press %u still unlit at the end", p.id);
+      }
+    }
+    if (pad.droppedReports()) violation(V_STARVE, "%lu report(s) dropped on the pad", (unsigned long)pad.droppedReports());
+    if (pressLatency.abandoned) violation(V_STARVE, "%lu frame(s) abandoned", (unsigned long)pressLatency.abandoned);
+    if (pressLatency.orphans) {
+      violation(V_STARVE, "%lu commit completion(s) matched no press", (unsigned long)pressLatency.orphans);
+    }
+    if (double_taps != expected_double_taps) {
+      violation(V_GESTURE, "%llu double-tap(s) for %llu pair(s)", (unsigned long long)double_taps,
+                (unsigned long long)expected_double_taps);
+    }
+    if (long_presses != expected_long_presses) {
+      violation(V_GESTURE, "%llu long-press(es) for %llu hold(s)", (unsigned long long)long_presses,
+                (unsigned long long)expected_long_presses);
+    }
+
+    double sim_h = (hostNowUs - opt.start_us) / 3600e6;
+    printf("\nCounters (wrap projected at this run's rate)\n");
+    for (const CounterCheck& c : counters()) {
+      if (c.shadow > UINT32_MAX || c.value != (uint32_t)c.shadow) {
+        violation(V_OVERFLOW, "%s is %lu, expected %llu", c.name, (unsigned long)c.value, (unsigned long long)c.shadow);
+      }
+      printf("  %-22s %12llu  ", c.name, (unsigned long long)c.shadow);
+      if (c.shadow == 0) {
+        printf("never\n");
+      } else {
+        double years = (double)(UINT32_MAX - c.value) / (c.shadow / sim_h) / (24 * 365.25);
+        printf("%.1f years\n", years);
+      }
+    }
+    printf("  %-22s %12u  wrapped %llu time(s)\n", "press IDs (16-bit)", last_press_id,
+           (unsigned long long)press_id_wraps);
+    printf("  %-22s %12u  of 65535\n", "longest hold-repeat", max_repeat);
+
+    uint64_t wraps_us = (hostNowUs >> 32) - (opt.start_us >> 32);
+    uint64_t wraps_cyc = (cycles64() >> 32) - ((opt.start_us * (F_CPU_ACTUAL / 1000000)) >> 32);
+    printf("\nSimulated %.2f h from micros() = %lu: micros() wrapped %llu time(s), cycle counter %llu\n", sim_h,
+           (unsigned long)(uint32_t)opt.start_us, (unsigned long long)wraps_us, (unsigned long long)wraps_cyc);
+    printf("Presses %llu, frames sent %llu, suppressed %lu, coalesced %lu, double-taps %llu, long-presses %llu, "
+           "hold-repeats %llu\n",
+           (unsigned long long)presses, (unsigned long long)frames_sent,
+           (unsigned long)driverStats.frames_suppressed.get(), (unsigned long)driverStats.frames_coalesced.get(),
+           (unsigned long long)double_taps, (unsigned long long)long_presses, (unsigned long long)hold_repeats);
+    printf("Press to light: p50 %lu us, p99 %lu us, worst %llu us (limit %lu ms)\n", (unsigned long)pressLatency.p50(),
+           (unsigned long)pressLatency.p99(), (unsigned long long)max_latency_us, (unsigned long)opt.max_latency_ms);
+    printf("Worst gap between lit frames with presses waiting: %llu ms (limit %lu ms)\n",
+           (unsigned long long)(max_gap_us / 1000), (unsigned long)opt.max_gap_ms);
+    printf("Longest idle between frames: %llu s", (unsigned long long)(longest_interval_us / 1000000));
+    if (intervals_out_of_range) printf(", %llu beyond the 32-bit interval", (unsigned long long)intervals_out_of_range);
+    printf("\nEvent delay: mean %lu us, max %lu us; queue high water %lu/%lu\n",
+           (unsigned long)eventDelayStats.mean_us(), (unsigned long)eventDelayStats.max_us,
+           (unsigned long)controlpad_queue.highWater(), (unsigned long)ControlPadEventQueue::capacity());
+    printf("Dispatch budget stops: %lu (budget %lu us)\n", (unsigned long)dispatcher.statistics().budget_stops,
+           (unsigned long)DISPATCH_BUDGET_US);
+    printf("CPU: %lu windows, peak busy %lu.%lu%%\n", (unsigned long)cpuAccount.windowCount(),
+           (unsigned long)(cpuAccount.peakBusyPermille() / 10), (unsigned long)(cpuAccount.peakBusyPermille() % 10));
+
+    printf("\n");
+    for (uint8_t k = 0; k < SIM_VIOLATION_KINDS; k++) {
+      printf("  %-8s %s", VIOLATION_NAMES[k], violations[k] ? "FAIL" : "ok");
+      if (violations[k]) printf(" (%llu)", (unsigned long long)violations[k]);
+      printf("\n");
+    }
+    printf("%s\n", total_violations ? "SOAK FAILED" : "SOAK PASSED");
+  }
+
+  Options opt;
+  std::mt19937 rng;
+  VirtualControlPad pad;
+  EmulatedBus usb;
+  std::priority_queue<SimEvent, std::vector<SimEvent>, std::greater<SimEvent>> events;
+  uint64_t seq = 0;
+  bool started = false;           // Init done, workload running
+
+  // Ground truth
+  std::deque<Edge> edges;         // Queued on the pad, not polled yet
+  std::deque<Pending> delivered;  // Presses kbd_poll took, not dispatched yet
+  std::deque<Pending> waiting;    // Presses not lit yet, oldest first
+  uint32_t coalesced_claimed = 0; // frames_coalesced that stood in for an unlit press
+  uint64_t gap_start_us = 0;      // Last lit frame, or the first press since
+  uint64_t cpu_window_us = 0;     // Start of the open CPU window
+  bool frame_open = false;        // A 56 83 00 went out without its commit yet
+  bool have_commit = false;
+  uint64_t last_commit_us = 0;
+  bool interval_due = false;      // A commit went out; check the interval after loop()
+  uint64_t expected_interval_us = 0;
+  uint32_t drops = 0;
+  uint16_t last_press_id = 0;
+  uint64_t presses = 0, press_id_wraps = 0, lit = 0, unlit = 0;
+  uint64_t frames_rendered = 0, frames_sent = 0, cpu_windows = 0;
+  uint64_t out_submitted = 0, out_rejected = 0, out_completed = 0, kbd_reports = 0, dispatched = 0;
+  uint64_t expected_long_presses = 0, long_presses = 0, hold_repeats = 0;
+  uint64_t expected_double_taps = 0, double_taps = 0;
+  uint16_t last_repeat[CONTROLPAD_BUTTON_COUNT + 1] = {};
+  uint16_t max_repeat = 0;
+  uint64_t max_latency_us = 0, max_gap_us = 0, longest_interval_us = 0, intervals_out_of_range = 0;
+  uint64_t violations[SIM_VIOLATION_KINDS] = {};
+  uint64_t total_violations = 0;
+};
+
+static void usage(const char* argv0) {
+  fprintf(stderr,
+          "usage: %s [--hours H] [--seed N] [--start-us T] [--max-latency-ms MS] [--max-gap-ms MS]\n"
+          "          [--max-idle-s S] [--max-hold-s S] [--refuse N]\n",
+          argv0);
+}
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; i++) {
+    const char* a = argv[i];
+    const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!v) {
+      usage(argv[0]);
+      return 2;
+    }
+    if (strcmp(a, "--hours") == 0) {
+      opt.hours = atof(v);
+    } else if (strcmp(a, "--seed") == 0) {
+      opt.seed = (uint32_t)strtoul(v, nullptr, 0);
+    } else if (strcmp(a, "--start-us") == 0) {
+      opt.start_us = strtoull(v, nullptr, 0);
+    } else if (strcmp(a, "--max-latency-ms") == 0) {
+      opt.max_latency_ms = (uint32_t)strtoul(v, nullptr, 0);
+    } else if (strcmp(a, "--max-gap-ms") == 0) {
+      opt.max_gap_ms = (uint32_t)strtoul(v, nullptr, 0);
+    } else if (strcmp(a, "--max-idle-s") == 0) {
+      opt.max_idle_s = (uint32_t)strtoul(v, nullptr, 0);
+    } else if (strcmp(a, "--max-hold-s") == 0) {
+      opt.max_hold_s = (uint32_t)strtoul(v, nullptr, 0);
+    } else if (strcmp(a, "--refuse") == 0) {
+      opt.refuse = (uint32_t)strtoul(v, nullptr, 0);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+    i++;
+  }
+  if (opt.hours <= 0 || opt.max_idle_s == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  printf("Soak: %.2f h simulated, seed %lu\n", opt.hours, (unsigned long)opt.seed);
+  auto wall = std::chrono::steady_clock::now();
+  Soak soak(opt);
+  bool ok = soak.run();
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall).count();
+  printf("(%.1f s of host time, %.0fx real time)\n", secs, opt.hours * 3600 / secs);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,442 @@
+// Aligns the driver's EP 0x04 command stream with the official editor's for
+// the same action and reports what differs: bytes, commands one side sends and
+// the other does not, and pacing.
+//
+//   g++ -std=c++17 -O2 -Iinclude tools/stream_diff.cpp -o stream_diff
+//   ./pad_emulator --record ours.txt script.txt
+//   ./stream_diff "test/one button to red.txt" ours.txt
+//   ./stream_diff --ignore 52 --ref-range 40:80 test/effect_modes.txt serial.log
+//
+// Either file may be a capture from test/ (read with capture_reader.h) or a
+// mirror log: the OUT lines the firmware prints after "mirror on", or what
+// pad_emulator --record writes (include/controlpad_mirror.h). Other lines in a
+// serial log are skipped, as are mirrored commands whose submit was refused.
+//
+// The first file is the reference. Commands are matched by their first three
+// bytes (command, subcommand, index) with an edit-distance alignment: a
+// matched pair may differ in its payload, everything else is missing (the
+// reference sends it, the driver does not) or extra (only the driver sends
+// it). Extra commands are candidates to drop; missing ones are candidates for
+// what the pad is waiting for.
+//
+// Timing compares, for each matched pair, the time since the previous matched
+// pair on each side; deviations above --tolerance ms (default 5) and
+// --tolerance-pct percent of the reference gap (default 25) are flagged.
+// Hex-only captures carry no time and skip this part.
+//
+// Both streams are then played into the virtual pad (tools/controlpad_emulator.h)
+// and the end states compared: mode, the LEDs on show and brightness. A slimmed
+// sequence that reaches the same state prints EQUIVALENT and exits 0;
+// --strict also requires no missing command and no byte difference.
+//
+// Options:
+//   --ref-range a:b, --our-range a:b   only commands a..b (1-based, as listed)
+//   --ignore <hex>                     drop commands starting with these bytes
+//                                      (repeatable, e.g. --ignore 52 for reads)
+//   --all                              list identical pairs too
+//   --strict                           see above
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "capture_reader.h"
+#include "controlpad_emulator.h"
+#include "controlpad_led.h"
+#include "controlpad_mirror.h"
+
+#define DIFF_MAX_CELLS  (64u * 1024 * 1024)   // Alignment table limit, bytes
+#define DIFF_MAX_RUNS   4                     // Byte-difference runs listed per pair
+
+struct Command {
+  uint64_t time_us;
+  int index;                      // 1-based position in the file, after --ignore
+  uint8_t data[CTRL_REPORT_LEN];
+};
+
+struct Stream {
+  std::string path;
+  std::vector<Command> commands;
+  bool timed = false;
+  bool mirror = false;
+  uint32_t refused = 0;
+  uint32_t ignored = 0;
+};
+
+struct Options {
+  std::vector<std::vector<uint8_t>> ignore;
+  int refFirst = 1, refLast = 0, ourFirst = 1, ourLast = 0;   // 0 = to the end
+  uint64_t toleranceUs = 5000;
+  double tolerancePct = 25;
+  bool all = false;
+  bool strict = false;
+};
+
+static bool ignored(const Options& o, const uint8_t* p) {
+  for (const auto& prefix : o.ignore) {
+    if (memcmp(p, prefix.data(), prefix.size()) == 0) return true;
+  }
+  return false;
+}
+
+static void addCommand(Stream& s, const Options& o, uint64_t t, const uint8_t* p, uint16_t len) {
+  if (ignored(o, p)) {
+    s.ignored++;
+    return;
+  }
+  Command c;
+  c.time_us = t;
+  c.index = (int)s.commands.size() + 1;
+  memset(c.data, 0, sizeof(c.data));
+  memcpy(c.data, p, std::min<uint16_t>(len, CTRL_REPORT_LEN));
+  s.commands.push_back(c);
+}
+
+// Mirror lines if the file has any, otherwise a capture
+static bool readStream(const char* path, const Options& o, Stream& s) {
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  s.path = path;
+  char line[CAPTURE_LINE_MAX];
+  MirrorRecord m;
+  uint64_t high = 0;
+  uint32_t last = 0;
+  while (fgets(line, sizeof(line), f)) {
+    if (!mirrorParseLine(line, m)) continue;
+    s.mirror = true;
+    if (m.result != 0) {
+      s.refused++;
+      continue;
+    }
+    if (!s.commands.empty() && m.time_us < last) high += 1ull << 32;  // micros() wrapped
+    last = m.time_us;
+    addCommand(s, o, high + m.time_us, m.data, m.len);
+  }
+  s.timed = s.mirror;
+
+  if (!s.mirror) {
+    rewind(f);
+    CaptureReader reader(f);
+    CaptureRecord r;
+    while (reader.next(r)) {
+      if (r.in || r.endpoint != VPAD_EP_CTRL_OUT || r.length == 0) continue;
+      s.timed |= r.has_time;
+      addCommand(s, o, r.time_us, r.payload, r.length);
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+static void applyRange(Stream& s, int first, int last) {
+  if (last <= 0 || last > (int)s.commands.size()) last = (int)s.commands.size();
+  if (first < 1) first = 1;
+  if (first > last) {
+    s.commands.clear();
+    return;
+  }
+  s.commands = std::vector<Command>(s.commands.begin() + (first - 1), s.commands.begin() + last);
+}
+
+// ----- Alignment -----
+
+enum Step : uint8_t { STEP_MATCH, STEP_MISSING, STEP_EXTRA };
+
+struct Pair {
+  Step step;
+  const Command* ref;
+  const Command* ours;
+};
+
+static bool sameKey(const Command& a, const Command& b) { return memcmp(a.data, b.data, 3) == 0; }
+
+// Edit distance where a missing or extra command costs 2, a matched pair with
+// a different payload 1 and an identical pair 0; pairs need the same key
+static std::vector<Pair> align(const Stream& ref, const Stream& ours) {
+  size_t n = ref.commands.size(), m = ours.commands.size();
+  std::vector<uint32_t> prev(m + 1), cur(m + 1);
+  std::vector<uint8_t> steps((n + 1) * (m + 1));
+  for (size_t j = 0; j <= m; j++) {
+    prev[j] = (uint32_t)(2 * j);
+    steps[j] = STEP_EXTRA;
+  }
+  for (size_t i = 1; i <= n; i++) {
+    cur[0] = (uint32_t)(2 * i);
+    steps[i * (m + 1)] = STEP_MISSING;
+    const Command& a = ref.commands[i - 1];
+    for (size_t j = 1; j <= m; j++) {
+      const Command& b = ours.commands[j - 1];
+      uint32_t best = prev[j] + 2;
+      uint8_t step = STEP_MISSING;
+      if (cur[j - 1] + 2 < best) {
+        best = cur[j - 1] + 2;
+        step = STEP_EXTRA;
+      }
+      if (sameKey(a, b)) {
+        uint32_t cost = prev[j - 1] + (memcmp(a.data, b.data, CTRL_REPORT_LEN) != 0);
+        if (cost <= best) {
+          best = cost;
+          step = STEP_MATCH;
+        }
+      }
+      cur[j] = best;
+      steps[i * (m + 1) + j] = step;
+    }
+    std::swap(prev, cur);
+  }
+
+  std::vector<Pair> out;
+  size_t i = n, j = m;
+  while (i || j) {
+    Step step = (Step)steps[i * (m + 1) + j];
+    if (step == STEP_MATCH) {
+      out.push_back({STEP_MATCH, &ref.commands[--i], &ours.commands[--j]});
+    } else if (step == STEP_MISSING) {
+      out.push_back({STEP_MISSING, &ref.commands[--i], nullptr});
+    } else {
+      out.push_back({STEP_EXTRA, nullptr, &ours.commands[--j]});
+    }
+  }
+  std::reverse(out.begin(), out.end());
+  return out;
+}
+
+// ----- Report -----
+
+static std::string describe(const uint8_t* p) {
+  char b[48];
+  LedCommand c = ledCommandOf(p, CTRL_REPORT_LEN);
+  if (c != LED_CMD_OTHER) {
+    snprintf(b, sizeof(b), "%02x %02x %02x %s", p[0], p[1], p[2], ledCommandName(c));
+  } else {
+    snprintf(b, sizeof(b), "%02x %02x %02x", p[0], p[1], p[2]);
+  }
+  return b;
+}
+
+// "@12-15 bbbbbbbb>55555555" per run of differing bytes
+static std::string byteDiff(const uint8_t* a, const uint8_t* b, uint32_t& bytes) {
+  std::string s;
+  int runs = 0;
+  bytes = 0;
+  for (int i = 0; i < CTRL_REPORT_LEN;) {
+    if (a[i] == b[i]) {
+      i++;
+      continue;
+    }
+    int end = i;
+    while (end < CTRL_REPORT_LEN && a[end] != b[end]) end++;
+    bytes += end - i;
+    if (++runs <= DIFF_MAX_RUNS) {
+      char head[16];
+      snprintf(head, sizeof(head), end - i > 1 ? " @%d-%d " : " @%d ", i, end - 1);
+      s += head;
+      char hex[3];
+      for (int k = i; k < end; k++) s += (snprintf(hex, sizeof(hex), "%02x", a[k]), hex);
+      s += '>';
+      for (int k = i; k < end; k++) s += (snprintf(hex, sizeof(hex), "%02x", b[k]), hex);
+    }
+    i = end;
+  }
+  if (runs > DIFF_MAX_RUNS) s += " ...";
+  return s;
+}
+
+static std::string ms(const Command* c, uint64_t origin) {
+  char b[24];
+  snprintf(b, sizeof(b), "%10.3f", (double)(c->time_us - origin) / 1000.0);
+  return b;
+}
+
+// Mode, LEDs on show and brightness after playing the stream into the model
+struct EndState {
+  uint8_t mode;
+  LedFrame leds;
+  uint32_t commits;
+};
+
+static EndState play(const Stream& s) {
+  VirtualControlPad pad;
+  uint8_t report[CTRL_REPORT_LEN];
+  for (const Command& c : s.commands) {
+    pad.out(VPAD_EP_CTRL_OUT, c.data, CTRL_REPORT_LEN);
+    while (pad.in(VPAD_EP_CTRL_IN, report)) {
+    }
+  }
+  return {pad.currentMode(), pad.leds(), pad.commitCount()};
+}
+
+static bool sameState(const EndState& a, const EndState& b) {
+  return a.mode == b.mode && a.leds.brightness == b.leds.brightness &&
+         memcmp(a.leds.rgb, b.leds.rgb, sizeof(a.leds.rgb)) == 0;
+}
+
+static int report(const Stream& ref, const Stream& ours, const Options& o) {
+  std::vector<Pair> pairs = align(ref, ours);
+  bool timed = ref.timed && ours.timed && !ref.commands.empty() && !ours.commands.empty();
+  uint64_t refOrigin = ref.commands.empty() ? 0 : ref.commands[0].time_us;
+  uint64_t ourOrigin = ours.commands.empty() ? 0 : ours.commands[0].time_us;
+
+  printf("reference %s: %zu commands%s\n", ref.path.c_str(), ref.commands.size(), ref.mirror ? " (mirror)" : "");
+  printf("ours      %s: %zu commands%s\n", ours.path.c_str(), ours.commands.size(), ours.mirror ? " (mirror)" : "");
+  if (ref.ignored || ours.ignored) printf("ignored   %u / %u commands\n", ref.ignored, ours.ignored);
+  if (ours.refused) printf("refused   %u mirrored submit(s) never reached the bus\n", ours.refused);
+  printf("\n    %5s %5s %s %s  %s\n", "ref", "ours", timed ? "     t_ref      t_ours    gap dev" : "", "", "command");
+
+  uint32_t same = 0, changed = 0, missing = 0, extra = 0, bytes = 0, late = 0;
+  std::vector<double> deviations;
+  const Pair* lastMatch = nullptr;
+  for (const Pair& p : pairs) {
+    const Command* c = p.ref ? p.ref : p.ours;
+    std::string detail, timing;
+    char mark = '=';
+    if (p.step == STEP_MATCH) {
+      uint32_t n = 0;
+      detail = byteDiff(p.ref->data, p.ours->data, n);
+      bytes += n;
+      mark = n ? '~' : '=';
+      n ? changed++ : same++;
+      if (timed && lastMatch) {
+        int64_t refGap = (int64_t)(p.ref->time_us - lastMatch->ref->time_us);
+        int64_t ourGap = (int64_t)(p.ours->time_us - lastMatch->ours->time_us);
+        double dev = (double)(ourGap - refGap);
+        deviations.push_back(std::fabs(dev));
+        bool flagged = std::fabs(dev) > o.toleranceUs && std::fabs(dev) > refGap * o.tolerancePct / 100;
+        char b[32];
+        snprintf(b, sizeof(b), "%+9.1f%s", dev / 1000.0, flagged ? "!" : " ");
+        timing = b;
+        if (flagged) {
+          late++;
+          if (mark == '=') mark = 't';
+        }
+      }
+      lastMatch = &p;
+    } else if (p.step == STEP_MISSING) {
+      mark = '-';
+      missing++;
+    } else {
+      mark = '+';
+      extra++;
+    }
+    if (mark == '=' && !o.all) continue;
+
+    char refIdx[8] = ".", ourIdx[8] = ".";
+    if (p.ref) snprintf(refIdx, sizeof(refIdx), "%d", p.ref->index);
+    if (p.ours) snprintf(ourIdx, sizeof(ourIdx), "%d", p.ours->index);
+    std::string times;
+    if (timed) {
+      times = (p.ref ? ms(p.ref, refOrigin) : std::string(10, ' ')) + "  " +
+              (p.ours ? ms(p.ours, ourOrigin) : std::string(10, ' ')) + " " +
+              (timing.empty() ? std::string(10, ' ') : timing);
+    }
+    printf("  %c %5s %5s %s  %s%s\n", mark, refIdx, ourIdx, times.c_str(), describe(c->data).c_str(),
+           detail.c_str());
+  }
+
+  printf("\n%u identical, %u with different bytes (%u bytes), %u missing from ours, %u extra in ours\n", same,
+         changed, bytes, missing, extra);
+  if (timed) {
+    uint64_t refSpan = ref.commands.back().time_us - refOrigin;
+    uint64_t ourSpan = ours.commands.back().time_us - ourOrigin;
+    std::sort(deviations.begin(), deviations.end());
+    double p50 = deviations.empty() ? 0 : deviations[deviations.size() / 2];
+    double worst = deviations.empty() ? 0 : deviations.back();
+    printf("timing: reference %.1f ms, ours %.1f ms; gap deviation p50 %.1f ms, max %.1f ms, %u over tolerance\n",
+           refSpan / 1000.0, ourSpan / 1000.0, p50 / 1000.0, worst / 1000.0, late);
+  } else {
+    printf("timing: not compared (%s has no timestamps)\n", ref.timed ? ours.path.c_str() : ref.path.c_str());
+  }
+
+  EndState a = play(ref), b = play(ours);
+  bool equivalent = sameState(a, b) && (!o.strict || (missing == 0 && changed == 0));
+  printf("end state: reference mode %s, %u commits; ours mode %s, %u commits\n", VirtualControlPad::modeName(a.mode),
+         a.commits, VirtualControlPad::modeName(b.mode), b.commits);
+  if (!sameState(a, b)) {
+    if (a.leds.brightness != b.leds.brightness) {
+      printf("  brightness %02x vs %02x\n", a.leds.brightness, b.leds.brightness);
+    }
+    for (uint8_t i = 0; i < LED_COUNT; i++) {
+      if (memcmp(a.leds.rgb[i], b.leds.rgb[i], 3) != 0) {
+        printf("  LED %2u: %02x%02x%02x vs %02x%02x%02x\n", i + 1, a.leds.rgb[i][0], a.leds.rgb[i][1],
+               a.leds.rgb[i][2], b.leds.rgb[i][0], b.leds.rgb[i][1], b.leds.rgb[i][2]);
+      }
+    }
+  }
+  printf("%s\n", equivalent ? "EQUIVALENT" : "DIFFERENT");
+  return equivalent ? 0 : 1;
+}
+
+// ----- Command line -----
+
+static bool parseRange(const char* s, int& first, int& last) {
+  return sscanf(s, "%d:%d", &first, &last) == 2 && first >= 1 && last >= first;
+}
+
+static bool parseHex(const char* s, std::vector<uint8_t>& out) {
+  out.clear();
+  for (; *s; s++) {
+    if (*s == ' ') continue;
+    int hi = mirrorHexDigit(s[0]);
+    int lo = hi < 0 ? -1 : mirrorHexDigit(s[1]);
+    if (lo < 0) return false;
+    out.push_back((uint8_t)(hi << 4 | lo));
+    s++;
+  }
+  return !out.empty() && out.size() <= CTRL_REPORT_LEN;
+}
+
+int main(int argc, char** argv) {
+  Options o;
+  std::vector<const char*> paths;
+  for (int i = 1; i < argc; i++) {
+    bool more = i + 1 < argc;
+    std::vector<uint8_t> prefix;
+    if (strcmp(argv[i], "--ref-range") == 0 && more && parseRange(argv[i + 1], o.refFirst, o.refLast)) {
+      i++;
+    } else if (strcmp(argv[i], "--our-range") == 0 && more && parseRange(argv[i + 1], o.ourFirst, o.ourLast)) {
+      i++;
+    } else if (strcmp(argv[i], "--ignore") == 0 && more && parseHex(argv[i + 1], prefix)) {
+      o.ignore.push_back(prefix);
+      i++;
+    } else if (strcmp(argv[i], "--tolerance") == 0 && more) {
+      o.toleranceUs = (uint64_t)(atof(argv[++i]) * 1000);
+    } else if (strcmp(argv[i], "--tolerance-pct") == 0 && more) {
+      o.tolerancePct = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--all") == 0) {
+      o.all = true;
+    } else if (strcmp(argv[i], "--strict") == 0) {
+      o.strict = true;
+    } else if (argv[i][0] == '-') {
+      fprintf(stderr,
+              "usage: %s [--ref-range a:b] [--our-range a:b] [--ignore hex]... [--tolerance ms]\n"
+              "          [--tolerance-pct pct] [--all] [--strict] reference ours\n",
+              argv[0]);
+      return strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0 ? 0 : 2;
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.size() != 2) {
+    fprintf(stderr, "need a reference and a stream to compare, see --help\n");
+    return 2;
+  }
+
+  Stream ref, ours;
+  if (!readStream(paths[0], o, ref) || !readStream(paths[1], o, ours)) return 2;
+  applyRange(ref, o.refFirst, o.refLast);
+  applyRange(ours, o.ourFirst, o.ourLast);
+  if ((uint64_t)(ref.commands.size() + 1) * (ours.commands.size() + 1) > DIFF_MAX_CELLS) {
+    fprintf(stderr, "%zu x %zu commands is too many to align; narrow it with --ref-range / --our-range\n",
+            ref.commands.size(), ours.commands.size());
+    return 2;
+  }
+  return report(ref, ours, o);
+}
@@ -0,0 +1,140 @@
+// Decodes trace records captured from the serial port ("trace" / "trace on"
+// commands) into readable text or Chrome/Perfetto trace JSON.
+//
+//   g++ -std=c++17 -O2 -Iinclude tools/trace_decode.cpp -o trace_decode
+//   ./trace_decode serial.log              # text
+//   ./trace_decode --chrome serial.log > trace.json   # open in ui.perfetto.dev
+//
+// Any line that is not a "TRACE BEGIN" header or a "T ..." record is ignored,
+// so a whole serial log can be fed in as-is.
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "controlpad_trace.h"
+
+struct Decoded {
+  uint64_t cycles;   // Unwrapped
+  TraceRecord rec;
+};
+
+// Records written from USB callbacks vs. from loop(); shown as two tracks
+static int trackOf(uint16_t id) {
+  switch (id) {
+    case TRACE_KBD_POLL:
+    case TRACE_CTRL_POLL:
+    case TRACE_SENT:
+    case TRACE_COMMIT:
+    case TRACE_INIT_STEP:
+      return 1;
+    default:
+      return 2;
+  }
+}
+
+static const char* phaseName(uint8_t phase) {
+  switch (phase) {
+    case TRACE_BEGIN: return "B";
+    case TRACE_END:   return "E";
+    default:          return "i";
+  }
+}
+
+int main(int argc, char** argv) {
+  bool chrome = false;
+  const char* path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--chrome") == 0) {
+      chrome = true;
+    } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      fprintf(stderr, "usage: %s [--chrome] [serial.log]\n", argv[0]);
+      return 0;
+    } else {
+      path = argv[i];
+    }
+  }
+
+  FILE* in = path ? fopen(path, "r") : stdin;
+  if (!in) {
+    perror(path);
+    return 1;
+  }
+
+  double hz = 600e6;  // Teensy 4.1 default; replaced by the dump header
+  uint32_t lost = 0;
+  std::vector<Decoded> records;
+  uint64_t cyc64 = 0;
+  uint32_t prev = 0;
+  bool have_prev = false;
+
+  char line[256];
+  while (fgets(line, sizeof(line), in)) {
+    unsigned long v_hz, v_rec, v_lost;
+    if (sscanf(line, "TRACE BEGIN hz=%lu recorded=%lu lost=%lu", &v_hz, &v_rec, &v_lost) == 3) {
+      if (v_hz) hz = (double)v_hz;
+      lost = (uint32_t)v_lost;
+      continue;
+    }
+
+    unsigned long cyc, a0, a1;
+    unsigned id, phase;
+    if (sscanf(line, "T %lx %x %x %lx %lx", &cyc, &id, &phase, &a0, &a1) != 5) continue;
+
+    // Cycle counter wraps every 2^32 cycles. Records are not quite in time
+    // order (an interrupt can land between reading the counter and claiming
+    // a slot), so each one is placed at the signed 32-bit distance from the
+    // one before: forwards or backwards, as long as neighbours are less than
+    // half a wrap (3.5 s at 600 MHz) apart.
+    uint32_t c = (uint32_t)cyc;
+    if (have_prev) {
+      cyc64 += (int64_t)(int32_t)(c - prev);
+    } else {
+      cyc64 = c;
+    }
+    prev = c;
+    have_prev = true;
+
+    Decoded d;
+    d.cycles = cyc64;
+    d.rec.cycles = c;
+    d.rec.id = (uint16_t)id;
+    d.rec.phase = (uint8_t)phase;
+    d.rec.reserved = 0;
+    d.rec.a0 = (uint32_t)a0;
+    d.rec.a1 = (uint32_t)a1;
+    records.push_back(d);
+  }
+  if (path) fclose(in);
+
+  if (records.empty()) {
+    fprintf(stderr, "no trace records found\n");
+    return 1;
+  }
+
+  uint64_t t0 = records.front().cycles;
+  auto micros = [&](const Decoded& d) { return (double)(int64_t)(d.cycles - t0) * 1e6 / hz; };
+
+  if (!chrome) {
+    printf("%zu records, %.0f Hz, %" PRIu32 " lost on target\n", records.size(), hz, lost);
+    for (const Decoded& d : records) {
+      printf("%12.3f us  %-10s %s  a0=%-10" PRIu32 " a1=0x%08" PRIX32 "\n", micros(d),
+             traceName(d.rec.id), phaseName(d.rec.phase), d.rec.a0, d.rec.a1);
+    }
+    return 0;
+  }
+
+  printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  printf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"usb callbacks\"}},\n");
+  printf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"loop\"}}");
+  for (const Decoded& d : records) {
+    printf(",\n{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,", traceName(d.rec.id),
+           phaseName(d.rec.phase), micros(d), trackOf(d.rec.id));
+    if (d.rec.phase == TRACE_INSTANT) printf("\"s\":\"t\",");
+    printf("\"args\":{\"a0\":%" PRIu32 ",\"a1\":%" PRIu32 "}}", d.rec.a0, d.rec.a1);
+  }
+  printf("\n]}\n");
+  return 0;
+}